@@ -0,0 +1,680 @@
+/* mkfs.c - builds a file system image from a flat source directory
+ *
+ * Build on the host with "gcc -O2 -o mkfs mkfs.c". Every file is laid out in
+ * one run of data blocks. Version 2 images (the default) describe each file
+ * with a single extent, "-1" builds the original block index format that
+ * createfs makes. "-z" compresses every 4 kB block of a version 2 image in
+ * the format of student-distrib/lz.h, for files where that saves blocks.
+ * "-d" stores identical blocks of files once, so their inodes share them.
+ * "-3" builds a version 3 image, block indices like version 1 with indirect
+ * blocks for files of more than 1021 blocks.
+ * The layout has to match student-distrib/file_system.h
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* --- Literal Definitions --- */
+
+#define BLOCK_SIZE 4096
+#define DIR_ENTRY_SIZE 64
+#define FILE_NAME_SIZE 32
+#define NUM_DIR_ENTRY 63
+#define DIR_ENTRIES_PER_BLOCK (BLOCK_SIZE / DIR_ENTRY_SIZE)
+#define DATA_BLOCK 1023
+
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIR 1
+#define FILE_TYPE_FILE 2
+
+#define DIR_EXT_MAGIC 0x44495245  // "ERID"
+#define FS_V2_MAGIC 0x32534642    // "BFS2"
+#define FS_V3_MAGIC 0x33534642    // "BFS3"
+
+// Boot block fields, byte offsets
+#define BOOT_NUM_DIR_ENTRIES 0
+#define BOOT_NUM_INODES 4
+#define BOOT_NUM_DATA_BLOCKS 8
+#define BOOT_DIR_MAGIC 12
+#define BOOT_DIR_INODE 16
+#define BOOT_FS_MAGIC 20
+#define BOOT_DIR_ENTRIES 64
+
+// Directory entry fields, byte offsets
+#define DENTRY_FILE_TYPE 32
+#define DENTRY_INODE_NUM 36
+
+// Inode fields, byte offsets
+#define INODE_LENGTH 0
+#define INODE_BLOCKS 4       // version 1, one index per block
+#define INODE_NUM_EXTENTS 4  // version 2, then start and length pairs
+#define INODE_EXTENTS 8
+#define INODE_FLAGS 4088  // version 2, after the last extent
+#define MAX_EXTENTS 510
+#define DIRECT_BLOCKS 1021  // version 3, then the indirect and double indirect
+#define INODE_IND (INODE_BLOCKS + 4 * DIRECT_BLOCKS)
+#define INODE_DIND (INODE_IND + 4)
+#define INDICES_PER_BLOCK (BLOCK_SIZE / 4)
+
+#define INODE_COMPRESSED 0x1
+
+// Compressed blocks, see student-distrib/lz.h
+#define LZ_MIN_MATCH 4
+#define LZ_LEN_BITS 4
+#define LZ_LEN_MASK 0x0F
+#define LZ_LEN_MORE 0xFF
+#define LZ_HASH_BITS 12
+#define LZ_MAX_SIZE (BLOCK_SIZE + BLOCK_SIZE / LZ_LEN_MORE + 16)
+
+// Blocks already stored are found by a hash of their contents
+#define DEDUP_HASH_SIZE 4096
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+#define NONE 0xFFFFFFFF
+
+#define DEFAULT_INODES 64
+#define MAX_FILES 4096
+
+/* --- Local Types --- */
+
+typedef struct entry {
+  char name[FILE_NAME_SIZE + 1];
+  uint32_t file_type;
+  uint32_t inode;
+  uint8_t* data;  // file contents, NULL for rtc and the directory
+  uint32_t size;
+  uint32_t* map;  // data block of each stored block, then the indirect ones
+  uint8_t* stream;  // offset table and compressed blocks, NULL if stored
+  uint32_t stream_len;
+} entry_t;
+
+// A block of file data that was given a data block of its own
+typedef struct stored_block {
+  const uint8_t* data;
+  uint32_t len;
+  uint32_t block;
+  uint32_t next;  // next stored block in the same hash bucket
+} stored_block_t;
+
+// Global Variables
+static entry_t entries[MAX_FILES + 2];
+static uint32_t num_entries;
+static int version = 2;
+static int compress;
+static int dedup;
+
+static stored_block_t* stored;
+static uint32_t num_stored;
+static uint32_t dedup_hash[DEDUP_HASH_SIZE];  // first stored block of a bucket
+static uint32_t num_shared;
+
+/* Name: put32()
+ * Description: stores a little endian 32 bit value
+ * Inputs: p: where to store it, val: the value
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void put32(uint8_t* p, uint32_t val) {
+  p[0] = val;
+  p[1] = val >> 8;
+  p[2] = val >> 16;
+  p[3] = val >> 24;
+}
+
+/* Name: num_blocks()
+ * Description: number of data blocks needed for size bytes
+ * Inputs: size: length in bytes
+ * Outputs: none
+ * Return Value: number of blocks
+ * Side Effects: none
+ */
+static uint32_t num_blocks(uint32_t size) {
+  return (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+/* Name: lz_put_length()
+ * Description: writes the length bytes that follow a 15 in a token
+ * Inputs: out: where to write them, len: the length minus 15
+ * Outputs: none
+ * Return Value: number of bytes written
+ * Side Effects: none
+ */
+static uint32_t lz_put_length(uint8_t* out, uint32_t len) {
+  uint32_t n = 0;
+  for (; len >= LZ_LEN_MORE; len -= LZ_LEN_MORE) out[n++] = LZ_LEN_MORE;
+  out[n++] = len;
+  return n;
+}
+
+/* Name: lz_put_sequence()
+ * Description: writes a run of literals followed by a match
+ * Inputs: out: where to write it, lit: the literals, num_lit: how many,
+ *         offset: how far back the match is, 0 for the last sequence,
+ *         match: its length
+ * Outputs: none
+ * Return Value: number of bytes written
+ * Side Effects: none
+ */
+static uint32_t lz_put_sequence(uint8_t* out, const uint8_t* lit,
+                                uint32_t num_lit, uint32_t offset,
+                                uint32_t match) {
+  uint32_t n = 1;
+  uint32_t lit_code = num_lit < LZ_LEN_MASK ? num_lit : LZ_LEN_MASK;
+  uint32_t match_code = 0;
+  if (offset) {
+    match -= LZ_MIN_MATCH;
+    match_code = match < LZ_LEN_MASK ? match : LZ_LEN_MASK;
+  }
+  out[0] = (lit_code << LZ_LEN_BITS) | match_code;
+
+  if (lit_code == LZ_LEN_MASK)
+    n += lz_put_length(out + n, num_lit - LZ_LEN_MASK);
+  memcpy(out + n, lit, num_lit);
+  n += num_lit;
+  if (!offset) return n;
+
+  out[n++] = offset;
+  out[n++] = offset >> 8;
+  if (match_code == LZ_LEN_MASK)
+    n += lz_put_length(out + n, match - LZ_LEN_MASK);
+  return n;
+}
+
+/* Name: lz_compress()
+ * Description: compresses one block with greedy matches found through a
+ *              hash of the next 4 bytes
+ * Inputs: src: the block, len: its size, at most BLOCK_SIZE,
+ *         out: at least LZ_MAX_SIZE bytes
+ * Outputs: none
+ * Return Value: size of the compressed block
+ * Side Effects: none
+ */
+static uint32_t lz_compress(const uint8_t* src, uint32_t len, uint8_t* out) {
+  int32_t table[1 << LZ_HASH_BITS];
+  uint32_t i = 0, anchor = 0, n = 0, match, hash, word;
+  int32_t cand;
+
+  memset(table, -1, sizeof(table));
+  while (i + LZ_MIN_MATCH <= len) {
+    memcpy(&word, src + i, sizeof(word));
+    hash = (word * 2654435761u) >> (32 - LZ_HASH_BITS);
+    cand = table[hash];
+    table[hash] = i;
+    if (cand < 0 || memcmp(src + cand, src + i, LZ_MIN_MATCH)) {
+      i++;
+      continue;
+    }
+
+    for (match = LZ_MIN_MATCH; i + match < len; match++)
+      if (src[cand + match] != src[i + match]) break;
+    n += lz_put_sequence(out + n, src + anchor, i - anchor, i - cand, match);
+    i += match;
+    anchor = i;
+  }
+  return n + lz_put_sequence(out + n, src + anchor, len - anchor, 0, 0);
+}
+
+/* Name: compress_entry()
+ * Description: builds the stream of a compressed file, a table of where
+ *              each block starts and then the blocks, each stored as is
+ *              when it doesn't shrink. Files that wouldn't take fewer data
+ *              blocks are left uncompressed
+ * Inputs: e: the file
+ * Outputs: none
+ * Return Value: 0 on success, -1 if out of memory
+ * Side Effects: sets the stream of the entry
+ */
+static int compress_entry(entry_t* e) {
+  uint32_t i, len, pos, blocks = num_blocks(e->size);
+  if (blocks == 0) return 0;
+
+  pos = (blocks + 1) * 4;
+  uint8_t* stream = malloc(pos + blocks * LZ_MAX_SIZE);
+  if (stream == NULL) return -1;
+
+  for (i = 0; i < blocks; i++) {
+    put32(stream + 4 * i, pos);
+    len = e->size - i * BLOCK_SIZE < BLOCK_SIZE ? e->size - i * BLOCK_SIZE
+                                                 : BLOCK_SIZE;
+    uint32_t n = lz_compress(e->data + i * BLOCK_SIZE, len, stream + pos);
+    if (n >= len) {  // the kernel reads a block of its own size as stored
+      memcpy(stream + pos, e->data + i * BLOCK_SIZE, len);
+      n = len;
+    }
+    pos += n;
+  }
+  put32(stream + 4 * blocks, pos);
+
+  if (num_blocks(pos) >= blocks) {
+    free(stream);
+    return 0;
+  }
+  e->stream = stream;
+  e->stream_len = pos;
+  return 0;
+}
+
+/* Name: stored_blocks()
+ * Description: number of data blocks a file takes up in the image
+ * Inputs: e: the file
+ * Outputs: none
+ * Return Value: number of blocks
+ * Side Effects: none
+ */
+static uint32_t stored_blocks(const entry_t* e) {
+  return num_blocks(e->stream ? e->stream_len : e->size);
+}
+
+/* Name: indirect_blocks()
+ * Description: number of blocks of indices a version 3 file needs
+ * Inputs: blocks: number of data blocks in the file
+ * Outputs: none
+ * Return Value: number of blocks, the single indirect block then the double
+ *               indirect block and the blocks it points at
+ * Side Effects: none
+ */
+static uint32_t indirect_blocks(uint32_t blocks) {
+  if (version != 3 || blocks <= DIRECT_BLOCKS) return 0;
+  blocks -= DIRECT_BLOCKS;
+  if (blocks <= INDICES_PER_BLOCK) return 1;
+  blocks -= INDICES_PER_BLOCK;
+  return 2 + (blocks + INDICES_PER_BLOCK - 1) / INDICES_PER_BLOCK;
+}
+
+/* Name: dedup_block()
+ * Description: finds a stored block with the same contents, or stores this
+ *              one in the next data block
+ * Inputs: data: the contents, len: their length, at most BLOCK_SIZE,
+ *         next_block: the next unused data block, advanced if it is used
+ * Outputs: none
+ * Return Value: the data block holding the contents
+ * Side Effects: adds the block to the hash of stored blocks
+ */
+static uint32_t dedup_block(const uint8_t* data, uint32_t len,
+                            uint32_t* next_block) {
+  uint32_t i, hash = FNV_OFFSET_BASIS;
+  for (i = 0; i < len; i++) hash = (hash ^ data[i]) * FNV_PRIME;
+  uint32_t* bucket = &dedup_hash[hash % DEDUP_HASH_SIZE];
+
+  for (i = *bucket; i != NONE; i = stored[i].next) {
+    if (stored[i].len == len && !memcmp(stored[i].data, data, len)) {
+      num_shared++;
+      return stored[i].block;
+    }
+  }
+
+  stored[num_stored].data = data;
+  stored[num_stored].len = len;
+  stored[num_stored].block = (*next_block)++;
+  stored[num_stored].next = *bucket;
+  *bucket = num_stored;
+  return stored[num_stored++].block;
+}
+
+/* Name: layout_entry()
+ * Description: picks the data blocks of a file, the next ones in the image
+ *              or blocks already holding the same contents. Compressed
+ *              streams stay in one run, blocks of indices come after the
+ *              file's data
+ * Inputs: e: the file, next_block: the next unused data block, advanced
+ *         past the blocks that are used, share: 1 to look for blocks with
+ *         the same contents
+ * Outputs: none
+ * Return Value: 0 on success, -1 if out of memory
+ * Side Effects: sets the map of the entry
+ */
+static int layout_entry(entry_t* e, uint32_t* next_block, int share) {
+  uint32_t k, len, blocks = stored_blocks(e);
+  uint32_t total = blocks + indirect_blocks(blocks);
+  if ((e->map = malloc((total ? total : 1) * sizeof(uint32_t))) == NULL)
+    return -1;
+
+  for (k = 0; k < blocks; k++) {
+    if (!share || e->stream) {
+      e->map[k] = (*next_block)++;
+      continue;
+    }
+    len = e->size - k * BLOCK_SIZE < BLOCK_SIZE ? e->size - k * BLOCK_SIZE
+                                                 : BLOCK_SIZE;
+    e->map[k] = dedup_block(e->data + k * BLOCK_SIZE, len, next_block);
+  }
+  for (; k < total; k++) e->map[k] = (*next_block)++;
+  return 0;
+}
+
+/* Name: entry_cmp()
+ * Description: orders entries by name the way the kernel compares names
+ * Inputs: a, b: the entries
+ * Outputs: none
+ * Return Value: <0, 0 or >0 like strncmp
+ * Side Effects: none
+ */
+static int entry_cmp(const void* a, const void* b) {
+  return strncmp(((const entry_t*)a)->name, ((const entry_t*)b)->name,
+                 FILE_NAME_SIZE);
+}
+
+/* Name: read_file()
+ * Description: reads a whole file into memory
+ * Inputs: path: the file, size: set to its length
+ * Outputs: none
+ * Return Value: the contents, NULL on failure
+ * Side Effects: allocates the buffer
+ */
+static uint8_t* read_file(const char* path, uint32_t* size) {
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) return NULL;
+
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t* data = malloc(*size ? *size : 1);
+  if (data != NULL && fread(data, 1, *size, f) != *size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  return data;
+}
+
+/* Name: read_dir()
+ * Description: adds every regular file in the source directory as an entry,
+ *              after "." and "rtc"
+ * Inputs: dir_path: the source directory
+ * Outputs: error messages
+ * Return Value: 0 on success, -1 on failure
+ * Side Effects: fills entries
+ */
+static int read_dir(const char* dir_path) {
+  char path[4096];
+  struct dirent* d;
+  struct stat st;
+  uint32_t i;
+
+  DIR* dir = opendir(dir_path);
+  if (dir == NULL) {
+    perror(dir_path);
+    return -1;
+  }
+
+  strcpy(entries[0].name, ".");
+  entries[0].file_type = FILE_TYPE_DIR;
+  strcpy(entries[1].name, "rtc");
+  entries[1].file_type = FILE_TYPE_RTC;
+  num_entries = 2;
+
+  while ((d = readdir(dir)) != NULL) {
+    snprintf(path, sizeof(path), "%s/%s", dir_path, d->d_name);
+    if (stat(path, &st) || !S_ISREG(st.st_mode)) continue;
+    if (num_entries == MAX_FILES + 2) {
+      fprintf(stderr, "too many files\n");
+      return -1;
+    }
+
+    entry_t* e = &entries[num_entries++];
+    // long names are cut to fill the whole field, like createfs does
+    memcpy(e->name, d->d_name, strnlen(d->d_name, FILE_NAME_SIZE));
+    e->file_type = FILE_TYPE_FILE;
+    if ((e->data = read_file(path, &e->size)) == NULL) {
+      perror(path);
+      return -1;
+    }
+  }
+  closedir(dir);
+
+  // sorted so the entries past the boot block can be binary searched
+  qsort(&entries[2], num_entries - 2, sizeof(entry_t), entry_cmp);
+  for (i = 3; i < num_entries; i++) {
+    if (!entry_cmp(&entries[i - 1], &entries[i])) {
+      fprintf(stderr, "two files are named %s\n", entries[i].name);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* Name: write_indices()
+ * Description: fills in the block indices of a version 3 file, the ones past
+ *              the direct blocks go in its blocks of indices
+ * Inputs: inode: the inode block, data: the data blocks of the image,
+ *         map: the data block of each stored block, then the blocks of
+ *         indices, blocks: number of data blocks
+ * Outputs: error messages
+ * Return Value: 0 on success, -1 if the file is too large for the format
+ * Side Effects: writes the blocks of indices
+ */
+static int write_indices(uint8_t* inode, uint8_t* data, const uint32_t* map,
+                         uint32_t blocks) {
+  const uint32_t* tables = map + blocks;
+  uint32_t i, pos;
+
+  if (indirect_blocks(blocks) > 2 + INDICES_PER_BLOCK) {
+    fprintf(stderr, "file of %u blocks is too large\n", blocks);
+    return -1;
+  }
+  for (i = 0; i < blocks && i < DIRECT_BLOCKS; i++)
+    put32(inode + INODE_BLOCKS + 4 * i, map[i]);
+  if (blocks <= DIRECT_BLOCKS) return 0;
+
+  put32(inode + INODE_IND, tables[0]);
+  for (pos = 0; i < blocks && pos < INDICES_PER_BLOCK; i++, pos++)
+    put32(data + tables[0] * BLOCK_SIZE + 4 * pos, map[i]);
+  if (i == blocks) return 0;
+
+  // the double indirect block points at the rest of the tables in order
+  put32(inode + INODE_DIND, tables[1]);
+  for (pos = 0; i < blocks; i++, pos++) {
+    if (pos % INDICES_PER_BLOCK == 0)
+      put32(data + tables[1] * BLOCK_SIZE + 4 * (pos / INDICES_PER_BLOCK),
+            tables[2 + pos / INDICES_PER_BLOCK]);
+    put32(data + tables[2 + pos / INDICES_PER_BLOCK] * BLOCK_SIZE +
+              4 * (pos % INDICES_PER_BLOCK),
+          map[i]);
+  }
+  return 0;
+}
+
+/* Name: write_inode()
+ * Description: fills in the inode of a file, on version 2 images each run
+ *              of consecutive data blocks becomes an extent
+ * Inputs: inode: the inode block, data: the data blocks of the image,
+ *         size: the file length, map: the data block of each stored block,
+ *         blocks: number of data blocks, flags: inode flags of a version 2
+ *         image
+ * Outputs: error messages
+ * Return Value: 0 on success, -1 if the file is too large for the format
+ * Side Effects: version 3 files write their blocks of indices
+ */
+static int write_inode(uint8_t* inode, uint8_t* data, uint32_t size,
+                       const uint32_t* map, uint32_t blocks, uint32_t flags) {
+  uint32_t i, num_extents = 0, length = 0;
+  put32(inode + INODE_LENGTH, size);
+
+  if (version == 2) {
+    for (i = 0; i < blocks; i++) {
+      if (length && map[i] == map[i - 1] + 1) {
+        put32(inode + INODE_EXTENTS + 8 * (num_extents - 1) + 4, ++length);
+        continue;
+      }
+      if (num_extents == MAX_EXTENTS) {
+        fprintf(stderr, "file of %u bytes has too many extents\n", size);
+        return -1;
+      }
+      put32(inode + INODE_EXTENTS + 8 * num_extents++, map[i]);
+      put32(inode + INODE_EXTENTS + 8 * (num_extents - 1) + 4, length = 1);
+    }
+    put32(inode + INODE_NUM_EXTENTS, num_extents);
+    put32(inode + INODE_FLAGS, flags);
+    return 0;
+  }
+  if (version == 3) return write_indices(inode, data, map, blocks);
+
+  if (blocks > DATA_BLOCK) {
+    fprintf(stderr, "file of %u bytes is too large\n", size);
+    return -1;
+  }
+  for (i = 0; i < blocks; i++) put32(inode + INODE_BLOCKS + 4 * i, map[i]);
+  return 0;
+}
+
+/* Name: write_dentry()
+ * Description: fills in a directory entry
+ * Inputs: dentry: where to write it, e: the entry
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void write_dentry(uint8_t* dentry, const entry_t* e) {
+  memcpy(dentry, e->name, strlen(e->name));
+  put32(dentry + DENTRY_FILE_TYPE, e->file_type);
+  put32(dentry + DENTRY_INODE_NUM, e->inode);
+}
+
+/* Name: main()
+ * Description: mkfs [-1 | -3 | -z] [-d] [-i inodes] [-f free_blocks]
+ *              <source dir> <image>
+ * Inputs: argc, argv: the command line
+ * Outputs: the image and a summary of its layout
+ * Return Value: 0 on success, 1 on failure
+ * Side Effects: writes the image file
+ */
+int main(int argc, char** argv) {
+  uint32_t min_inodes = DEFAULT_INODES, free_blocks = 0;
+  uint32_t i, num_files, num_inodes, data_blocks, next_block;
+  uint32_t num_ext = 0, dir_inode = 0, num_compressed = 0, total_blocks = 0;
+  uint32_t k, len;
+  int arg;
+
+  for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++) {
+    if (!strcmp(argv[arg], "-1"))
+      version = 1;
+    else if (!strcmp(argv[arg], "-3"))
+      version = 3;
+    else if (!strcmp(argv[arg], "-z"))
+      compress = 1;
+    else if (!strcmp(argv[arg], "-d"))
+      dedup = 1;
+    else if (!strcmp(argv[arg], "-i") && arg + 1 < argc)
+      min_inodes = strtoul(argv[++arg], NULL, 0);
+    else if (!strcmp(argv[arg], "-f") && arg + 1 < argc)
+      free_blocks = strtoul(argv[++arg], NULL, 0);
+    else
+      break;
+  }
+  if (argc - arg != 2 || (compress && version != 2)) {
+    fprintf(stderr,
+            "usage: %s [-1 | -3 | -z] [-d] [-i inodes] [-f free_blocks] "
+            "<source dir> <image>\n",
+            argv[0]);
+    return 1;
+  }
+  if (read_dir(argv[arg])) return 1;
+
+  for (i = 2; compress && i < num_entries; i++) {
+    if (compress_entry(&entries[i])) {
+      perror("malloc");
+      return 1;
+    }
+    if (entries[i].stream) num_compressed++;
+  }
+
+  // one inode per file, then the extended directory if the boot block is full
+  num_files = num_entries - 2;
+  num_inodes = num_files;
+  if (num_entries > NUM_DIR_ENTRY) {
+    num_ext = num_entries - NUM_DIR_ENTRY;
+    dir_inode = num_inodes++;
+  }
+  if (num_inodes < min_inodes) num_inodes = min_inodes;
+
+  // every file gets the next run of blocks, less the ones it can share
+  for (i = 2; i < num_entries; i++) total_blocks += stored_blocks(&entries[i]);
+  stored = malloc((total_blocks ? total_blocks : 1) * sizeof(stored_block_t));
+  memset(dedup_hash, 0xFF, sizeof(dedup_hash));  // every bucket is NONE
+  next_block = 0;
+  for (i = 2; i < num_entries; i++) {
+    entries[i].inode = i - 2;
+    if (stored == NULL || layout_entry(&entries[i], &next_block, dedup)) {
+      perror("malloc");
+      return 1;
+    }
+  }
+
+  // the extended directory is written after the layout, so it isn't shared
+  entry_t dir = {.size = num_ext * DIR_ENTRY_SIZE};
+  if (layout_entry(&dir, &next_block, 0)) {
+    perror("malloc");
+    return 1;
+  }
+  data_blocks = next_block + free_blocks;
+
+  uint32_t image_blocks = 1 + num_inodes + data_blocks;
+  uint8_t* image = calloc(image_blocks, BLOCK_SIZE);
+  if (image == NULL) {
+    perror("calloc");
+    return 1;
+  }
+  uint8_t* inodes = image + BLOCK_SIZE;
+  uint8_t* data = inodes + num_inodes * BLOCK_SIZE;
+
+  put32(image + BOOT_NUM_DIR_ENTRIES,
+        num_entries < NUM_DIR_ENTRY ? num_entries : NUM_DIR_ENTRY);
+  put32(image + BOOT_NUM_INODES, num_inodes);
+  put32(image + BOOT_NUM_DATA_BLOCKS, data_blocks);
+  if (version == 2) put32(image + BOOT_FS_MAGIC, FS_V2_MAGIC);
+  if (version == 3) put32(image + BOOT_FS_MAGIC, FS_V3_MAGIC);
+
+  for (i = 0; i < num_entries; i++) {
+    if (i < NUM_DIR_ENTRY)
+      write_dentry(image + BOOT_DIR_ENTRIES + i * DIR_ENTRY_SIZE, &entries[i]);
+    else
+      write_dentry(data + dir.map[(i - NUM_DIR_ENTRY) / DIR_ENTRIES_PER_BLOCK] *
+                              BLOCK_SIZE +
+                       (i - NUM_DIR_ENTRY) % DIR_ENTRIES_PER_BLOCK *
+                           DIR_ENTRY_SIZE,
+                   &entries[i]);
+    if (entries[i].file_type != FILE_TYPE_FILE) continue;
+
+    const entry_t* e = &entries[i];
+    if (write_inode(inodes + e->inode * BLOCK_SIZE, data, e->size, e->map,
+                    stored_blocks(e), e->stream ? INODE_COMPRESSED : 0))
+      return 1;
+
+    // shared blocks are written once per file, with the same contents
+    const uint8_t* src = e->stream ? e->stream : e->data;
+    uint32_t src_len = e->stream ? e->stream_len : e->size;
+    for (k = 0; k < stored_blocks(e); k++) {
+      len = src_len - k * BLOCK_SIZE < BLOCK_SIZE ? src_len - k * BLOCK_SIZE
+                                                   : BLOCK_SIZE;
+      memcpy(data + e->map[k] * BLOCK_SIZE, src + k * BLOCK_SIZE, len);
+    }
+  }
+
+  if (num_ext) {
+    put32(image + BOOT_DIR_MAGIC, DIR_EXT_MAGIC);
+    put32(image + BOOT_DIR_INODE, dir_inode);
+    if (write_inode(inodes + dir_inode * BLOCK_SIZE, data, dir.size, dir.map,
+                    num_blocks(dir.size), 0))
+      return 1;
+  }
+
+  FILE* out = fopen(argv[arg + 1], "wb");
+  if (out == NULL || fwrite(image, BLOCK_SIZE, image_blocks, out) !=
+                         image_blocks) {
+    perror(argv[arg + 1]);
+    return 1;
+  }
+  fclose(out);
+
+  printf("version %d, %u files (%u compressed), %u inodes, %u data blocks "
+         "(%u free, %u saved by sharing)\n",
+         version, num_files, num_compressed, num_inodes, data_blocks,
+         free_blocks, num_shared);
+  return 0;
+}
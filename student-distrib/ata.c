@@ -0,0 +1,204 @@
+#include "ata.h"
+
+#include "pci.h"
+
+// Global Variables
+static uint32_t ata_io = ATA_PRIMARY_IO;
+static uint32_t ata_ctrl = ATA_PRIMARY_CTRL;
+static uint32_t bm_base;      // bus master registers of the controller
+static uint32_t ata_sectors;  // size of the primary master, 0 if it is absent
+
+static prd_t prd_table[ATA_MAX_PRDS]
+    __attribute__((aligned(PRD_TABLE_ALIGN)));
+
+// written by AT_handler when a transfer completes
+static volatile uint8_t ata_irq_done;
+static volatile uint8_t ata_bm_status;
+static volatile uint8_t ata_status;
+
+/* Name: ata_delay()
+ * Description: waits about 400ns for the drive to update its status after a
+ *              drive select or command
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void ata_delay() {
+  int i;
+  for (i = 0; i < ATA_STATUS_DELAY; i++) inb(ata_ctrl);
+}
+
+/* Name: ata_poll()
+ * Description: busy waits until the drive is not busy and has set the bits
+ *              in mask, only used while identifying the drive
+ * Inputs: mask: status bits to wait for
+ * Outputs: none
+ * Return Value: 0 on success, -1 on a drive error or timeout
+ * Side Effects: none
+ */
+static int32_t ata_poll(uint32_t mask) {
+  uint32_t i, status;
+  for (i = 0; i < ATA_POLL_TRIES; i++) {
+    status = inb(ata_io + ATA_REG_STATUS);
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) return ERROR;
+    if (!(status & ATA_SR_BSY) && (status & mask) == mask) return 0;
+  }
+  return ERROR;
+}
+
+/* Name: ata_identify()
+ * Description: checks that the primary master is an ATA disk that supports
+ *              DMA and reads its size
+ * Inputs: none
+ * Outputs: none
+ * Return Value: 0 on success, -1 if there is no usable disk
+ * Side Effects: sets ata_sectors
+ */
+static int32_t ata_identify() {
+  uint16_t ident[ATA_IDENT_WORDS];
+  uint32_t i;
+
+  outb(ATA_DRIVE_MASTER, ata_io + ATA_REG_DRIVE);
+  ata_delay();
+  outb(0, ata_io + ATA_REG_SECCOUNT);
+  outb(0, ata_io + ATA_REG_LBA0);
+  outb(0, ata_io + ATA_REG_LBA1);
+  outb(0, ata_io + ATA_REG_LBA2);
+  outb(ATA_CMD_IDENTIFY, ata_io + ATA_REG_COMMAND);
+  ata_delay();
+
+  // a floating bus reads as 0, ATAPI devices abort the command
+  if (inb(ata_io + ATA_REG_STATUS) == 0) return ERROR;
+  if (ata_poll(ATA_SR_DRQ) == ERROR) return ERROR;
+
+  for (i = 0; i < ATA_IDENT_WORDS; i++) ident[i] = inw(ata_io + ATA_REG_DATA);
+
+  if (!(ident[ATA_IDENT_CAPS] & ATA_IDENT_CAPS_DMA)) return ERROR;
+  ata_sectors = ident[ATA_IDENT_SECTORS] |
+                (ident[ATA_IDENT_SECTORS + 1] << ATA_WORD_SHIFT);
+  return ata_sectors ? 0 : ERROR;
+}
+
+/* Name: ata_init()
+ * Description: finds the IDE controller on the PCI bus, turns on bus
+ *              mastering and identifies the primary master
+ * Inputs: none
+ * Outputs: none
+ * Return Value: 0 on success, -1 if there is no controller or disk
+ * Side Effects: the drive's interrupts are enabled, IRQ 14 still has to be
+ *               unmasked on the PIC
+ */
+int32_t ata_init() {
+  pci_dev_t dev;
+  ata_sectors = 0;
+
+  if (pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, &dev) == ERROR)
+    return ERROR;
+
+  // native mode channels interrupt on a PCI line instead of IRQ 14
+  if ((pci_read(&dev, PCI_REG_CLASS) >> PCI_PROG_IF_SHIFT) &
+      ATA_PROG_IF_NATIVE)
+    return ERROR;
+
+  bm_base = pci_read(&dev, PCI_REG_BAR4) & PCI_BAR_IO_MASK;
+  if (bm_base == 0) return ERROR;
+  pci_enable_bus_master(&dev);
+
+  if (ata_identify() == ERROR) {
+    ata_sectors = 0;
+    return ERROR;
+  }
+
+  outb(0, ata_ctrl);  // clear nIEN so the drive raises IRQ 14
+  return 0;
+}
+
+/* Name: ata_get_num_sectors()
+ * Description: gets the size of the disk
+ * Inputs: none
+ * Outputs: none
+ * Return Value: number of sectors, 0 if there is no disk
+ * Side Effects: none
+ */
+uint32_t ata_get_num_sectors() { return ata_sectors; }
+
+/* Name: ata_read_dma()
+ * Description: reads consecutive sectors into a list of 4 kB buffers with one
+ *              bus master DMA transfer, sleeping until the completion
+ *              interrupt. Only one transfer may be in flight, callers have to
+ *              serialize
+ * Inputs: lba: the first sector, bufs: the buffers, in kernel memory so
+ *         their addresses are physical, num_bufs: number of buffers
+ * Outputs: none
+ * Return Value: 0 on success, -1 on a bad request or a disk error
+ * Side Effects: interrupts are enabled while the transfer runs, so other
+ *               processes may be scheduled
+ */
+int32_t ata_read_dma(uint32_t lba, uint8_t* const* bufs, uint32_t num_bufs) {
+  uint32_t i, flags, wakeups, num_sectors = num_bufs * ATA_SECTORS_PER_BUF;
+
+  if (ata_sectors == 0 || num_bufs == 0 || num_bufs > ATA_MAX_PRDS)
+    return ERROR;
+  if (lba >= ata_sectors || num_sectors > ata_sectors - lba ||
+      lba + num_sectors > ATA_LBA28_MAX)
+    return ERROR;
+
+  for (i = 0; i < num_bufs; i++) {
+    prd_table[i].addr = (uint32_t)bufs[i];
+    prd_table[i].byte_count = ATA_BUF_SIZE;
+    prd_table[i].flags = (i == num_bufs - 1) ? PRD_EOT : 0;
+  }
+
+  cli_and_save(flags);
+
+  // stop any old transfer, point at the table and clear the status bits
+  outb(0, bm_base + BM_REG_CMD);
+  outl((uint32_t)prd_table, bm_base + BM_REG_PRDT);
+  outb(BM_CMD_READ, bm_base + BM_REG_CMD);
+  outb(BM_STATUS_ERR | BM_STATUS_IRQ, bm_base + BM_REG_STATUS);
+  ata_irq_done = 0;
+
+  outb(ATA_DRIVE_LBA | ((lba >> ATA_LBA_HIGH_SHIFT) & ATA_LBA_HIGH_MASK),
+       ata_io + ATA_REG_DRIVE);
+  outb(num_sectors & ATA_BYTE_MASK, ata_io + ATA_REG_SECCOUNT);
+  outb(lba & ATA_BYTE_MASK, ata_io + ATA_REG_LBA0);
+  outb((lba >> ATA_BYTE_SHIFT) & ATA_BYTE_MASK, ata_io + ATA_REG_LBA1);
+  outb((lba >> (2 * ATA_BYTE_SHIFT)) & ATA_BYTE_MASK, ata_io + ATA_REG_LBA2);
+  outb(ATA_CMD_READ_DMA, ata_io + ATA_REG_COMMAND);
+  outb(BM_CMD_READ | BM_CMD_START, bm_base + BM_REG_CMD);
+
+  // sti only takes effect after hlt, so the interrupt can't be missed
+  for (wakeups = 0; !ata_irq_done && wakeups < ATA_TIMEOUT_WAKEUPS; wakeups++)
+    asm volatile("sti; hlt; cli");
+
+  outb(BM_CMD_READ, bm_base + BM_REG_CMD);  // stop the bus master
+  int32_t ret = (ata_irq_done && !(ata_bm_status & BM_STATUS_ERR) &&
+                 !(ata_status & (ATA_SR_ERR | ATA_SR_DF)))
+                    ? 0
+                    : ERROR;
+
+  restore_flags(flags);
+  return ret;
+}
+
+/* Name: AT_handler()
+ * Description: Handles primary IDE channel interrupts after being called by
+ *              the assembly-based handler_wrapper.
+ * Inputs: None
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: Wakes up ata_read_dma when its transfer is done
+ */
+void AT_handler() {
+  uint8_t bm_status = inb(bm_base + BM_REG_STATUS);
+  ata_status = inb(ata_io + ATA_REG_STATUS);  // acknowledges the drive
+
+  if (bm_status & BM_STATUS_IRQ) {
+    ata_bm_status = bm_status;
+    outb(BM_STATUS_ERR | BM_STATUS_IRQ, bm_base + BM_REG_STATUS);
+    ata_irq_done = 1;
+  }
+
+  send_eoi(ATA_IRQ_NUM);
+}
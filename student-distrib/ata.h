@@ -0,0 +1,92 @@
+#ifndef _ATA_H
+#define _ATA_H
+
+#include "i8259.h"
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+#define ATA_IRQ_NUM 14
+
+// Primary channel in compatibility mode, the only one that is used
+#define ATA_PRIMARY_IO 0x1F0
+#define ATA_PRIMARY_CTRL 0x3F6
+#define ATA_PROG_IF_NATIVE 0x01  // primary channel uses PCI resources instead
+
+// Registers, offsets from the I/O base
+#define ATA_REG_DATA 0
+#define ATA_REG_ERROR 1
+#define ATA_REG_SECCOUNT 2
+#define ATA_REG_LBA0 3
+#define ATA_REG_LBA1 4
+#define ATA_REG_LBA2 5
+#define ATA_REG_DRIVE 6
+#define ATA_REG_STATUS 7
+#define ATA_REG_COMMAND 7
+
+// Status register bits
+#define ATA_SR_BSY 0x80
+#define ATA_SR_DF 0x20
+#define ATA_SR_DRQ 0x08
+#define ATA_SR_ERR 0x01
+
+#define ATA_CMD_IDENTIFY 0xEC
+#define ATA_CMD_READ_DMA 0xC8
+
+#define ATA_DRIVE_MASTER 0xA0
+#define ATA_DRIVE_LBA 0xE0  // master, LBA addressing
+#define ATA_LBA_HIGH_SHIFT 24
+#define ATA_LBA_HIGH_MASK 0x0F
+#define ATA_LBA28_MAX 0x10000000
+#define ATA_BYTE_MASK 0xFF
+#define ATA_BYTE_SHIFT 8
+
+// IDENTIFY data, in 16 bit words
+#define ATA_IDENT_WORDS 256
+#define ATA_IDENT_CAPS 49
+#define ATA_IDENT_CAPS_DMA 0x0100
+#define ATA_IDENT_SECTORS 60  // two words of LBA28 sectors
+#define ATA_WORD_SHIFT 16
+
+#define ATA_SECTOR_SIZE 512
+#define ATA_BUF_SIZE 4096  // every transfer is made of 4 kB buffers
+#define ATA_SECTORS_PER_BUF (ATA_BUF_SIZE / ATA_SECTOR_SIZE)
+#define ATA_STATUS_DELAY 4  // status reads needed for the drive to settle
+#define ATA_POLL_TRIES 100000
+#define ATA_TIMEOUT_WAKEUPS 1000  // interrupts to wait through for completion
+
+// Bus master IDE registers, offsets from BAR4 of the controller
+#define BM_REG_CMD 0
+#define BM_REG_STATUS 2
+#define BM_REG_PRDT 4
+#define BM_CMD_START 0x01
+#define BM_CMD_READ 0x08  // the device writes to memory
+#define BM_STATUS_ERR 0x02
+#define BM_STATUS_IRQ 0x04  // write one to clear
+
+// Physical region descriptor table, one entry per buffer
+#define ATA_MAX_PRDS 16
+#define PRD_EOT 0x8000  // last entry of the table
+#define PRD_TABLE_ALIGN 128  // keeps the table inside one 64 kB region
+
+/* --- Local Types --- */
+
+// One physically contiguous buffer of a DMA transfer
+typedef struct prd {
+  uint32_t addr;
+  uint16_t byte_count;
+  uint16_t flags;
+} __attribute__((packed)) prd_t;
+
+/* --- Function Prototypes --- */
+
+int32_t ata_init();
+uint32_t ata_get_num_sectors();
+int32_t ata_read_dma(uint32_t lba, uint8_t* const* bufs, uint32_t num_bufs);
+
+// Handles the primary channel's completion interrupt after being called by
+// the assembly-based handler_wrapper. More information above function in ata.c
+extern void AT_handler();
+
+#endif
@@ -0,0 +1,284 @@
+#include "block_cache.h"
+
+// Global Variables
+static uint8_t bcache_data[BCACHE_SIZE][BCACHE_BLOCK_SIZE]
+    __attribute__((aligned(BCACHE_BLOCK_SIZE)));
+static bcache_entry_t bcache[BCACHE_SIZE];
+static int16_t bcache_hash[BCACHE_HASH_SIZE];  // first entry of each bucket
+static int16_t lru_head, lru_tail;
+
+static uint32_t bcache_num_blocks;  // blocks on the disk
+static uint32_t bcache_num_pinned;
+static uint32_t bcache_next_seq;      // block after the last ones read
+static volatile uint8_t bcache_busy;  // a read from the disk is in flight
+static bcache_stats_t bcache_stats;
+
+/* Name: lru_remove()
+ * Description: takes an entry off the LRU list
+ * Inputs: i: index of the entry
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void lru_remove(int32_t i) {
+  if (bcache[i].prev != BCACHE_NONE)
+    bcache[bcache[i].prev].next = bcache[i].next;
+  else
+    lru_head = bcache[i].next;
+
+  if (bcache[i].next != BCACHE_NONE)
+    bcache[bcache[i].next].prev = bcache[i].prev;
+  else
+    lru_tail = bcache[i].prev;
+
+  bcache[i].prev = bcache[i].next = BCACHE_NONE;
+}
+
+/* Name: lru_push_head()
+ * Description: puts an entry at the most recently used end of the LRU list
+ * Inputs: i: index of the entry, it must not be on the list
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void lru_push_head(int32_t i) {
+  bcache[i].prev = BCACHE_NONE;
+  bcache[i].next = lru_head;
+  if (lru_head != BCACHE_NONE)
+    bcache[lru_head].prev = i;
+  else
+    lru_tail = i;
+  lru_head = i;
+}
+
+/* Name: lru_push_tail()
+ * Description: puts an entry at the end of the LRU list, so it is evicted
+ *              first
+ * Inputs: i: index of the entry, it must not be on the list
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void lru_push_tail(int32_t i) {
+  bcache[i].next = BCACHE_NONE;
+  bcache[i].prev = lru_tail;
+  if (lru_tail != BCACHE_NONE)
+    bcache[lru_tail].next = i;
+  else
+    lru_head = i;
+  lru_tail = i;
+}
+
+/* Name: hash_find()
+ * Description: finds the entry holding a block
+ * Inputs: block: the block number
+ * Outputs: none
+ * Return Value: index of the entry, -1 if the block isn't cached
+ * Side Effects: none
+ */
+static int32_t hash_find(uint32_t block) {
+  int32_t i = bcache_hash[block & BCACHE_HASH_MASK];
+  while (i != BCACHE_NONE && bcache[i].block != block) i = bcache[i].hash_next;
+  return i;
+}
+
+/* Name: hash_insert()
+ * Description: adds an entry to the bucket of its block
+ * Inputs: i: index of the entry
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void hash_insert(int32_t i) {
+  int16_t* bucket = &bcache_hash[bcache[i].block & BCACHE_HASH_MASK];
+  bcache[i].hash_next = *bucket;
+  *bucket = i;
+}
+
+/* Name: hash_remove()
+ * Description: removes an entry from the bucket of its block
+ * Inputs: i: index of the entry
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void hash_remove(int32_t i) {
+  int16_t* link = &bcache_hash[bcache[i].block & BCACHE_HASH_MASK];
+  while (*link != i) link = &bcache[*link].hash_next;
+  *link = bcache[i].hash_next;
+  bcache[i].hash_next = BCACHE_NONE;
+}
+
+/* Name: bcache_init()
+ * Description: empties the cache, call after ata_init()
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: every entry is invalidated and the counters are reset
+ */
+void bcache_init() {
+  int32_t i;
+  memset(bcache_hash, BCACHE_NONE, sizeof(bcache_hash));
+  lru_head = lru_tail = BCACHE_NONE;
+
+  for (i = 0; i < BCACHE_SIZE; i++) {
+    memset(&bcache[i], 0, sizeof(bcache_entry_t));
+    bcache[i].hash_next = BCACHE_NONE;
+    lru_push_tail(i);
+  }
+
+  bcache_num_blocks = ata_get_num_sectors() / ATA_SECTORS_PER_BUF;
+  bcache_num_pinned = 0;
+  bcache_next_seq = 0;  // reading from the start of the disk is sequential
+  bcache_busy = 0;
+  memset(&bcache_stats, 0, sizeof(bcache_stats));
+}
+
+/* Name: bcache_get_num_blocks()
+ * Description: gets the size of the disk in blocks
+ * Inputs: none
+ * Outputs: none
+ * Return Value: number of blocks, 0 if there is no disk
+ * Side Effects: none
+ */
+uint32_t bcache_get_num_blocks() { return bcache_num_blocks; }
+
+/* Name: bcache_fill()
+ * Description: reads a block that missed into the least recently used entry.
+ *              If the block follows the last ones read, the blocks after it
+ *              that aren't cached are read in the same transfer
+ * Inputs: block: the block number
+ * Outputs: none
+ * Return Value: index of the entry, -1 on a disk error
+ * Side Effects: evicts entries, sleeps until the disk is done, must be called
+ *               with interrupts disabled
+ */
+static int32_t bcache_fill(uint32_t block) {
+  static int32_t victims[BCACHE_READAHEAD];
+  static uint8_t* bufs[BCACHE_READAHEAD];
+  uint32_t n, count = 1;
+  int32_t i;
+
+  // one read at a time, another process may bring the block in meanwhile
+  while (bcache_busy) asm volatile("sti; hlt; cli");
+  if ((i = hash_find(block)) != BCACHE_NONE) {
+    if (!bcache[i].pinned) {
+      lru_remove(i);
+      lru_push_head(i);
+    }
+    return i;
+  }
+
+  if (block == bcache_next_seq) count = BCACHE_READAHEAD;
+  if (count > bcache_num_blocks - block) count = bcache_num_blocks - block;
+  for (n = 1; n < count && hash_find(block + n) == BCACHE_NONE; n++)
+    ;
+  count = n;
+
+  // take the least recently used entries off the lists while they are read
+  // into, pinned entries aren't on the LRU list so there are always enough
+  bcache_busy = 1;
+  for (n = 0; n < count; n++) {
+    victims[n] = lru_tail;
+    lru_remove(victims[n]);
+    if (bcache[victims[n]].valid) hash_remove(victims[n]);
+    bcache[victims[n]].valid = 0;
+    bufs[n] = bcache_data[victims[n]];
+  }
+
+  if (ata_read_dma(block * ATA_SECTORS_PER_BUF, bufs, count) == ERROR) {
+    for (n = 0; n < count; n++) lru_push_tail(victims[n]);
+    bcache_busy = 0;
+    return BCACHE_NONE;
+  }
+
+  // the read ahead blocks go in just behind the block that was asked for
+  for (n = count; n-- > 0;) {
+    bcache[victims[n]].block = block + n;
+    bcache[victims[n]].valid = 1;
+    bcache[victims[n]].readahead = (n != 0);
+    hash_insert(victims[n]);
+    lru_push_head(victims[n]);
+  }
+
+  bcache_stats.readahead += count - 1;
+  bcache_next_seq = block + count;
+  bcache_busy = 0;
+  return victims[0];
+}
+
+/* Name: bcache_get()
+ * Description: gets a block of the disk through the cache
+ * Inputs: block: the block number
+ * Outputs: none
+ * Return Value: pointer to the cached block, NULL past the end of the disk or
+ *               on a disk error. It stays valid until the next miss
+ * Side Effects: a miss sleeps until the disk is done, other processes may run
+ */
+uint8_t* bcache_get(uint32_t block) {
+  uint32_t flags;
+  int32_t i;
+  if (block >= bcache_num_blocks) return NULL;
+
+  cli_and_save(flags);
+
+  i = hash_find(block);
+  if (i != BCACHE_NONE) {
+    bcache_stats.hits++;
+    if (bcache[i].readahead) {
+      bcache_stats.readahead_hits++;
+      bcache[i].readahead = 0;
+    }
+    if (!bcache[i].pinned) {
+      lru_remove(i);
+      lru_push_head(i);
+    }
+  } else {
+    bcache_stats.misses++;
+    i = bcache_fill(block);
+  }
+
+  restore_flags(flags);
+  return (i == BCACHE_NONE) ? NULL : bcache_data[i];
+}
+
+/* Name: bcache_pin()
+ * Description: gets a block of the disk and keeps it in the cache for good,
+ *              for blocks such as the boot block that are used all the time
+ * Inputs: block: the block number
+ * Outputs: none
+ * Return Value: pointer to the cached block, NULL on failure or if too many
+ *               blocks are pinned
+ * Side Effects: the entry is taken off the LRU list
+ */
+uint8_t* bcache_pin(uint32_t block) {
+  uint32_t flags;
+  uint8_t* data = NULL;
+  int32_t i;
+
+  cli_and_save(flags);
+
+  if (bcache_num_pinned < BCACHE_MAX_PINNED &&
+      (data = bcache_get(block)) != NULL) {
+    i = hash_find(block);
+    if (!bcache[i].pinned) {
+      lru_remove(i);
+      bcache[i].pinned = 1;
+      bcache_num_pinned++;
+    }
+  }
+
+  restore_flags(flags);
+  return data;
+}
+
+/* Name: get_bcache_stats()
+ * Description: copies out the block cache counters
+ * Inputs: stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_bcache_stats(bcache_stats_t* stats) {
+  memcpy(stats, &bcache_stats, sizeof(bcache_stats_t));
+}
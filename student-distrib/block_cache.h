@@ -0,0 +1,50 @@
+#ifndef _BLOCK_CACHE_H
+#define _BLOCK_CACHE_H
+
+#include "ata.h"
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// Blocks are the file system's 4 kB blocks, block b starts at sector b * 8
+#define BCACHE_BLOCK_SIZE ATA_BUF_SIZE
+#define BCACHE_SIZE 32  // cached blocks, 128 kB
+#define BCACHE_HASH_SIZE 64
+#define BCACHE_HASH_MASK (BCACHE_HASH_SIZE - 1)
+#define BCACHE_NONE (-1)  // end of the LRU list or a hash chain
+#define BCACHE_MAX_PINNED (BCACHE_SIZE / 2)
+
+// A miss on the block right after the last blocks read is read together with
+// the blocks that follow it
+#define BCACHE_READAHEAD 8
+
+/* --- Local Types --- */
+
+typedef struct bcache_entry {
+  uint32_t block;
+  int16_t prev;       // LRU list, the head is the most recently used
+  int16_t next;
+  int16_t hash_next;  // next entry in the same hash bucket
+  uint8_t valid;
+  uint8_t pinned;     // never evicted, not on the LRU list
+  uint8_t readahead;  // read ahead of a miss and not used yet
+} bcache_entry_t;
+
+// Counters for bcache_get
+typedef struct bcache_stats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t readahead;       // blocks read ahead of a sequential miss
+  uint32_t readahead_hits;  // read ahead blocks that were used later
+} bcache_stats_t;
+
+/* --- Function Prototypes --- */
+
+void bcache_init();
+uint32_t bcache_get_num_blocks();
+uint8_t* bcache_get(uint32_t block);
+uint8_t* bcache_pin(uint32_t block);
+void get_bcache_stats(bcache_stats_t* stats);
+
+#endif
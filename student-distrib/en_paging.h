@@ -4,5 +4,6 @@
 #include "types.h"
 
 extern void enable_paging(uint32_t page_dir_ptr);
+extern void load_page_dir(uint32_t page_dir_ptr);
 
 #endif
@@ -1,46 +1,993 @@
 #include "file_system.h"
+#include "block_cache.h"
+#include "lz.h"
+#include "vfs.h"
+#include "zcache.h"
 
-// Global Variables
-uint32_t file_system_addr;
-boot_block_t* boot_block;
+/* Name: dentry_name_hash()
+ * Description: FNV-1a hash of a file name, stops at the first null or after
+ *              FILE_NAME_SIZE characters, matching how names are compared
+ * Inputs: fname: the file name to hash
+ * Outputs: none
+ * Return Value: 32 bit hash of the name
+ * Side Effects: none
+ */
+uint32_t dentry_name_hash(const uint8_t* fname) {
+  uint32_t hash = FNV_OFFSET_BASIS;
+  int i;
+  for (i = 0; i < FILE_NAME_SIZE && fname[i] != '\0'; i++) {
+    hash ^= fname[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/* Name: dentry_index_insert()
+ * Description: adds a directory entry to the name hash index and filter
+ * Inputs: fs: the mounted image
+ *         index: index of the entry in dir_entries
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: updates dentry_hash_table and dentry_filter
+ */
+static void dentry_index_insert(fs_t* fs, uint32_t index) {
+  uint32_t hash = dentry_name_hash((uint8_t*)fs->dir_entries[index].file_name);
+  uint32_t slot = hash & DENTRY_HASH_MASK;
+
+  // linear probe to the first open slot
+  while (fs->dentry_hash_table[slot] != DENTRY_HASH_EMPTY)
+    slot = (slot + 1) & DENTRY_HASH_MASK;
+  fs->dentry_hash_table[slot] = index;
+
+  hash %= DENTRY_FILTER_BITS;
+  fs->dentry_filter[hash / 32] |= (1u << (hash % 32));
+}
+
+/* Name: dentry_index_build()
+ * Description: builds the name hash index over every directory entry
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: resets the index and its lookup counters
+ */
+static void dentry_index_build(fs_t* fs) {
+  int i;
+  memset(fs->dentry_hash_table, DENTRY_HASH_EMPTY,
+         sizeof(fs->dentry_hash_table));
+  memset(fs->dentry_filter, 0, sizeof(fs->dentry_filter));
+
+  for (i = 0; i < fs->num_dir_entries; i++) dentry_index_insert(fs, i);
+}
+
+/* Name: dentry_index_lookup()
+ * Description: finds a file name in the directory name hash index
+ * Inputs: fs: the mounted image
+ *         fname: the file name to look for, filtered: set to 1 if the filter
+ *         ruled the name out without probing
+ * Outputs: none
+ * Return Value: index of the entry in dir_entries, -1 if it doesn't exist
+ * Side Effects: counts hits, misses are counted by dentry_lookup once the
+ *               extended directory has been searched too
+ */
+static int32_t dentry_index_lookup(fs_t* fs, const uint8_t* fname,
+                                   int32_t* filtered) {
+  uint32_t hash = dentry_name_hash(fname);
+  uint32_t filter_bit = hash % DENTRY_FILTER_BITS;
+
+  // no name in the directory hashes to this bit, so it can't be there
+  *filtered = !(fs->dentry_filter[filter_bit / 32] & (1u << (filter_bit % 32)));
+  if (*filtered) return -1;
+
+  // probe until the name matches or an empty slot ends the chain
+  uint32_t slot = hash & DENTRY_HASH_MASK;
+  int32_t i;
+  while ((i = fs->dentry_hash_table[slot]) != DENTRY_HASH_EMPTY) {
+    if (!strncmp((int8_t*)fname, fs->dir_entries[i].file_name,
+                 FILE_NAME_SIZE)) {
+      fs->dentry_stats.hits++;
+      return i;
+    }
+    slot = (slot + 1) & DENTRY_HASH_MASK;
+  }
+  return -1;
+}
+
+/* Name: fs_block()
+ * Description: gets a block of the image, straight from memory or through the
+ *              block cache for an image on the disk
+ * Inputs: fs: the mounted image
+ *         block: the block number, the boot block is block 0
+ * Outputs: none
+ * Return Value: pointer to the block, NULL if the disk can't be read
+ * Side Effects: a cache miss sleeps until the disk is done
+ */
+static uint8_t* fs_block(fs_t* fs, uint32_t block) {
+  if (fs->on_disk) return bcache_get(block);
+  return (uint8_t*)(fs->file_system_addr + block * BLOCK_SIZE_BYTES);
+}
+
+/* Name: fs_inode()
+ * Description: gets an inode of the image
+ * Inputs: fs: the mounted image
+ *         inode: the index of the inode
+ * Outputs: none
+ * Return Value: pointer to the inode, NULL if the disk can't be read
+ * Side Effects: none
+ */
+static inode_t* fs_inode(fs_t* fs, uint32_t inode) {
+  return (inode_t*)fs_block(fs, FS_INODE_START + inode);
+}
+
+/* Name: fs_data_block()
+ * Description: gets a data block of the image
+ * Inputs: fs: the mounted image
+ *         block: the index of the data block
+ * Outputs: none
+ * Return Value: pointer to the block, NULL if the disk can't be read
+ * Side Effects: none
+ */
+static uint8_t* fs_data_block(fs_t* fs, uint32_t block) {
+  return fs_block(fs, fs->data_start + block);
+}
+
+/* Name: bitmap_alloc()
+ * Description: finds a clear bit in a bitmap and sets it, starting the search
+ *              at the word in hint and wrapping around
+ * Inputs: bitmap: the bitmap to search, num_bits: number of valid bits,
+ *         hint: word to start at, updated to where the bit was found
+ * Outputs: none
+ * Return Value: the index of the bit that was set, -1 if all are set
+ * Side Effects: sets the bit that was found
+ */
+static int32_t bitmap_alloc(uint32_t* bitmap, uint32_t num_bits,
+                            uint32_t* hint) {
+  uint32_t num_words = (num_bits + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+  uint32_t i, bit, word;
+
+  for (i = 0; i < num_words; i++) {
+    word = (*hint + i) % num_words;
+    if (bitmap[word] == BITMAP_FULL_WORD) continue;
+
+    for (bit = 0; bit < BITMAP_WORD_BITS; bit++) {
+      if (bitmap[word] & (1u << bit)) continue;
+      if (word * BITMAP_WORD_BITS + bit >= num_bits) break;
+      bitmap[word] |= (1u << bit);
+      *hint = word;
+      return word * BITMAP_WORD_BITS + bit;
+    }
+  }
+  return NO_FREE_BLOCK;
+}
+
+/* Name: alloc_data_block()
+ * Description: allocates a free data block, preferring the block right after
+ *              prev so files stay contiguous for read_data
+ * Inputs: fs: the mounted image
+ *         prev: the file's previous block, or -1 if it has none
+ * Outputs: none
+ * Return Value: index of the allocated block, -1 if the image is full
+ * Side Effects: marks the block used in the free block bitmap
+ */
+static int32_t alloc_data_block(fs_t* fs, int32_t prev) {
+  int32_t block;
+  uint32_t next = prev + 1;
+
+  if (prev >= 0 && next < fs->alloc_data_blocks &&
+      !(fs->data_block_bitmap[next / BITMAP_WORD_BITS] &
+        (1u << (next % BITMAP_WORD_BITS)))) {
+    fs->data_block_bitmap[next / BITMAP_WORD_BITS] |=
+        (1u << (next % BITMAP_WORD_BITS));
+    block = next;
+  } else {
+    block = bitmap_alloc(fs->data_block_bitmap, fs->alloc_data_blocks,
+                         &fs->data_block_hint);
+    if (block == NO_FREE_BLOCK) return NO_FREE_BLOCK;
+  }
+
+  fs->data_block_refs[block] = 1;
+  fs->num_free_data_blocks--;
+  return block;
+}
+
+/* Name: free_data_block()
+ * Description: drops a file's reference to a data block, returning it to the
+ *              free block bitmap once no file uses it
+ * Inputs: fs: the mounted image
+ *         block: index of the block to free
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: clears the block's bit in the free block bitmap
+ */
+static void free_data_block(fs_t* fs, uint32_t block) {
+  if (block >= fs->alloc_data_blocks) return;  // corrupt inode or untracked
+  uint8_t refs = fs->data_block_refs[block];
+  if (refs == 0 || refs == FS_MAX_BLOCK_REFS) return;  // free or stuck
+  if (--fs->data_block_refs[block] == 1) fs->num_shared_data_blocks--;
+  if (fs->data_block_refs[block] > 0) return;
+  if (fs->data_block_maps[block] > 0) return;  // unmap_data_block frees it
+
+  fs->data_block_bitmap[block / BITMAP_WORD_BITS] &=
+      ~(1u << (block % BITMAP_WORD_BITS));
+  fs->num_free_data_blocks++;
+}
+
+/* Name: ind_table()
+ * Description: finds the block of indices that maps a block of a file past
+ *              the direct blocks, through the table cached for the file when
+ *              it covers the block
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the block in the file, at
+ *         least DIRECT_BLOCKS, cache: the file's cached table or NULL,
+ *         first: set to the index in the file of the block table[0] maps
+ * Outputs: none
+ * Return Value: pointer to the table, NULL if the inode doesn't have one for
+ *               idx or the disk can't be read
+ * Side Effects: fills the cache and updates the counters
+ */
+static uint32_t* ind_table(fs_t* fs, inode_t* node, uint32_t idx,
+                           ind_cache_t* cache, uint32_t* first) {
+  uint32_t block, slot;
+  uint32_t* parent;
+
+  if (cache != NULL && cache->gen == fs->ind_gen && idx >= cache->first &&
+      idx - cache->first < INDICES_PER_BLOCK) {
+    fs->ind_stats.hits++;
+    *first = cache->first;
+    return (uint32_t*)fs_data_block(fs, cache->block);
+  }
+  fs->ind_stats.misses++;
+
+  if (idx < IND_LIMIT) {
+    block = node->data_block_indices[IND_SLOT];
+    *first = DIRECT_BLOCKS;
+  } else {
+    if (idx >= DIND_LIMIT) return NULL;
+    slot = (idx - IND_LIMIT) / INDICES_PER_BLOCK;
+    if (node->data_block_indices[DIND_SLOT] >= fs->num_data_blocks)
+      return NULL;  // corrupt inode
+    parent = (uint32_t*)fs_data_block(fs, node->data_block_indices[DIND_SLOT]);
+    if (parent == NULL) return NULL;
+    block = parent[slot];
+    *first = IND_LIMIT + slot * INDICES_PER_BLOCK;
+  }
+  if (block >= fs->num_data_blocks) return NULL;  // corrupt inode
+
+  if (cache != NULL) {
+    cache->gen = fs->ind_gen;
+    cache->first = *first;
+    cache->block = block;
+  }
+  return (uint32_t*)fs_data_block(fs, block);
+}
+
+/* Name: max_file_size()
+ * Description: gets the largest file the image's inodes can describe
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: the size in bytes, version 2 and 3 files can use every
+ *               data block the bitmap tracks
+ * Side Effects: none
+ */
+static uint32_t max_file_size(fs_t* fs) {
+  if (fs->extents || fs->indirect)
+    return FS_MAX_DATA_BLOCKS * BLOCK_SIZE_BYTES;
+  return DATA_BLOCK * BLOCK_SIZE_BYTES;
+}
+
+/* Name: inode_indices()
+ * Description: gets a file's block indices as an array of words, inodes are
+ *              packed but start on a block so the indices are aligned
+ * Inputs: node: the file's inode
+ * Outputs: none
+ * Return Value: pointer to the indices
+ * Side Effects: none
+ */
+static uint32_t* inode_indices(inode_t* node) {
+  return (uint32_t*)node->val + 1;  // the word after length_in_bytes
+}
+
+/* Name: inode_get_run()
+ * Description: finds the data block that holds a block of a file, and how
+ *              many of the file's blocks after it follow it in the image
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the block in the file,
+ *         num_blocks: number of blocks in the file, block: set to the index
+ *         of the data block, cache: the file's cached indirect block or NULL
+ * Outputs: none
+ * Return Value: number of contiguous blocks starting at idx, up to the end
+ *               of its block of indices, -1 if the inode doesn't map idx to a
+ *               block in the image
+ * Side Effects: none
+ */
+static int32_t inode_get_run(fs_t* fs, inode_t* node, uint32_t idx,
+                             uint32_t num_blocks, uint32_t* block,
+                             ind_cache_t* cache) {
+  uint32_t i, run;
+  if (idx >= num_blocks) return ERROR;
+
+  if (fs->extents) {
+    // skip whole extents until the one holding idx
+    for (i = 0, run = idx; i < node->num_extents && i < MAX_EXTENTS; i++) {
+      if (run < node->extents[i].length) break;
+      run -= node->extents[i].length;
+    }
+    if (i == node->num_extents || i == MAX_EXTENTS) return ERROR;
+
+    *block = node->extents[i].start + run;
+    if (*block >= fs->num_data_blocks) return ERROR;  // corrupt inode
+    run = node->extents[i].length - run;
+  } else {
+    // the direct indices, or the block of indices holding idx
+    uint32_t* indices = inode_indices(node);
+    uint32_t first = 0, count = fs->indirect ? DIRECT_BLOCKS : DATA_BLOCK;
+    if (idx >= count) {
+      if (!fs->indirect) return ERROR;
+      indices = ind_table(fs, node, idx, cache, &first);
+      if (indices == NULL) return ERROR;
+      count = INDICES_PER_BLOCK;
+    }
+
+    i = idx - first;
+    *block = indices[i];
+    if (*block >= fs->num_data_blocks) return ERROR;  // corrupt inode
+
+    // extend the run while the next block follows directly in the image
+    for (run = 1; idx + run < num_blocks && i + run < count; run++)
+      if (indices[i + run] != *block + run) break;
+  }
+
+  if (run > num_blocks - idx) run = num_blocks - idx;
+  if (run > fs->num_data_blocks - *block) run = fs->num_data_blocks - *block;
+  return run;
+}
+
+/* Name: inode_get_block()
+ * Description: finds the data block that holds a block of a file
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the block in the file
+ * Outputs: none
+ * Return Value: index of the data block, -1 if the inode doesn't map idx to a
+ *               block in the image
+ * Side Effects: none
+ */
+static int32_t inode_get_block(fs_t* fs, inode_t* node, uint32_t idx) {
+  uint32_t block;
+  if (inode_get_run(fs, node, idx, idx + 1, &block, NULL) == ERROR)
+    return ERROR;
+  return block;
+}
+
+/* Name: ind_child()
+ * Description: gets the block of indices an index in a parent points at,
+ *              allocating an empty one first if asked to
+ * Inputs: fs: the mounted image
+ *         parent: the parent's indices, slot: which index,
+ *         create: 1 to allocate the block
+ * Outputs: none
+ * Return Value: pointer to the block of indices, NULL if it isn't in the
+ *               image or the image is full
+ * Side Effects: a new block drops the tables cached for open files
+ */
+static uint32_t* ind_child(fs_t* fs, uint32_t* parent, uint32_t slot,
+                           int32_t create) {
+  if (create) {
+    int32_t block = alloc_data_block(fs, NO_FREE_BLOCK);
+    if (block == NO_FREE_BLOCK) return NULL;
+    memset(fs_data_block(fs, block), 0, BLOCK_SIZE_BYTES);
+    parent[slot] = block;
+    fs->ind_gen++;
+  }
+  if (parent[slot] >= fs->num_data_blocks) return NULL;  // corrupt inode
+  return (uint32_t*)fs_data_block(fs, parent[slot]);
+}
+
+/* Name: ind_set()
+ * Description: sets the index of a block of a version 3 file, allocating
+ *              the blocks of indices it needs when appending
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the block in the file,
+ *         block: index of the data block, append: 1 if idx is the block
+ *         after the end of the file
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the file is too large or the image is
+ *               full
+ * Side Effects: may allocate blocks of indices
+ */
+static int32_t ind_set(fs_t* fs, inode_t* node, uint32_t idx, uint32_t block,
+                       int32_t append) {
+  uint32_t* indices = inode_indices(node);
+  uint32_t* parent;
+  uint32_t pos;
+
+  if (idx < DIRECT_BLOCKS) {
+    indices[idx] = block;
+    return 0;
+  }
+  if (idx >= DIND_LIMIT) return ERROR;
+
+  if (idx < IND_LIMIT) {
+    pos = idx - DIRECT_BLOCKS;
+    indices = ind_child(fs, indices, IND_SLOT, append && pos == 0);
+  } else {
+    pos = idx - IND_LIMIT;
+    parent = ind_child(fs, indices, DIND_SLOT, append && pos == 0);
+    if (parent == NULL) return ERROR;
+    indices = ind_child(fs, parent, pos / INDICES_PER_BLOCK,
+                        append && pos % INDICES_PER_BLOCK == 0);
+    if (indices == NULL && append && pos == 0)
+      free_data_block(fs, node->data_block_indices[DIND_SLOT]);
+    pos %= INDICES_PER_BLOCK;
+  }
+  if (indices == NULL) return ERROR;
+
+  indices[pos] = block;
+  return 0;
+}
+
+/* Name: ind_pop()
+ * Description: removes the last block of a version 3 file past the direct
+ *              blocks, freeing the blocks of indices that become empty
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the last block in the file
+ * Outputs: none
+ * Return Value: index of the data block that was removed, -1 if the inode
+ *               doesn't map it
+ * Side Effects: drops the tables cached for open files when one is freed
+ */
+static uint32_t ind_pop(fs_t* fs, inode_t* node, uint32_t idx) {
+  uint32_t* indices = inode_indices(node);
+  uint32_t* parent;
+  uint32_t first, pos;
+
+  uint32_t* table = ind_table(fs, node, idx, NULL, &first);
+  uint32_t block = table ? table[idx - first] : (uint32_t)NO_FREE_BLOCK;
+
+  if (idx == DIRECT_BLOCKS) {
+    free_data_block(fs, indices[IND_SLOT]);
+    fs->ind_gen++;
+  } else if (idx >= IND_LIMIT && (idx - IND_LIMIT) % INDICES_PER_BLOCK == 0) {
+    pos = (idx - IND_LIMIT) / INDICES_PER_BLOCK;
+    if ((parent = ind_child(fs, indices, DIND_SLOT, 0)) != NULL)
+      free_data_block(fs, parent[pos]);
+    if (pos == 0) free_data_block(fs, indices[DIND_SLOT]);
+    fs->ind_gen++;
+  }
+  return block;
+}
+
+/* Name: inode_append_block()
+ * Description: adds a data block to the end of a file, growing its last
+ *              extent when the block follows it
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, num_blocks: number of blocks in the file,
+ *         block: index of the data block to add
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the inode has no room left
+ * Side Effects: version 3 files may allocate blocks of indices
+ */
+static int32_t inode_append_block(fs_t* fs, inode_t* node,
+                                  uint32_t num_blocks, uint32_t block) {
+  if (!fs->extents) {
+    if (fs->indirect) return ind_set(fs, node, num_blocks, block, 1);
+    if (num_blocks >= DATA_BLOCK) return ERROR;
+    node->data_block_indices[num_blocks] = block;
+    return 0;
+  }
+
+  if (node->num_extents > 0) {
+    extent_t* last = &node->extents[node->num_extents - 1];
+    if (last->start + last->length == block) {
+      last->length++;
+      return 0;
+    }
+  }
+  if (node->num_extents >= MAX_EXTENTS) return ERROR;
+
+  node->extents[node->num_extents].start = block;
+  node->extents[node->num_extents].length = 1;
+  node->num_extents++;
+  return 0;
+}
+
+/* Name: inode_pop_block()
+ * Description: removes the last data block of a file
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, num_blocks: number of blocks in the file,
+ *         at least 1
+ * Outputs: none
+ * Return Value: index of the data block that was removed
+ * Side Effects: version 3 files may free blocks of indices
+ */
+static uint32_t inode_pop_block(fs_t* fs, inode_t* node, uint32_t num_blocks) {
+  if (!fs->extents) {
+    if (fs->indirect && num_blocks > DIRECT_BLOCKS)
+      return ind_pop(fs, node, num_blocks - 1);
+    return node->data_block_indices[num_blocks - 1];
+  }
+
+  extent_t* last = &node->extents[node->num_extents - 1];
+  uint32_t block = last->start + --last->length;
+  if (last->length == 0) node->num_extents--;
+  return block;
+}
+
+/* Name: inode_clear()
+ * Description: empties a newly allocated inode
+ * Inputs: fs: the mounted image
+ *         inode: the index of the inode
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void inode_clear(fs_t* fs, uint32_t inode) {
+  inode_t* node = fs_inode(fs, inode);
+  node->length_in_bytes = 0;
+  if (fs->extents) {
+    node->num_extents = 0;
+    node->inode_flags = 0;
+  }
+}
+
+/* Name: inode_compressed()
+ * Description: checks if a file's blocks are compressed
+ * Inputs: fs: the mounted image
+ *         node: the file's inode
+ * Outputs: none
+ * Return Value: 1 if they are, 0 if not
+ * Side Effects: none
+ */
+static int32_t inode_compressed(fs_t* fs, inode_t* node) {
+  return fs->extents && (node->inode_flags & INODE_COMPRESSED);
+}
+
+/* Name: inode_num_blocks()
+ * Description: counts the data blocks a file takes up in the image, fewer
+ *              than its length needs when it is compressed
+ * Inputs: fs: the mounted image
+ *         node: the file's inode
+ * Outputs: none
+ * Return Value: number of data blocks
+ * Side Effects: none
+ */
+static uint32_t inode_num_blocks(fs_t* fs, inode_t* node) {
+  uint32_t i, num_blocks = 0;
+  if (!inode_compressed(fs, node))
+    return (node->length_in_bytes + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
+
+  for (i = 0; i < node->num_extents && i < MAX_EXTENTS; i++)
+    num_blocks += node->extents[i].length;
+  return num_blocks;
+}
+
+/* Name: compressed_block()
+ * Description: gets a block of a compressed file, decompressing it into the
+ *              zcache the first time it is read
+ * Inputs: fs: the mounted image
+ *         inode: the index of the file's inode, node: the inode,
+ *         idx: index of the block in the file
+ * Outputs: none
+ * Return Value: pointer to the block's data, NULL if the file is corrupt
+ * Side Effects: may evict another decompressed block
+ */
+static uint8_t* compressed_block(fs_t* fs, uint32_t inode, inode_t* node,
+                                 uint32_t idx) {
+  uint8_t* block = zcache_find(fs, inode, idx);
+  if (block != NULL) return block;
+
+  // the stream is one extent, so in memory its offsets can be used directly
+  if (fs->on_disk || node->num_extents != 1 ||
+      node->extents[0].start >= fs->num_data_blocks ||
+      node->extents[0].length > fs->num_data_blocks - node->extents[0].start)
+    return NULL;
+  uint8_t* stream = fs_data_block(fs, node->extents[0].start);
+  uint32_t stream_len = node->extents[0].length * BLOCK_SIZE_BYTES;
+
+  uint32_t file_len = node->length_in_bytes;
+  uint32_t num_blocks = (file_len + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
+  uint32_t table_len = (num_blocks + 1) * sizeof(uint32_t);
+  uint32_t* table = (uint32_t*)stream;
+  if (idx >= num_blocks || table_len > stream_len) return NULL;
+
+  uint32_t start = table[idx], end = table[idx + 1];
+  if (start < table_len || start > end || end > stream_len) return NULL;
+
+  uint32_t len = BLOCK_SIZE_BYTES;
+  if (idx == num_blocks - 1) len = file_len - idx * BLOCK_SIZE_BYTES;
+
+  // blocks that didn't shrink are stored as they are
+  block = zcache_alloc(fs, inode, idx);
+  if (end - start == len) {
+    memcpy(block, stream + start, len);
+  } else if (lz_decompress(stream + start, end - start, block, len) != len) {
+    zcache_invalidate(fs, inode);
+    return NULL;
+  }
+  return block;
+}
+
+/* Name: ext_dentry()
+ * Description: finds an entry of the extended directory in its data blocks
+ * Inputs: fs: the mounted image
+ *         index: index of the entry in the extended directory
+ * Outputs: none
+ * Return Value: pointer to the entry, NULL if the disk can't be read
+ * Side Effects: none
+ */
+static dir_entry_t* ext_dentry(fs_t* fs, uint32_t index) {
+  inode_t* dir_node = fs_inode(fs, fs->dir_inode);
+  if (dir_node == NULL) return NULL;
+
+  int32_t block_idx =
+      inode_get_block(fs, dir_node, index / DIR_ENTRIES_PER_BLOCK);
+  if (block_idx == ERROR) return NULL;
+
+  uint8_t* block = fs_data_block(fs, block_idx);
+  if (block == NULL) return NULL;
+  return (dir_entry_t*)block + index % DIR_ENTRIES_PER_BLOCK;
+}
+
+/* Name: get_dentry()
+ * Description: finds a directory entry by position, the boot block entries
+ *              come first and then the extended directory in name order
+ * Inputs: fs: the mounted image
+ *         pos: position of the entry in the directory
+ * Outputs: none
+ * Return Value: pointer to the entry, NULL past the end of the directory or
+ *               if the disk can't be read
+ * Side Effects: none
+ */
+static dir_entry_t* get_dentry(fs_t* fs, uint32_t pos) {
+  if (pos < fs->num_dir_entries) return &fs->dir_entries[pos];
+  pos -= fs->num_dir_entries;
+  if (pos < fs->num_ext_entries) return ext_dentry(fs, pos);
+  return NULL;
+}
+
+/* Name: ext_dentry_search()
+ * Description: binary searches the sorted extended directory for a name
+ * Inputs: fs: the mounted image
+ *         fname: the file name to look for, found: set to 1 if it exists
+ * Outputs: none
+ * Return Value: index of the entry, or where it would be inserted if it
+ *               doesn't exist
+ * Side Effects: none
+ */
+static uint32_t ext_dentry_search(fs_t* fs, const uint8_t* fname,
+                                  int32_t* found) {
+  uint32_t lo = 0, hi = fs->num_ext_entries, mid;
+  dir_entry_t* entry;
+  int32_t cmp;
+
+  *found = 0;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if ((entry = ext_dentry(fs, mid)) == NULL) break;  // disk error
+    cmp = strncmp((int8_t*)fname, entry->file_name, FILE_NAME_SIZE);
+    if (cmp == 0) {
+      *found = 1;
+      return mid;
+    }
+    if (cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+/* Name: dentry_lookup()
+ * Description: finds a file name in the boot block through the hash index,
+ *              then in the extended directory
+ * Inputs: fs: the mounted image
+ *         fname: the file name to look for
+ * Outputs: none
+ * Return Value: position of the entry in the directory, -1 if it doesn't exist
+ * Side Effects: updates the lookup counters
+ */
+static int32_t dentry_lookup(fs_t* fs, const uint8_t* fname) {
+  int32_t found, filtered, i = dentry_index_lookup(fs, fname, &filtered);
+  if (i != -1) return i;
+
+  if (fs->dir_inode != -1) {
+    i = ext_dentry_search(fs, fname, &found);
+    if (found) {
+      fs->dentry_stats.ext_hits++;
+      return fs->num_dir_entries + i;
+    }
+  }
+
+  // in neither the boot block nor the extended directory
+  fs->dentry_stats.misses++;
+  if (filtered) fs->dentry_stats.filtered++;
+  return -1;
+}
+
+/* Name: inode_set_block()
+ * Description: points a block of a file at another data block, splitting
+ *              the extent that held it
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the block in the file, it
+ *         must be mapped, block: index of the new data block
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the inode has no room for the extents
+ * Side Effects: none
+ */
+static int32_t inode_set_block(fs_t* fs, inode_t* node, uint32_t idx,
+                               uint32_t block) {
+  uint32_t i, run = idx;
+  if (!fs->extents) {
+    if (fs->indirect) return ind_set(fs, node, idx, block, 0);
+    node->data_block_indices[idx] = block;
+    return 0;
+  }
+
+  for (i = 0; i < node->num_extents && i < MAX_EXTENTS; i++) {
+    if (run < node->extents[i].length) break;
+    run -= node->extents[i].length;
+  }
+  if (i == node->num_extents || i == MAX_EXTENTS) return ERROR;
+
+  // the blocks before idx, the new block and the blocks after it
+  extent_t old = node->extents[i];
+  uint32_t pieces = (run > 0) + 1 + (run + 1 < old.length);
+  if (node->num_extents + pieces - 1 > MAX_EXTENTS) return ERROR;
+  memmove(&node->extents[i + pieces], &node->extents[i + 1],
+          (node->num_extents - i - 1) * sizeof(extent_t));
+  node->num_extents += pieces - 1;
+
+  if (run > 0) node->extents[i++].length = run;
+  node->extents[i].start = block;
+  node->extents[i++].length = 1;
+  if (run + 1 < old.length) {
+    node->extents[i].start = old.start + run + 1;
+    node->extents[i].length = old.length - run - 1;
+  }
+  return 0;
+}
+
+/* Name: inode_own_block()
+ * Description: makes a block of a file private before it is written, giving
+ *              the file its own copy if other files share the data block
+ * Inputs: fs: the mounted image
+ *         node: the file's inode, idx: index of the block in the file
+ * Outputs: none
+ * Return Value: index of the data block to write, -1 if the block isn't
+ *               mapped or it is shared and can't be copied
+ * Side Effects: may allocate a data block and drop a reference to the shared
+ *               one
+ */
+static int32_t inode_own_block(fs_t* fs, inode_t* node, uint32_t idx) {
+  int32_t block = inode_get_block(fs, node, idx);
+  if (block == ERROR) return ERROR;
+  // a block past the bitmaps may be shared, so it is copied like one, and
+  // a mapped block keeps its contents for the mapping
+  if ((uint32_t)block < fs->alloc_data_blocks &&
+      fs->data_block_refs[block] == 1 && fs->data_block_maps[block] == 0)
+    return block;
+
+  int32_t prev = idx ? inode_get_block(fs, node, idx - 1) : -1;
+  int32_t copy = alloc_data_block(fs, prev);
+  if (copy == NO_FREE_BLOCK) return ERROR;  // image is full
+  if (inode_set_block(fs, node, idx, copy) == ERROR) {
+    free_data_block(fs, copy);
+    return ERROR;  // inode is full
+  }
+
+  memcpy(fs_data_block(fs, copy), fs_data_block(fs, block), BLOCK_SIZE_BYTES);
+  free_data_block(fs, block);
+  return copy;
+}
+
+/* Name: mark_block_used()
+ * Description: counts one more file using a data block
+ * Inputs: fs: the mounted image
+ *         block: index of the data block
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: updates the bitmap, reference count and free block count
+ */
+static void mark_block_used(fs_t* fs, uint32_t block) {
+  if (block >= fs->alloc_data_blocks) return;  // corrupt inode or untracked
+  if (fs->data_block_refs[block] == FS_MAX_BLOCK_REFS) return;
+  if (++fs->data_block_refs[block] == 2) fs->num_shared_data_blocks++;
+  if (fs->data_block_refs[block] > 1) return;
+
+  fs->data_block_bitmap[block / BITMAP_WORD_BITS] |=
+      (1u << (block % BITMAP_WORD_BITS));
+  fs->num_free_data_blocks--;
+}
+
+/* Name: mark_file_used()
+ * Description: marks an inode and the data blocks it points to as used, a
+ *              block that is already used is shared with another file
+ * Inputs: fs: the mounted image
+ *         inode: the index of the inode
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: updates the bitmaps, reference counts and free block count
+ */
+static void mark_file_used(fs_t* fs, uint32_t inode) {
+  uint32_t j, k, num_blocks, block;
+  ind_cache_t cache = {0};
+  int32_t run;
+  if (inode >= fs->num_inodes) return;
+  if (inode < fs->alloc_inodes)
+    fs->inode_bitmap[inode / BITMAP_WORD_BITS] |=
+        (1u << (inode % BITMAP_WORD_BITS));
+
+  inode_t* curr_node = fs_inode(fs, inode);
+  if (curr_node == NULL) return;
+
+  num_blocks = inode_num_blocks(fs, curr_node);
+  for (j = 0; j < num_blocks; j += run) {
+    run = inode_get_run(fs, curr_node, j, num_blocks, &block, &cache);
+    if (run == ERROR) break;  // the rest isn't in the image
+
+    for (k = block; k < block + run; k++) mark_block_used(fs, k);
+  }
+
+  // the blocks of indices of a version 3 file
+  if (!fs->indirect || num_blocks <= DIRECT_BLOCKS) return;
+  mark_block_used(fs, curr_node->data_block_indices[IND_SLOT]);
+  if (num_blocks <= IND_LIMIT) return;
+
+  uint32_t* parent = ind_child(fs, inode_indices(curr_node), DIND_SLOT, 0);
+  mark_block_used(fs, curr_node->data_block_indices[DIND_SLOT]);
+  for (j = 0; parent && j <= (num_blocks - IND_LIMIT - 1) / INDICES_PER_BLOCK;
+       j++)
+    mark_block_used(fs, parent[j]);
+}
+
+/* Name: alloc_bitmaps_build()
+ * Description: builds the free block and inode bitmaps from the regular files
+ *              in the directory
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: resets the bitmaps, reference counts and allocation hints
+ */
+static void alloc_bitmaps_build(fs_t* fs) {
+  int i;
+  dir_entry_t* entry;
+
+  memset(fs->data_block_bitmap, 0, sizeof(fs->data_block_bitmap));
+  memset(fs->inode_bitmap, 0, sizeof(fs->inode_bitmap));
+  memset(fs->data_block_refs, 0, sizeof(fs->data_block_refs));
+  memset(fs->data_block_maps, 0, sizeof(fs->data_block_maps));
+  fs->num_shared_data_blocks = 0;
+  fs->data_block_hint = 0;
+  fs->inode_hint = 0;
+
+  // blocks and inodes past what the bitmaps can track are never handed
+  // out, but files that already use them can still be read
+  fs->alloc_data_blocks = fs->num_data_blocks;
+  if (fs->alloc_data_blocks > FS_MAX_DATA_BLOCKS)
+    fs->alloc_data_blocks = FS_MAX_DATA_BLOCKS;
+  fs->alloc_inodes = fs->num_inodes;
+  if (fs->alloc_inodes > FS_MAX_INODES) fs->alloc_inodes = FS_MAX_INODES;
+  fs->num_free_data_blocks = fs->alloc_data_blocks;
+
+  // the extended directory is stored like a file without a name
+  if (fs->dir_inode != -1) mark_file_used(fs, fs->dir_inode);
+
+  for (i = 0; (entry = get_dentry(fs, i)) != NULL; i++)
+    if (entry->file_type == FILE_TYPE_FILE)
+      mark_file_used(fs, entry->inode_num);
+}
+
+/* Name: ext_dir_init()
+ * Description: finds the extended directory, if the image has one, and
+ *              checks that its blocks are inside the image
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: sets dir_inode and num_ext_entries
+ */
+static void ext_dir_init(fs_t* fs) {
+  uint32_t i, num_blocks, block;
+  fs->dir_inode = -1;
+  fs->num_ext_entries = 0;
+
+  if (fs->boot_block->dir_magic != DIR_EXT_MAGIC ||
+      fs->boot_block->dir_inode >= fs->num_inodes)
+    return;
+
+  inode_t* dir_node = fs_inode(fs, fs->boot_block->dir_inode);
+  if (dir_node == NULL) return;
+  fs->num_ext_entries = dir_node->length_in_bytes / DIR_ENTRY_SIZE_BYTES;
+  if (fs->num_ext_entries > MAX_EXT_DIR_ENTRIES)
+    fs->num_ext_entries = MAX_EXT_DIR_ENTRIES;
+
+  // stop at the first block that isn't in the image
+  num_blocks =
+      (fs->num_ext_entries + DIR_ENTRIES_PER_BLOCK - 1) / DIR_ENTRIES_PER_BLOCK;
+  for (i = 0; i < num_blocks; i++) {
+    if (inode_get_run(fs, dir_node, i, num_blocks, &block, NULL) == ERROR) {
+      fs->num_ext_entries = i * DIR_ENTRIES_PER_BLOCK;
+      break;
+    }
+  }
+  fs->dir_inode = fs->boot_block->dir_inode;
+}
+
+/* Name: file_system_setup()
+ * Description: reads the boot block and builds the in memory state of an
+ *              image, the boot block has to be set
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: builds the name index and the bitmaps
+ */
+static void file_system_setup(fs_t* fs) {
+  // retrieved from the union struct (see header file)
+  fs->dir_entries = fs->boot_block->dir_entries;
+  fs->num_dir_entries = fs->boot_block->num_dir_entries;
+  fs->num_inodes = fs->boot_block->num_inodes;  // number of inodes
+  fs->extents = (fs->boot_block->fs_magic == FS_V2_MAGIC);
+  fs->indirect = (fs->boot_block->fs_magic == FS_V3_MAGIC);
+  fs->ind_gen++;  // never 0, which marks an empty cache
+  if (fs->ind_gen == 0) fs->ind_gen++;
 
-// pointer to the start of the dir_entries array, used as array[]
-dir_entry_t* dir_entries;
-int32_t num_dir_entries = 0;
+  // blocks decompressed from an image mounted here before are stale
+  zcache_invalidate(fs, ZCACHE_ALL_INODES);
 
-// pointer to start of the inodes, used as array[]
-inode_t* inodes;
-int32_t num_inodes = 0;
+  // the data blocks follow the inodes
+  fs->data_start = FS_INODE_START + fs->num_inodes;
+  fs->num_data_blocks = fs->boot_block->num_data_blocks;
 
-// pointer to start of the data blocks, used as array[]
-data_block_t* data_blocks;
-int32_t num_data_blocks = 0;
+  // hash the directory so name lookups don't scan dir_entries
+  memset(&fs->dentry_stats, 0, sizeof(fs->dentry_stats));
+  dentry_index_build(fs);
+
+  // entries past the boot block, not present in older images
+  ext_dir_init(fs);
+
+  // find the free data blocks and inodes so files can be written
+  alloc_bitmaps_build(fs);
+  memset(&fs->ind_stats, 0, sizeof(fs->ind_stats));
+}
 
 /* Name: file_system_init()
  * Description: initializes all the parts needed to read and write for
  *              the file system
- * Inputs: file_system_start_addr: starting address for the file system
+ * Inputs: fs: the mounted image
+ *         file_system_start_addr: starting address for the file system
  * Outputs: all parts needed for read, write, close, and open of the file
  *          system and the directory is initialized
  * Return Value: none
  * Side Effects: File system is initialized
  */
-void file_system_init(uint32_t file_system_start_addr) {
-  file_system_addr = file_system_start_addr;
-  boot_block = (boot_block_t*)file_system_addr;
+void file_system_init(fs_t* fs, uint32_t file_system_start_addr) {
+  fs->file_system_addr = file_system_start_addr;
+  fs->boot_block = (boot_block_t*)fs->file_system_addr;
+  fs->on_disk = 0;
+  file_system_setup(fs);
+}
 
-  // retrieved from the union struct (see header file)
-  dir_entries = boot_block->dir_entries;
-  num_dir_entries = boot_block->num_dir_entries;
+/* Name: file_system_init_disk()
+ * Description: initializes an image that is read from the disk through the
+ *              block cache, call after bcache_init()
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the disk doesn't hold a valid image
+ * Side Effects: pins the boot block in the block cache
+ */
+int32_t file_system_init_disk(fs_t* fs) {
+  boot_block_t* boot_block = (boot_block_t*)bcache_pin(FS_BOOT_BLOCK);
+  if (boot_block == NULL) return ERROR;
 
-  // set the array for the inodes
-  inodes = (inode_t*)(file_system_addr + BLOCK_SIZE_BYTES);
-  num_inodes = boot_block->num_inodes;  // number of inodes
+  // the whole image has to fit on the disk
+  if (boot_block->num_dir_entries > NUM_DIR_ENTRY ||
+      boot_block->num_inodes >= bcache_get_num_blocks() ||
+      boot_block->num_data_blocks >
+          bcache_get_num_blocks() - FS_INODE_START - boot_block->num_inodes)
+    return ERROR;
 
-  // initialize the data blocks
-  data_blocks =
-      (data_block_t*)(file_system_addr + (BLOCK_SIZE_BYTES * (num_inodes + 1)));
-  num_data_blocks = boot_block->num_data_blocks;
+  fs->file_system_addr = 0;
+  fs->boot_block = boot_block;
+  fs->on_disk = 1;
+  file_system_setup(fs);
+  return 0;
 }
 
 /* Name: file_open()
@@ -75,6 +1022,7 @@ int32_t file_close(int32_t fd) { return 0; }
  * Side Effects: File is read with the correct number of bytes
  */
 int32_t file_read(int32_t fd, void* buf, int32_t nbytes) {
+  fs_t* fs = vfs_fd_fs(fd);
   // get current pcb struct
   pcb_t* file_pcb = get_curr_pcb();
 
@@ -83,7 +1031,10 @@ int32_t file_read(int32_t fd, void* buf, int32_t nbytes) {
   uint32_t inode_idx = file_pcb->fdt[fd].inode_idx;
 
   // call read_data for this file
-  int32_t rd = read_data(inode_idx, offset, (uint8_t*)buf, (uint32_t)nbytes);
+  ind_cache_t cache = file_pcb->fdt[fd].ind_cache;
+  int32_t rd = read_data_cached(fs, inode_idx, offset, (uint8_t*)buf,
+                                (uint32_t)nbytes, &cache);
+  file_pcb->fdt[fd].ind_cache = cache;
 
   // update file_position in pcb
   file_pcb->fdt[fd].file_position += rd;
@@ -92,16 +1043,145 @@ int32_t file_read(int32_t fd, void* buf, int32_t nbytes) {
   return rd;
 }
 
+/* Name: file_pread()
+ * Description: reads the file at the given offset without using or moving
+ *              the file position
+ * Inputs: fd: the file descriptor
+ *         buf: the buffer for the data
+ *         nbytes: the number of bytes to be read
+ *         offset: where in the file to start reading
+ * Outputs: none
+ * Return Value: number of bytes written to buffer, -1 on failure
+ * Side Effects: none
+ */
+int32_t file_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset) {
+  fs_t* fs = vfs_fd_fs(fd);
+  if (nbytes < 0) return ERROR;
+  fdt_entry_t* entry = &get_curr_pcb()->fdt[fd];
+  ind_cache_t cache = entry->ind_cache;  // the entry is packed
+  int32_t rd = read_data_cached(fs, entry->inode_idx, offset, (uint8_t*)buf,
+                                (uint32_t)nbytes, &cache);
+  entry->ind_cache = cache;
+  return rd;
+}
+
+/* Name: file_readv()
+ * Description: reads the file into each segment in turn starting at the file
+ *              position, stopping early at the end of the file. Each segment
+ *              is read like a read call, so writes from other processes may
+ *              land between them
+ * Inputs: fd: the file descriptor
+ *         iov: the segments to fill
+ *         iovcnt: number of segments
+ * Outputs: none
+ * Return Value: total number of bytes read, -1 if the first segment fails
+ * Side Effects: advances the file position
+ */
+int32_t file_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  fs_t* fs = vfs_fd_fs(fd);
+  pcb_t* file_pcb = get_curr_pcb();
+  uint32_t inode_idx = file_pcb->fdt[fd].inode_idx;
+  ind_cache_t cache = file_pcb->fdt[fd].ind_cache;
+  int32_t i, len, rd = 0, total = 0;
+
+  for (i = 0; i < iovcnt; i++) {
+    len = iov[i].len;
+    rd = read_data_cached(fs, inode_idx, file_pcb->fdt[fd].file_position,
+                          (uint8_t*)iov[i].base, (uint32_t)len, &cache);
+    if (rd == ERROR) break;
+    file_pcb->fdt[fd].file_position += rd;
+    total += rd;
+    if (rd < len) break;  // end of file
+  }
+
+  file_pcb->fdt[fd].ind_cache = cache;
+  return (rd == ERROR && total == 0) ? ERROR : total;
+}
+
+/* Name: file_writev()
+ * Description: appends every segment to the end of the file in order, each
+ *              like a write call
+ * Inputs: fd: the file descriptor
+ *         iov: the segments to write
+ *         iovcnt: number of segments
+ * Outputs: none
+ * Return Value: total number of bytes written, -1 if nothing could be
+ *               written, like file_write
+ * Side Effects: allocates data blocks as the file grows
+ */
+int32_t file_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  int32_t i, len, wr, total = 0;
+
+  for (i = 0; i < iovcnt; i++) {
+    len = iov[i].len;
+    if (len == 0) continue;
+    wr = file_write(fd, iov[i].base, len);
+    if (wr == ERROR) return total ? total : ERROR;  // image is full
+    total += wr;
+    if (wr < len) break;
+  }
+  return total;
+}
+
+/* Name: seek_position()
+ * Description: computes a new position for lseek
+ * Inputs: curr: the current position, end: the position of the end,
+ *         offset: the requested offset, whence: what offset is relative to
+ * Outputs: none
+ * Return Value: the new position, -1 if it is invalid
+ * Side Effects: none
+ */
+int32_t seek_position(uint32_t curr, uint32_t end, int32_t offset,
+                      int32_t whence) {
+  int32_t base;
+  switch (whence) {
+    case SEEK_SET: base = 0; break;
+    case SEEK_CUR: base = curr; break;
+    case SEEK_END: base = end; break;
+    default: return ERROR;
+  }
+  if (base + offset < 0) return ERROR;  // can't seek before the start
+  return base + offset;
+}
+
+/* Name: file_seek()
+ * Description: moves the file position, the position may be past the end
+ * Inputs: fd: the file descriptor
+ *         offset: the new position relative to whence
+ *         whence: SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Return Value: the new position, -1 on failure
+ * Side Effects: updates the file position in the pcb
+ */
+int32_t file_seek(int32_t fd, int32_t offset, int32_t whence) {
+  fs_t* fs = vfs_fd_fs(fd);
+  pcb_t* file_pcb = get_curr_pcb();
+  int32_t pos = seek_position(file_pcb->fdt[fd].file_position,
+                              get_file_size(fs, file_pcb->fdt[fd].inode_idx),
+                              offset, whence);
+  if (pos == ERROR) return ERROR;
+
+  file_pcb->fdt[fd].file_position = pos;
+  return pos;
+}
+
 /* Name: file_write()
- * Description: write to the file
+ * Description: appends to the end of the file
  * Inputs: fd: the file descriptor
-           buf: the buffer for the screen
-           nbytes: the number of bytes to be read
+           buf: the data to append
+           nbytes: the number of bytes to be written
  * Outputs: none
- * Return Value: integer for success or failure
- * Side Effects: None
+ * Return Value: number of bytes written, -1 on failure
+ * Side Effects: allocates data blocks as the file grows
  */
-int32_t file_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t file_write(int32_t fd, const void* buf, int32_t nbytes) {
+  fs_t* fs = vfs_fd_fs(fd);
+  if (nbytes < 0) return ERROR;
+  uint32_t inode_idx = get_curr_pcb()->fdt[fd].inode_idx;
+
+  return write_data(fs, inode_idx, get_file_size(fs, inode_idx),
+                    (const uint8_t*)buf, (uint32_t)nbytes);
+}
 
 /* Name: dir_open()
  * Description: opens the directory that is passed in
@@ -111,7 +1191,7 @@ int32_t file_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
  * Side Effects: None
  */
 int32_t dir_open(const uint8_t* filename) {
-  // There is only one directory in this OS - "."
+  // Each mounted image has one directory - "."
   return 0;
 }
 
@@ -135,56 +1215,118 @@ int32_t dir_close(int32_t fd) { return 0; }
  * Side Effects: File is read with the correct number of bytes
  */
 int32_t dir_read(int32_t fd, void* buf, int32_t nbytes) {
-  // get maximum directory entry number
-  int32_t num_dir = get_num_dir_entries();
-
+  fs_t* fs = vfs_fd_fs(fd);
   // get current pcb
   pcb_t* pcb = get_curr_pcb();
 
   // read and check current position
-  int dir_pos = pcb->fdt[fd].file_position;
-  if (dir_pos >= num_dir) return 0;
-
-  // read current directory entry
-  dir_entry_t curr_dir;
-  if (read_dentry_by_index(dir_pos, &curr_dir) == -1) return -1;
+  dir_entry_t* curr_dir = get_dentry(fs, pcb->fdt[fd].file_position);
+  if (curr_dir == NULL) return 0;
 
-  // copy current file name to buf
-  strncpy((int8_t*)buf, curr_dir.file_name, FILE_NAME_SIZE);
+  // copy current file name to buf straight from the image
+  int8_t* file_name = curr_dir->file_name;
+  strncpy((int8_t*)buf, file_name, FILE_NAME_SIZE);
   (pcb->fdt[fd].file_position)++;
 
-  // create temporary buffer to check filename size
-  char file_name_buf[FILE_NAME_SIZE + 1];
-  strncpy((int8_t*)file_name_buf, curr_dir.file_name, FILE_NAME_SIZE);
-  file_name_buf[FILE_NAME_SIZE] = '\0';
+  // return file name size, names that fill the field have no null
+  int32_t len = 0;
+  while (len < FILE_NAME_SIZE && file_name[len] != '\0') len++;
+  return len;
+}
+
+/* Name: dir_getdents()
+ * Description: reads as many directory entries as fit in the buffer in one
+ *              call, packed as dirent_t records
+ * Inputs: fd: the directory descriptor
+ *         buf: where the records are written
+ *         nbytes: the size of buf in bytes
+ * Outputs: none
+ * Return Value: number of bytes written to buf, 0 at the end of the
+ *               directory, -1 if buf can't hold a single record
+ * Side Effects: advances the directory position past the entries read
+ */
+int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes) {
+  fs_t* fs = vfs_fd_fs(fd);
+  if (nbytes < (int32_t)sizeof(dirent_t)) return ERROR;
+
+  pcb_t* pcb = get_curr_pcb();
+  dirent_t* records = (dirent_t*)buf;
+  uint32_t max_records = nbytes / sizeof(dirent_t);
+  uint32_t dir_pos = pcb->fdt[fd].file_position;
+  uint32_t count = 0;
+  dir_entry_t* curr_dir;
+
+  while (count < max_records && (curr_dir = get_dentry(fs, dir_pos)) != NULL) {
+    dir_pos++;
+    memcpy(records[count].file_name, curr_dir->file_name, FILE_NAME_SIZE);
+    records[count].file_type = curr_dir->file_type;
+    records[count].inode_num = curr_dir->inode_num;
+    records[count].file_size = (curr_dir->file_type == FILE_TYPE_FILE)
+                                   ? get_file_size(fs, curr_dir->inode_num)
+                                   : 0;
+    count++;
+  }
+
+  pcb->fdt[fd].file_position = dir_pos;
+  return count * sizeof(dirent_t);
+}
+
+/* Name: dir_seek()
+ * Description: moves the directory position, which counts entries
+ * Inputs: fd: the directory descriptor
+ *         offset: the new entry index relative to whence
+ *         whence: SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Return Value: the new position, -1 on failure
+ * Side Effects: updates the directory position in the pcb
+ */
+int32_t dir_seek(int32_t fd, int32_t offset, int32_t whence) {
+  fs_t* fs = vfs_fd_fs(fd);
+  pcb_t* pcb = get_curr_pcb();
+  int32_t pos = seek_position(pcb->fdt[fd].file_position,
+                              get_num_dir_entries(fs), offset, whence);
+  if (pos == ERROR) return ERROR;
 
-  // return file name size
-  return strlen(file_name_buf);
+  pcb->fdt[fd].file_position = pos;
+  return pos;
 }
 
 /* Name: dir_write()
- * Description: write to the directory
+ * Description: write to the directory, creates an empty file named by buf
  * Inputs: fd: the file descriptor
-           buf: the buffer for the screen
-           nbytes: the number of bytes to be read
+           buf: the name of the file to create
+           nbytes: the length of the name
  * Outputs: none
- * Return Value: integer for success or failure
- * Side Effects: None
+ * Return Value: length of the name on success, -1 on failure
+ * Side Effects: adds an entry to the directory
  */
-int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes) {
+  fs_t* fs = vfs_fd_fs(fd);
+  uint8_t fname[FILE_NAME_SIZE + 1];
+  if (nbytes <= 0 || nbytes > FILE_NAME_SIZE) return ERROR;
+
+  // buf does not have to be null terminated
+  memcpy(fname, buf, nbytes);
+  fname[nbytes] = '\0';
+
+  if (file_create(fs, fname) == ERROR) return ERROR;
+  return nbytes;
+}
 
 /* Name: read_dentry_by_index()
  * Description: reads the directory entry by the index, copies into the
  directory_entry
- * Inputs: index: the index to be read, dir_entry: the directory entry
+ * Inputs: fs: the mounted image
+ *         index: the index to be read, dir_entry: the directory entry
  * Outputs: none
  * Return Value: integer for success or failure
  * Side Effects: the directory is read by the index
  */
-int32_t read_dentry_by_index(uint32_t index, dir_entry_t* dir_entry) {
-  if (index > num_dir_entries) return -1;  // out of bounds check
+int32_t read_dentry_by_index(fs_t* fs, uint32_t index, dir_entry_t* dir_entry) {
+  dir_entry_t* entry = get_dentry(fs, index);
+  if (entry == NULL) return -1;  // out of bounds check
 
-  memcpy(dir_entry, &dir_entries[index],
+  memcpy(dir_entry, entry,
          DIR_ENTRY_SIZE_BYTES);  // copy over the addresses into the dir_entry
                                  // for reference
   return 0;
@@ -192,88 +1334,734 @@ int32_t read_dentry_by_index(uint32_t index, dir_entry_t* dir_entry) {
 
 /* Name: read_dentry_by_name()
  * Description: reads the directory entry by name, copies into the
- *              directory_entry
- * Inputs: index: the index to be read, dir_entry: the directory entry
+ *              directory_entry. Looks the name up in the hash index built by
+ *              file_system_init() instead of scanning dir_entries, then
+ *              binary searches the extended directory
+ * Inputs: fs: the mounted image
+ *         index: the index to be read, dir_entry: the directory entry
  * Outputs: none
  * Return Value: integer for success or failure
  * Side Effects: the directory is read by the name
  */
-int32_t read_dentry_by_name(const uint8_t* fname, dir_entry_t* dir_entry) {
-  int i;
+int32_t read_dentry_by_name(fs_t* fs, const uint8_t* fname,
+                            dir_entry_t* dir_entry) {
   int len = strlen((int8_t*)fname);
 
   if (len > FILE_NAME_SIZE) return -1;  // out of bounds check
 
-  // i is to iterate through the number of directory entries
-  for (i = 0; i < num_dir_entries; i++) {
-    if (!strncmp((int8_t*)fname, dir_entries[i].file_name, FILE_NAME_SIZE))
-      break;
-  }
-
-  if (num_dir_entries == i) return -1;  // return failure
+  int32_t i = dentry_lookup(fs, fname);
+  if (i == -1) return -1;  // return failure
 
   // copy into the dir_entry
-  memcpy(dir_entry, &dir_entries[i], DIR_ENTRY_SIZE_BYTES);
+  dir_entry_t* entry = get_dentry(fs, i);
+  if (entry == NULL) return -1;  // disk error
+  memcpy(dir_entry, entry, DIR_ENTRY_SIZE_BYTES);
   return 0;
 }
 
 /* Name: read_data()
  * Description: reads the data from the correct source, given the number of
- * bytes and where to read from
- * Inputs: inode: the index to look at, offset: the offset for the data,
+ * bytes and where to read from, see read_data_cached
+ * Inputs: fs: the mounted image
+ *         inode: the index to look at, offset: the offset for the data,
  * buf: the buffer for data, length: how much that needs to bre read
  * Outputs: none
- * Return Value: the number of bytes written to buffer
+ * Return Value: the number of bytes written to buffer, -1 on a bad inode or
+ *               data block index or a disk error
  * Side Effects: the data is read given the correct place
  */
-int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf,
+int32_t read_data(fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf,
                   uint32_t length) {
-  if (inode >= num_inodes || inode < 0) return ERROR;  // out of bounds check
-  inode_t* curr_node = &(inodes[inode]);               // get the current node
-  uint32_t file_seek = offset;
-  uint32_t data_block_idx = offset / BLOCK_SIZE_BYTES;
-  uint32_t data_block_offset = offset % BLOCK_SIZE_BYTES;
-  uint8_t* data_addr =
-      (uint8_t*)&(data_blocks[curr_node->data_block_indices[data_block_idx]]) +
-      data_block_offset;  // gets the address of the current block
-
-  uint32_t num_bytes_read;
-  for (num_bytes_read = 0; num_bytes_read < length; num_bytes_read++) {
-    if (file_seek >= curr_node->length_in_bytes)
-      break;  // offset is more than the bytes
-    switch (data_block_offset) {
-      case BLOCK_SIZE_BYTES:
-        data_block_offset = 0;
-        data_block_idx++;  // go to the next block
-        data_addr = (uint8_t*)&(
-            data_blocks[curr_node->data_block_indices
-                            [data_block_idx]]);  // update the next block
-      default:
-        buf[num_bytes_read] = *data_addr++;
-        file_seek++;
-        data_block_offset++;  // inc to switch to next d block in next iteration
-    }
+  return read_data_cached(fs, inode, offset, buf, length, NULL);
+}
+
+/* Name: data_run()
+ * Description: finds where a file's data lives in the image, see
+ *              get_data_run
+ * Inputs: fs: the mounted image
+ *         inode: the index to look at, offset: the offset in the file,
+ *         data: set to the address of the byte at offset,
+ *         cache: the file's cached indirect block or NULL
+ * Outputs: none
+ * Return Value: number of contiguous bytes from offset, 0 at the end of the
+ *               file, -1 on a bad inode or data block index or a disk error
+ * Side Effects: see get_data_run
+ */
+static int32_t data_run(fs_t* fs, uint32_t inode, uint32_t offset,
+                        const uint8_t** data, ind_cache_t* cache) {
+  if (inode >= fs->num_inodes) return ERROR;  // out of bounds check
+  inode_t* curr_node = fs_inode(fs, inode);
+  if (curr_node == NULL) return ERROR;  // disk error
+
+  uint32_t file_len = curr_node->length_in_bytes;
+  if (offset >= file_len) return 0;
+
+  uint32_t num_blocks = (file_len + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
+  uint32_t block_offset = offset % BLOCK_SIZE_BYTES;
+  uint32_t first_block;
+  uint8_t* block;
+
+  // compressed blocks are only contiguous once decompressed, one at a time
+  if (inode_compressed(fs, curr_node)) {
+    block = compressed_block(fs, inode, curr_node, offset / BLOCK_SIZE_BYTES);
+    if (block == NULL) return ERROR;  // corrupt file
+    *data = block + block_offset;
+    if (file_len - offset < BLOCK_SIZE_BYTES - block_offset)
+      return file_len - offset;
+    return BLOCK_SIZE_BYTES - block_offset;
+  }
+
+  int32_t run_blocks = inode_get_run(fs, curr_node, offset / BLOCK_SIZE_BYTES,
+                                     num_blocks, &first_block, cache);
+  if (run_blocks == ERROR) return ERROR;  // corrupt inode
+  if (fs->on_disk) run_blocks = 1;
+
+  uint32_t run_bytes = run_blocks * BLOCK_SIZE_BYTES - block_offset;
+  if (run_bytes > file_len - offset) run_bytes = file_len - offset;
+
+  // fetched last, a miss on it may evict the inode
+  block = fs_data_block(fs, first_block);
+  if (block == NULL) return ERROR;  // disk error
+
+  *data = block + block_offset;
+  return run_bytes;
+}
+
+/* Name: get_data_run()
+ * Description: finds where a file's data lives in the image, so callers can
+ *              use it in place instead of copying it out with read_data
+ * Inputs: fs: the mounted image
+ *         inode: the index to look at, offset: the offset in the file,
+ *         data: set to the address of the byte at offset
+ * Outputs: none
+ * Return Value: number of bytes from offset that are contiguous in the image
+ *               (up to the end of the run of blocks or the file, a whole
+ *               extent on version 2 images), 0 at the end of the file, -1 on
+ *               a bad inode or data block index or a disk error. On the disk
+ *               a run is at most one block, cached blocks aren't contiguous,
+ *               and so is a run of a compressed file
+ * Side Effects: on the disk, data is valid until the next block cache miss,
+ *               for a compressed file until the next zcache miss
+ */
+int32_t get_data_run(fs_t* fs, uint32_t inode, uint32_t offset,
+                     const uint8_t** data) {
+  return data_run(fs, inode, offset, data, NULL);
+}
+
+/* Name: get_data_run_cached()
+ * Description: get_data_run for an open file, going through the block of
+ *              indices cached for its fd like read_data_cached
+ * Inputs: fs: the mounted image
+ *         inode: the index to look at, offset: the offset in the file,
+ *         data: set to the address of the byte at offset,
+ *         cache: the fd's cached indirect block
+ * Outputs: none
+ * Return Value: see get_data_run
+ * Side Effects: see get_data_run, updates the cache
+ */
+int32_t get_data_run_cached(fs_t* fs, uint32_t inode, uint32_t offset,
+                            const uint8_t** data, ind_cache_t* cache) {
+  return data_run(fs, inode, offset, data, cache);
+}
+
+/* Name: read_data_cached()
+ * Description: reads the data from the correct source, given the number of
+ *              bytes and where to read from. The request is clamped to the
+ *              file length once, then copied one run of physically
+ *              contiguous data blocks at a time. On version 3 images the
+ *              block of indices used last is remembered in cache, so
+ *              reading on through a large file doesn't go back through the
+ *              inode for every block
+ * Inputs: fs: the mounted image
+ *         inode: the index to look at, offset: the offset for the data,
+ *         buf: the buffer for data, length: how much to read,
+ *         cache: the open file's cached indirect block, or NULL to only
+ *         keep it for this call
+ * Outputs: none
+ * Return Value: the number of bytes written to buffer, -1 on a bad inode or
+ *               data block index or a disk error
+ * Side Effects: fills the cache
+ */
+int32_t read_data_cached(fs_t* fs, uint32_t inode, uint32_t offset,
+                         uint8_t* buf, uint32_t length, ind_cache_t* cache) {
+  ind_cache_t call_cache = {0};
+  if (cache == NULL) cache = &call_cache;
+
+  if (inode >= fs->num_inodes) return ERROR;  // out of bounds check
+  inode_t* curr_node = fs_inode(fs, inode);
+  if (curr_node == NULL) return ERROR;  // disk error
+
+  // clamp the request to the end of the file
+  uint32_t file_len = curr_node->length_in_bytes;
+  if (offset >= file_len) return 0;
+  if (length > file_len - offset) length = file_len - offset;
+
+  const uint8_t* data;
+  int32_t run_bytes;
+  uint32_t num_bytes_read = 0;
+
+  while (num_bytes_read < length) {
+    run_bytes = data_run(fs, inode, offset + num_bytes_read, &data, cache);
+    if (run_bytes == ERROR) return ERROR;  // corrupt inode or disk error
+    if (run_bytes > length - num_bytes_read)
+      run_bytes = length - num_bytes_read;
+
+    memcpy(buf + num_bytes_read, data, run_bytes);
+    num_bytes_read += run_bytes;
   }
 
   return num_bytes_read;
 }
 
+/* Name: map_data_block()
+ * Description: gets the address of a block of a file so a process can map
+ *              it, counting the mapping in data_block_maps. Writing the file
+ *              then copies the block first, so the mapping keeps the
+ *              contents it had
+ * Inputs: fs: the mounted image
+ *         inode: the index of the inode, idx: index of the block in the file
+ * Outputs: none
+ * Return Value: address of the data block, 0 if idx is past the end of the
+ *               file, the block has FS_MAX_BLOCK_MAPS mappings or it isn't
+ *               stored as is in memory: disk images are only cached and
+ *               compressed blocks have to be unpacked
+ * Side Effects: the block stays allocated until unmap_data_block
+ */
+uint32_t map_data_block(fs_t* fs, uint32_t inode, uint32_t idx) {
+  if (fs->on_disk || inode >= fs->num_inodes) return 0;
+  inode_t* curr_node = fs_inode(fs, inode);
+  if (inode_compressed(fs, curr_node)) return 0;
+
+  uint32_t num_blocks =
+      (curr_node->length_in_bytes + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
+  if (idx >= num_blocks) return 0;
+  int32_t block = inode_get_block(fs, curr_node, idx);
+  if (block == ERROR) return 0;  // corrupt inode
+
+  // blocks past the bitmaps are never freed or written in place anyway
+  if ((uint32_t)block < fs->alloc_data_blocks) {
+    if (fs->data_block_maps[block] == FS_MAX_BLOCK_MAPS) return 0;
+    fs->data_block_maps[block]++;
+  }
+  return (uint32_t)fs_data_block(fs, block);
+}
+
+/* Name: unmap_data_block()
+ * Description: drops the mapping map_data_block counted on a data block
+ * Inputs: fs: the mounted image
+ *         addr: the address map_data_block returned
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: frees the block if no file uses it anymore
+ */
+void unmap_data_block(fs_t* fs, uint32_t addr) {
+  uint32_t block = (addr - (uint32_t)fs_data_block(fs, 0)) / BLOCK_SIZE_BYTES;
+  if (block >= fs->alloc_data_blocks || fs->data_block_maps[block] == 0)
+    return;
+  if (--fs->data_block_maps[block] > 0 || fs->data_block_refs[block] > 0)
+    return;
+
+  fs->data_block_bitmap[block / BITMAP_WORD_BITS] &=
+      ~(1u << (block % BITMAP_WORD_BITS));
+  fs->num_free_data_blocks++;
+}
+
+/* Name: write_data()
+ * Description: writes data into a file directly in the data blocks, growing
+ *              the file and allocating blocks as needed
+ * Inputs: fs: the mounted image
+ *         inode: the index of the file's inode, offset: where in the file to
+ *         start writing, buf: the data to write, length: bytes to write
+ * Outputs: none
+ * Return Value: the number of bytes written, -1 if nothing could be written,
+ *               the image is on the disk, the file is compressed or a
+ *               process runs it
+ * Side Effects: the file's length and blocks are updated
+ */
+int32_t write_data(fs_t* fs, uint32_t inode, uint32_t offset,
+                   const uint8_t* buf, uint32_t length) {
+  if (fs->on_disk) return ERROR;  // disk images are read only
+  if (inode >= fs->num_inodes) return ERROR;  // out of bounds check
+  inode_t* curr_node = fs_inode(fs, inode);
+  if (inode_compressed(fs, curr_node)) return ERROR;  // read only
+  uint32_t max_len = max_file_size(fs);
+
+  if (offset > max_len) return ERROR;
+  if (length > max_len - offset) length = max_len - offset;
+  if (length == 0) return 0;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  // a running program's pages are still read in from its file
+  if (file_is_running(fs, inode)) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  // writing past the end leaves a zero filled hole
+  if (offset > curr_node->length_in_bytes &&
+      file_truncate(fs, inode, offset) == ERROR) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  uint32_t file_len = curr_node->length_in_bytes;
+  uint32_t num_blocks = (file_len + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
+  uint32_t block_idx = offset / BLOCK_SIZE_BYTES;
+  uint32_t block_offset = offset % BLOCK_SIZE_BYTES;
+  uint32_t num_bytes_written = 0;
+
+  while (num_bytes_written < length) {
+    if (block_idx >= num_blocks) {
+      int32_t prev =
+          num_blocks ? inode_get_block(fs, curr_node, num_blocks - 1) : -1;
+      int32_t block = alloc_data_block(fs, prev);
+      if (block == NO_FREE_BLOCK) break;  // image is full
+      if (inode_append_block(fs, curr_node, num_blocks, block) == ERROR) {
+        free_data_block(fs, block);
+        break;  // inode is full
+      }
+      num_blocks++;
+    }
+
+    uint32_t chunk = BLOCK_SIZE_BYTES - block_offset;
+    if (chunk > length - num_bytes_written) chunk = length - num_bytes_written;
+
+    // blocks shared with other files are copied first
+    int32_t block = inode_own_block(fs, curr_node, block_idx);
+    if (block == ERROR) break;
+    memcpy(fs_data_block(fs, block) + block_offset, buf + num_bytes_written,
+           chunk);
+
+    num_bytes_written += chunk;
+    block_idx++;
+    block_offset = 0;
+  }
+
+  if (offset + num_bytes_written > file_len)
+    curr_node->length_in_bytes = offset + num_bytes_written;
+
+  restore_flags(flags);
+  return num_bytes_written ? num_bytes_written : ERROR;
+}
+
+/* Name: file_truncate()
+ * Description: sets a file's length, freeing blocks past the new end when
+ *              shrinking and zero filling the new bytes when growing
+ * Inputs: fs: the mounted image
+ *         inode: the index of the file's inode, length: the new length
+ * Outputs: none
+ * Return Value: 0 on success, -1 on failure, if the image is on the disk, if
+ *               a process runs the file or if it is compressed and length
+ *               isn't 0
+ * Side Effects: data blocks are allocated or freed
+ */
+int32_t file_truncate(fs_t* fs, uint32_t inode, uint32_t length) {
+  if (fs->on_disk) return ERROR;  // disk images are read only
+  if (inode >= fs->num_inodes) return ERROR;  // out of bounds check
+  if (length > max_file_size(fs)) return ERROR;
+  inode_t* curr_node = fs_inode(fs, inode);
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  // a running program's pages are still read in from its file
+  if (file_is_running(fs, inode)) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  // compressed files can only be emptied, which frees the whole stream
+  if (inode_compressed(fs, curr_node)) {
+    if (length != 0) {
+      restore_flags(flags);
+      return ERROR;
+    }
+    zcache_invalidate(fs, inode);
+    curr_node->length_in_bytes = 0;
+  }
+
+  uint32_t file_len = curr_node->length_in_bytes;
+  uint32_t num_blocks = inode_num_blocks(fs, curr_node);
+  uint32_t new_blocks = (length + BLOCK_SIZE_BYTES - 1) / BLOCK_SIZE_BYTES;
+  uint8_t* block_addr;
+
+  // shrinking, free every block past the new end
+  while (num_blocks > new_blocks)
+    free_data_block(fs, inode_pop_block(fs, curr_node, num_blocks--));
+
+  if (length > file_len) {
+    // zero the rest of the old last block, copying it first if it's shared
+    if (file_len % BLOCK_SIZE_BYTES) {
+      int32_t last = inode_own_block(fs, curr_node, num_blocks - 1);
+      if (last == ERROR) {
+        restore_flags(flags);
+        return ERROR;
+      }
+      block_addr = fs_data_block(fs, last);
+      memset(block_addr + (file_len % BLOCK_SIZE_BYTES), 0,
+             BLOCK_SIZE_BYTES - (file_len % BLOCK_SIZE_BYTES));
+    }
+
+    // add zeroed blocks up to the new end
+    while (num_blocks < new_blocks) {
+      int32_t prev =
+          num_blocks ? inode_get_block(fs, curr_node, num_blocks - 1) : -1;
+      int32_t block = alloc_data_block(fs, prev);
+      if (block != NO_FREE_BLOCK &&
+          inode_append_block(fs, curr_node, num_blocks, block) == ERROR) {
+        free_data_block(fs, block);
+        block = NO_FREE_BLOCK;  // inode is full
+      }
+      if (block == NO_FREE_BLOCK) {
+        curr_node->length_in_bytes = num_blocks * BLOCK_SIZE_BYTES;
+        restore_flags(flags);
+        return ERROR;  // image is full
+      }
+      memset(fs_data_block(fs, block), 0, BLOCK_SIZE_BYTES);
+      num_blocks++;
+    }
+  }
+
+  curr_node->length_in_bytes = length;
+  if (fs->extents) curr_node->inode_flags &= ~INODE_COMPRESSED;
+  restore_flags(flags);
+  return 0;
+}
+
+/* Name: ext_dentry_insert()
+ * Description: adds an entry to the extended directory in name order,
+ *              creating the extended directory if the image has none
+ * Inputs: fs: the mounted image
+ *         fname: the name of the new file, inode: the file's inode
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the directory can't grow
+ * Side Effects: may allocate an inode and data blocks for the directory
+ */
+static int32_t ext_dentry_insert(fs_t* fs, const uint8_t* fname,
+                                 uint32_t inode) {
+  int32_t found, new_inode;
+  uint32_t i, pos;
+
+  if (fs->dir_inode == -1) {
+    new_inode =
+        bitmap_alloc(fs->inode_bitmap, fs->alloc_inodes, &fs->inode_hint);
+    if (new_inode == NO_FREE_BLOCK) return ERROR;
+    inode_clear(fs, new_inode);
+    fs->boot_block->dir_inode = fs->dir_inode = new_inode;
+    fs->boot_block->dir_magic = DIR_EXT_MAGIC;
+  }
+  if (fs->num_ext_entries >= MAX_EXT_DIR_ENTRIES) return ERROR;
+
+  // grow by one entry, at most one new block
+  uint32_t new_len = (fs->num_ext_entries + 1) * DIR_ENTRY_SIZE_BYTES;
+  if (file_truncate(fs, fs->dir_inode, new_len) == ERROR) {
+    file_truncate(fs, fs->dir_inode,
+                  fs->num_ext_entries * DIR_ENTRY_SIZE_BYTES);
+    return ERROR;
+  }
+
+  // shift the larger names up one slot to keep the entries sorted
+  pos = ext_dentry_search(fs, fname, &found);
+  for (i = fs->num_ext_entries; i > pos; i--)
+    memcpy(ext_dentry(fs, i), ext_dentry(fs, i - 1), DIR_ENTRY_SIZE_BYTES);
+
+  dir_entry_t* new_entry = ext_dentry(fs, pos);
+  memset(new_entry, 0, DIR_ENTRY_SIZE_BYTES);
+  strncpy(new_entry->file_name, (int8_t*)fname, FILE_NAME_SIZE);
+  new_entry->file_type = FILE_TYPE_FILE;
+  new_entry->inode_num = inode;
+  fs->num_ext_entries++;
+  return 0;
+}
+
+/* Name: ext_dentry_remove()
+ * Description: removes an entry from the extended directory, keeping the
+ *              rest in name order
+ * Inputs: fs: the mounted image
+ *         index: index of the entry in the extended directory
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: frees the directory's last block once it is empty
+ */
+static void ext_dentry_remove(fs_t* fs, uint32_t index) {
+  uint32_t i;
+  for (i = index; i + 1 < fs->num_ext_entries; i++)
+    memcpy(ext_dentry(fs, i), ext_dentry(fs, i + 1), DIR_ENTRY_SIZE_BYTES);
+
+  fs->num_ext_entries--;
+  file_truncate(fs, fs->dir_inode,
+                fs->num_ext_entries * DIR_ENTRY_SIZE_BYTES);
+}
+
+/* Name: file_create()
+ * Description: creates an empty regular file in the directory, in the boot
+ *              block while it has room and in the extended directory after
+ * Inputs: fs: the mounted image
+ *         fname: the name of the new file
+ * Outputs: none
+ * Return Value: the inode index of the new file, -1 on failure
+ * Side Effects: allocates an inode and a directory entry
+ */
+int32_t file_create(fs_t* fs, const uint8_t* fname) {
+  uint32_t len = strlen((int8_t*)fname);
+  if (fs->on_disk) return ERROR;  // disk images are read only
+  if (len == 0 || len > FILE_NAME_SIZE) return ERROR;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  // names are unique across the boot block and the extended directory
+  if (dentry_lookup(fs, fname) != -1) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  int32_t inode =
+      bitmap_alloc(fs->inode_bitmap, fs->alloc_inodes, &fs->inode_hint);
+  if (inode == NO_FREE_BLOCK) {
+    restore_flags(flags);
+    return ERROR;
+  }
+  inode_clear(fs, inode);
+
+  // the boot block only has room for NUM_DIR_ENTRY
+  if (fs->num_dir_entries >= NUM_DIR_ENTRY) {
+    if (ext_dentry_insert(fs, fname, inode) == ERROR) {
+      fs->inode_bitmap[inode / BITMAP_WORD_BITS] &=
+          ~(1u << (inode % BITMAP_WORD_BITS));
+      restore_flags(flags);
+      return ERROR;
+    }
+    restore_flags(flags);
+    return inode;
+  }
+
+  dir_entry_t* new_entry = &fs->dir_entries[fs->num_dir_entries];
+  memset(new_entry, 0, DIR_ENTRY_SIZE_BYTES);
+  strncpy(new_entry->file_name, (int8_t*)fname, FILE_NAME_SIZE);
+  new_entry->file_type = FILE_TYPE_FILE;
+  new_entry->inode_num = inode;
+
+  fs->boot_block->num_dir_entries = ++fs->num_dir_entries;
+  dentry_index_insert(fs, fs->num_dir_entries - 1);
+
+  restore_flags(flags);
+  return inode;
+}
+
+/* Name: pcb_has_file_open()
+ * Description: checks whether a process has a file of an image open
+ * Inputs: pcb: the process, fs: the mounted image, inode: the file's inode
+ * Outputs: none
+ * Return Value: 1 if one of its fds is the file, 0 if none is
+ * Side Effects: none
+ */
+static int32_t pcb_has_file_open(pcb_t* pcb, fs_t* fs, uint32_t inode) {
+  int32_t fd;
+  mount_t* mnt;
+  for (fd = 0; fd < FDT_MAX_ENTRIES; fd++) {
+    if (!pcb->fdt[fd].flags.enabled || !pcb->fdt[fd].flags.is_data_file ||
+        pcb->fdt[fd].inode_idx != inode)
+      continue;
+    mnt = vfs_get_mount(pcb->fdt[fd].flags.mount);
+    if (mnt != NULL && mnt->fs == fs) return 1;
+  }
+  return 0;
+}
+
+/* Name: file_is_running()
+ * Description: checks whether a live process runs a program loaded from a
+ *              file. Its pages are read in from the file as they are first
+ *              touched, so the file has to stay as it is until it halts
+ * Inputs: fs: the mounted image, NULL for the tmpfs
+ *         inode: the file's inode, or its index in the tmpfs
+ * Outputs: none
+ * Return Value: 1 if a process runs the file, 0 if none does
+ * Side Effects: none
+ */
+int32_t file_is_running(fs_t* fs, uint32_t inode) {
+  pcb_t* pcb;
+  mount_t* mnt;
+  for (pcb = get_live_pcbs(); pcb != NULL; pcb = pcb->next) {
+    if (pcb->exe_inode != inode) continue;
+    mnt = vfs_get_mount(pcb->exe_mount);
+    if (mnt != NULL && mnt->fs == fs) return 1;
+  }
+  return 0;
+}
+
+/* Name: file_is_open()
+ * Description: checks whether any process, or the kernel on the boot stack,
+ *              has a file of an image open, or runs the program in it
+ * Inputs: fs: the mounted image, inode: the file's inode
+ * Outputs: none
+ * Return Value: 1 if the file is open or running, 0 if it isn't
+ * Side Effects: none
+ */
+static int32_t file_is_open(fs_t* fs, uint32_t inode) {
+  pcb_t* pcb;
+  if (file_is_running(fs, inode)) return 1;
+  if (pcb_has_file_open(get_boot_pcb(), fs, inode)) return 1;
+  for (pcb = get_live_pcbs(); pcb != NULL; pcb = pcb->next)
+    if (pcb_has_file_open(pcb, fs, inode)) return 1;
+  return 0;
+}
+
+/* Name: file_delete()
+ * Description: removes a regular file from the directory and frees its inode
+ *              and data blocks
+ * Inputs: fs: the mounted image
+ *         fname: the name of the file to delete
+ * Outputs: none
+ * Return Value: 0 on success, -1 on failure or if the file is open or
+ *               running, as its inode would be given to the next file
+ *               created
+ * Side Effects: the last boot block entry is moved into a freed boot block
+ *               slot, extended directory entries are shifted down
+ */
+int32_t file_delete(fs_t* fs, const uint8_t* fname) {
+  if (fs->on_disk) return ERROR;  // disk images are read only
+  if (strlen((int8_t*)fname) > FILE_NAME_SIZE) return ERROR;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  int32_t i = dentry_lookup(fs, fname);
+  if (i == -1 || get_dentry(fs, i)->file_type != FILE_TYPE_FILE) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  uint32_t inode = get_dentry(fs, i)->inode_num;
+  if (file_is_open(fs, inode)) {
+    restore_flags(flags);
+    return ERROR;
+  }
+  file_truncate(fs, inode, 0);
+  if (inode < fs->alloc_inodes)
+    fs->inode_bitmap[inode / BITMAP_WORD_BITS] &=
+        ~(1u << (inode % BITMAP_WORD_BITS));
+
+  if (i >= fs->num_dir_entries) {
+    ext_dentry_remove(fs, i - fs->num_dir_entries);
+    restore_flags(flags);
+    return 0;
+  }
+
+  // keep the directory dense so dir_read can walk it by index
+  fs->num_dir_entries--;
+  if (i != fs->num_dir_entries)
+    memcpy(&fs->dir_entries[i], &fs->dir_entries[fs->num_dir_entries],
+           DIR_ENTRY_SIZE_BYTES);
+  memset(&fs->dir_entries[fs->num_dir_entries], 0, DIR_ENTRY_SIZE_BYTES);
+  fs->boot_block->num_dir_entries = fs->num_dir_entries;
+
+  // entries moved, so the index has to be rebuilt
+  dentry_index_build(fs);
+
+  restore_flags(flags);
+  return 0;
+}
+
 /* Name: get_file_size()
  * Description: gets the file size in bytes
- * Inputs: inode_idx: the index of the inode
+ * Inputs: fs: the mounted image
+ *         inode_idx: the index of the inode
+ * Outputs: none
+ * Return Value: the number of bytes at the inode_idx, 0 if the disk can't be
+ *               read
+ * Side Effects: none
+ */
+int32_t get_file_size(fs_t* fs, uint32_t inode_idx) {
+  inode_t* curr_node = fs_inode(fs, inode_idx);
+  return curr_node ? curr_node->length_in_bytes : 0;
+}
+
+/* Name: get_file_stat()
+ * Description: fills in a file's metadata from the directory entry fields
+ *              and the inode table, without reading any file data
+ * Inputs: fs: the mounted image
+ *         file_type: the type from the directory entry, inode_idx: the index
+ *         of the inode, stat: where to write the metadata
  * Outputs: none
- * Return Value: the number of bytes at the inode_idx
+ * Return Value: 0 on success, -1 on a bad inode or a disk error
  * Side Effects: none
  */
-int32_t get_file_size(uint32_t inode_idx) {
-  return inodes[inode_idx].length_in_bytes;
+int32_t get_file_stat(fs_t* fs, uint32_t file_type, uint32_t inode_idx,
+                      stat_t* stat) {
+  stat->file_type = file_type;
+  stat->inode_num = inode_idx;
+  stat->file_size = 0;
+  stat->num_blocks = 0;
+
+  // only regular files own an inode
+  if (file_type != FILE_TYPE_FILE) return 0;
+  if (inode_idx >= fs->num_inodes) return ERROR;
+  inode_t* curr_node = fs_inode(fs, inode_idx);
+  if (curr_node == NULL) return ERROR;
+
+  stat->file_size = curr_node->length_in_bytes;
+  stat->num_blocks = inode_num_blocks(fs, curr_node);
+  return 0;
 }
 
 /* Name: get_num_dir_entries()
- * Description: gets the number of directory entries
- * Inputs: none
+ * Description: gets the number of directory entries, including the ones in
+ *              the extended directory
+ * Inputs: fs: the mounted image
  * Outputs: none
  * Return Value: returns the number of directory entries
  * Side Effects: none
  */
-int32_t get_num_dir_entries() { return num_dir_entries; }
+int32_t get_num_dir_entries(fs_t* fs) {
+  return fs->num_dir_entries + fs->num_ext_entries;
+}
+
+/* Name: get_num_free_data_blocks()
+ * Description: gets the number of data blocks not used by any file
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: returns the number of free data blocks
+ * Side Effects: none
+ */
+int32_t get_num_free_data_blocks(fs_t* fs) { return fs->num_free_data_blocks; }
+
+/* Name: get_num_shared_data_blocks()
+ * Description: gets the number of data blocks used by more than one file,
+ *              found when the image is mounted
+ * Inputs: fs: the mounted image
+ * Outputs: none
+ * Return Value: returns the number of shared data blocks
+ * Side Effects: none
+ */
+int32_t get_num_shared_data_blocks(fs_t* fs) {
+  return fs->num_shared_data_blocks;
+}
+
+/* Name: get_dentry_index_stats()
+ * Description: copies out the directory name index lookup counters
+ * Inputs: fs: the mounted image
+ *         stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_dentry_index_stats(fs_t* fs, dentry_index_stats_t* stats) {
+  memcpy(stats, &fs->dentry_stats, sizeof(dentry_index_stats_t));
+}
+
+/* Name: get_ind_stats()
+ * Description: copies out the indirect block cache counters, lookups of
+ *              version 3 blocks past the direct ones since the image was
+ *              mounted
+ * Inputs: fs: the mounted image
+ *         stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_ind_stats(fs_t* fs, ind_stats_t* stats) {
+  memcpy(stats, &fs->ind_stats, sizeof(ind_stats_t));
+}
@@ -15,18 +15,90 @@
 #define DATA_BLOCK 1023
 #define FILE_NAME_SIZE 32
 #define RESERVED24 24
-#define RESERVED52 52
+#define RESERVED40 40
 #define NUM_DIR_ENTRY 63
 
+// Layout of an image, the boot block, then the inodes, then the data blocks
+#define FS_BOOT_BLOCK 0
+#define FS_INODE_START 1
+
+// Version 2 images have extent inodes, a file is a list of runs of data
+// blocks instead of one index per block
+#define FS_V2_MAGIC 0x32534642  // "BFS2"
+#define MAX_EXTENTS 510
+
+// Version 3 images keep one index per block, but the last two indices of
+// the inode point at blocks of indices, a single indirect block for the
+// blocks after the direct ones and a double indirect block for the rest
+#define FS_V3_MAGIC 0x33534642  // "BFS3"
+#define DIRECT_BLOCKS 1021
+#define IND_SLOT 1021
+#define DIND_SLOT 1022
+#define INDICES_PER_BLOCK (BLOCK_SIZE_BYTES / 4)
+#define IND_LIMIT (DIRECT_BLOCKS + INDICES_PER_BLOCK)  // first double block
+#define DIND_LIMIT (IND_LIMIT + INDICES_PER_BLOCK * INDICES_PER_BLOCK)
+
+// Values of inode_flags on version 2 images. A compressed file's one extent
+// holds a table of num_blocks + 1 stream offsets and then each 4 kB block of
+// the file compressed on its own (see lz.h), stored as is if that's smaller
+#define INODE_COMPRESSED 0x1
+
+// Values of dir_entry_t file_type
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIR 1
+#define FILE_TYPE_FILE 2
+
+// Extended directory, entries past the boot block live sorted by name in the
+// data blocks of dir_inode. Images without the magic only use the boot block
+#define DIR_EXT_MAGIC 0x44495245  // "ERID"
+#define DIR_ENTRIES_PER_BLOCK (BLOCK_SIZE_BYTES / DIR_ENTRY_SIZE_BYTES)
+#define MAX_EXT_DIR_ENTRIES (DATA_BLOCK * DIR_ENTRIES_PER_BLOCK)
+
+// Capacity of the free block and inode bitmaps built at mount
+#define FS_MAX_DATA_BLOCKS 16384  // 64 MB of data blocks
+#define FS_MAX_INODES 1024
+#define BITMAP_WORD_BITS 32
+#define BITMAP_FULL_WORD 0xFFFFFFFF
+#define NO_FREE_BLOCK (-1)
+
+// Files of a deduplicated image share identical data blocks, each block
+// counts the files using it. A count that reaches the maximum stays there
+// and the block is never freed
+#define FS_MAX_BLOCK_REFS 0xFF
+#define FS_MAX_BLOCK_MAPS 0xFF
+
+// Directory name index, sized to keep the load factor under 1/2
+#define DENTRY_HASH_SIZE 128
+#define DENTRY_HASH_MASK (DENTRY_HASH_SIZE - 1)
+#define DENTRY_HASH_EMPTY (-1)
+#define DENTRY_FILTER_BITS 1024
+#define DENTRY_FILTER_WORDS (DENTRY_FILTER_BITS / 32)
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
 /* --- Local Types --- */
 
+// length data blocks starting at data block start
+typedef struct extent {
+  uint32_t start;
+  uint32_t length;
+} __attribute__((packed)) extent_t;
+
 // 4096 byte inode
 typedef struct inode {
   union {
     uint8_t val[BLOCK_SIZE_BYTES];
     struct {
       uint32_t length_in_bytes;
-      uint32_t data_block_indices[DATA_BLOCK];
+      union {
+        uint32_t data_block_indices[DATA_BLOCK];
+        struct {  // version 2 images
+          uint32_t num_extents;
+          extent_t extents[MAX_EXTENTS];
+          uint32_t inode_flags;
+          uint32_t inode_reserved;
+        } __attribute__((packed));
+      };
     } __attribute__((packed));
   };
 } inode_t;
@@ -55,15 +127,99 @@ typedef struct boot_block {
       uint32_t num_dir_entries;
       uint32_t num_inodes;
       uint32_t num_data_blocks;
-      uint8_t reserved[RESERVED52];
+      uint32_t dir_magic;  // DIR_EXT_MAGIC if dir_inode is valid
+      uint32_t dir_inode;  // inode holding the extended directory
+      uint32_t fs_magic;   // FS_V2_MAGIC for version 2 images
+      uint8_t reserved[RESERVED40];
       dir_entry_t dir_entries[NUM_DIR_ENTRY];
     } __attribute__((packed));
   };
 } boot_block_t;
 
+// Packed record filled in by dir_getdents, one per directory entry
+typedef struct dirent {
+  char file_name[FILE_NAME_SIZE];
+  uint32_t file_type;
+  uint32_t inode_num;
+  uint32_t file_size;
+} __attribute__((packed)) dirent_t;
+
+// File metadata filled in by stat and fstat
+typedef struct stat {
+  uint32_t file_size;   // length in bytes, 0 for rtc and the directory
+  uint32_t file_type;   // FILE_TYPE_RTC, FILE_TYPE_DIR or FILE_TYPE_FILE
+  uint32_t inode_num;
+  uint32_t num_blocks;  // data blocks used by the file
+} stat_t;
+
+// Counters for read_dentry_by_name lookups through the hash index
+typedef struct dentry_index_stats {
+  uint32_t hits;      // name found in the index
+  uint32_t ext_hits;  // name found in the extended directory past the index
+  uint32_t misses;    // name not in the directory
+  uint32_t filtered;  // misses answered by the filter without probing
+} dentry_index_stats_t;
+
+// Counters for finding the indirect block that maps a block of a file
+typedef struct ind_stats {
+  uint32_t hits;    // the block was in the table cached for the file
+  uint32_t misses;  // the table was found through the inode
+} ind_stats_t;
+
+// State of one mounted file system image
+typedef struct fs {
+  uint32_t file_system_addr;  // start of an image in memory
+  boot_block_t* boot_block;
+  // read through the block cache instead of memory, disk images are read only
+  uint8_t on_disk;
+  uint8_t extents;   // inodes hold extents, the image is version 2
+  uint8_t indirect;  // inodes have indirect blocks, the image is version 3
+
+  dir_entry_t* dir_entries;  // in the boot block, used as array[]
+  int32_t num_dir_entries;
+  int32_t num_inodes;
+  uint32_t data_start;  // block number of data block 0
+  int32_t num_data_blocks;
+
+  // extended directory past the boot block, -1 if the image doesn't have one
+  int32_t dir_inode;
+  int32_t num_ext_entries;
+
+  // open addressed hash table of dir_entries indices, keyed by file name
+  int8_t dentry_hash_table[DENTRY_HASH_SIZE];
+  // one bit per name hash, a clear bit means the name is not in the directory
+  uint32_t dentry_filter[DENTRY_FILTER_WORDS];
+  dentry_index_stats_t dentry_stats;
+
+  // bumped when an indirect block is allocated or freed, so tables cached
+  // for open files are dropped
+  uint32_t ind_gen;
+  ind_stats_t ind_stats;
+
+  // one bit per data block / inode, a set bit means it is in use
+  uint32_t data_block_bitmap[FS_MAX_DATA_BLOCKS / BITMAP_WORD_BITS];
+  uint32_t inode_bitmap[FS_MAX_INODES / BITMAP_WORD_BITS];
+  // data blocks / inodes the bitmaps track, the rest are never allocated
+  uint32_t alloc_data_blocks;
+  uint32_t alloc_inodes;
+  // word to start the next free search from, so allocation is amortized O(1)
+  uint32_t data_block_hint;
+  uint32_t inode_hint;
+  int32_t num_free_data_blocks;
+  // references to each data block, a block with more than one is copied
+  // before it is written
+  uint8_t data_block_refs[FS_MAX_DATA_BLOCKS];
+  int32_t num_shared_data_blocks;
+  // mmap mappings of each data block, kept out of data_block_refs so a
+  // mapping isn't counted as sharing. A mapped block is copied before it
+  // is written and only freed once no file and no mapping use it
+  uint8_t data_block_maps[FS_MAX_DATA_BLOCKS];
+} fs_t;
+
 /* --- Function Prototypes --- */
 
-void file_system_init(uint32_t file_system_start_addr);
+void file_system_init(fs_t* fs, uint32_t file_system_start_addr);
+int32_t file_system_init_disk(fs_t* fs);
 
 int32_t file_open(const uint8_t* filename);
 int32_t file_close(int32_t fd);
@@ -74,12 +230,44 @@ int32_t dir_open(const uint8_t* filename);
 int32_t dir_close(int32_t fd);
 int32_t dir_read(int32_t fd, void* buf, int32_t nbytes);
 int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes);
+int32_t dir_seek(int32_t fd, int32_t offset, int32_t whence);
 
-int32_t read_dentry_by_name(const uint8_t* fname, dir_entry_t* dir_entry);
-int32_t read_dentry_by_index(uint32_t index, dir_entry_t* dir_entry);
-int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf,
+int32_t file_seek(int32_t fd, int32_t offset, int32_t whence);
+int32_t seek_position(uint32_t curr, uint32_t end, int32_t offset,
+                      int32_t whence);
+int32_t file_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+int32_t file_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t file_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+int32_t read_dentry_by_name(fs_t* fs, const uint8_t* fname,
+                            dir_entry_t* dir_entry);
+int32_t read_dentry_by_index(fs_t* fs, uint32_t index, dir_entry_t* dir_entry);
+int32_t read_data(fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf,
                   uint32_t length);
-int32_t get_file_size(uint32_t inode_idx);
-int32_t get_num_dir_entries();
+int32_t read_data_cached(fs_t* fs, uint32_t inode, uint32_t offset,
+                         uint8_t* buf, uint32_t length, ind_cache_t* cache);
+int32_t get_data_run(fs_t* fs, uint32_t inode, uint32_t offset,
+                     const uint8_t** data);
+int32_t get_data_run_cached(fs_t* fs, uint32_t inode, uint32_t offset,
+                            const uint8_t** data, ind_cache_t* cache);
+uint32_t map_data_block(fs_t* fs, uint32_t inode, uint32_t idx);
+void unmap_data_block(fs_t* fs, uint32_t addr);
+int32_t write_data(fs_t* fs, uint32_t inode, uint32_t offset,
+                   const uint8_t* buf, uint32_t length);
+int32_t get_file_size(fs_t* fs, uint32_t inode_idx);
+int32_t get_file_stat(fs_t* fs, uint32_t file_type, uint32_t inode_idx,
+                      stat_t* stat);
+int32_t get_num_dir_entries(fs_t* fs);
+
+int32_t file_create(fs_t* fs, const uint8_t* fname);
+int32_t file_delete(fs_t* fs, const uint8_t* fname);
+int32_t file_truncate(fs_t* fs, uint32_t inode, uint32_t length);
+int32_t file_is_running(fs_t* fs, uint32_t inode);
+int32_t get_num_free_data_blocks(fs_t* fs);
+int32_t get_num_shared_data_blocks(fs_t* fs);
+uint32_t dentry_name_hash(const uint8_t* fname);
+void get_dentry_index_stats(fs_t* fs, dentry_index_stats_t* stats);
+void get_ind_stats(fs_t* fs, ind_stats_t* stats);
 
 #endif
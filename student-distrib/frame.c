@@ -0,0 +1,284 @@
+#include "frame.h"
+
+// Global Variables
+static uint8_t frame_info[FRAME_COUNT];  // state of the block starting there
+static uint16_t frame_next[FRAME_COUNT];  // free lists, linked by frame
+static uint16_t frame_prev[FRAME_COUNT];
+static uint16_t free_lists[FRAME_MAX_ORDER + 1];
+static uint8_t frame_refs[FRAME_COUNT];  // references past the first
+
+static frame_range_t reserved[FRAME_MAX_RESERVED];
+static uint32_t num_reserved;
+static uint32_t frame_limit;  // end of the highest managed frame
+static frame_stats_t frame_stats;
+
+/* Name: list_push()
+ * Description: puts a free block on the free list of its order
+ * Inputs: frame: first frame of the block, order: its order
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: updates the counters
+ */
+static void list_push(uint32_t frame, uint32_t order) {
+  frame_info[frame] = order | FRAME_FREE;
+  frame_prev[frame] = FRAME_NONE;
+  frame_next[frame] = free_lists[order];
+  if (free_lists[order] != FRAME_NONE) frame_prev[free_lists[order]] = frame;
+  free_lists[order] = frame;
+
+  frame_stats.free_blocks[order]++;
+  frame_stats.free_frames += 1 << order;
+}
+
+/* Name: list_remove()
+ * Description: takes a free block off the free list of its order
+ * Inputs: frame: first frame of the block, order: its order
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: updates the counters, the block's state is left for the
+ *               caller to set
+ */
+static void list_remove(uint32_t frame, uint32_t order) {
+  if (frame_prev[frame] != FRAME_NONE)
+    frame_next[frame_prev[frame]] = frame_next[frame];
+  else
+    free_lists[order] = frame_next[frame];
+  if (frame_next[frame] != FRAME_NONE)
+    frame_prev[frame_next[frame]] = frame_prev[frame];
+
+  frame_stats.free_blocks[order]--;
+  frame_stats.free_frames -= 1 << order;
+}
+
+/* Name: frame_init()
+ * Description: empties the allocator, call before frame_reserve and
+ *              frame_add_region
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: every frame is marked as not RAM
+ */
+void frame_init() {
+  memset(frame_info, FRAME_UNUSED, sizeof(frame_info));
+  memset(free_lists, 0xFF, sizeof(free_lists));  // every list is FRAME_NONE
+  memset(&frame_stats, 0, sizeof(frame_stats));
+  num_reserved = 0;
+  frame_limit = FRAME_MIN_ADDR;
+}
+
+/* Name: frame_reserve()
+ * Description: keeps a range of memory, such as a module, from being added
+ *              by frame_add_region
+ * Inputs: start: first byte of the range, end: byte after it
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: ranges past FRAME_MAX_RESERVED are dropped
+ */
+void frame_reserve(uint32_t start, uint32_t end) {
+  if (num_reserved == FRAME_MAX_RESERVED) return;
+  reserved[num_reserved].start = start;
+  reserved[num_reserved].end = end;
+  num_reserved++;
+}
+
+/* Name: frame_add_region()
+ * Description: adds the frames of a range of RAM from the multiboot memory
+ *              map, the part of it between FRAME_MIN_ADDR and FRAME_MAX_ADDR
+ *              that isn't reserved. Neighbouring frames are merged into
+ *              larger blocks as they are freed
+ * Inputs: base: start of the range, length: its size in bytes
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: updates frame_limit
+ */
+void frame_add_region(uint32_t base, uint32_t length) {
+  uint32_t addr, end, i;
+
+  end = (base + length < base) ? FRAME_MAX_ADDR : base + length;  // wraps
+  if (end > FRAME_MAX_ADDR) end = FRAME_MAX_ADDR;
+  end &= ~(FRAME_SIZE - 1);
+  addr = (base + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+  if (addr < FRAME_MIN_ADDR) addr = FRAME_MIN_ADDR;
+
+  // the ranges of the map don't overlap, so each frame is added once
+  for (; addr < end; addr += FRAME_SIZE) {
+    for (i = 0; i < num_reserved; i++)
+      if (addr + FRAME_SIZE > reserved[i].start && addr < reserved[i].end)
+        break;
+    if (i < num_reserved) continue;
+
+    frame_info[addr >> FRAME_SHIFT] = FRAME_ORDER_4KB;  // as if allocated
+    frame_free(addr, FRAME_ORDER_4KB);
+    frame_stats.total_frames++;
+    if (addr + FRAME_SIZE > frame_limit) frame_limit = addr + FRAME_SIZE;
+  }
+}
+
+/* Name: frame_get_limit()
+ * Description: gets the end of the managed RAM, the kernel maps memory from
+ *              FRAME_MIN_ADDR up to it
+ * Inputs: none
+ * Outputs: none
+ * Return Value: address of the byte after the highest frame
+ * Side Effects: none
+ */
+uint32_t frame_get_limit() { return frame_limit; }
+
+/* Name: frame_alloc()
+ * Description: allocates a block of 2^order frames aligned to its size. The
+ *              smallest free block that is large enough is split in halves,
+ *              the unused halves go back on the free lists
+ * Inputs: order: FRAME_ORDER_4KB for a frame up to FRAME_ORDER_4MB for a
+ *         large page
+ * Outputs: none
+ * Return Value: physical address of the block, 0 if none is free
+ * Side Effects: none
+ */
+uint32_t frame_alloc(uint32_t order) {
+  uint32_t flags, frame, k;
+  if (order > FRAME_MAX_ORDER) return 0;
+
+  cli_and_save(flags);
+
+  for (k = order; k <= FRAME_MAX_ORDER && free_lists[k] == FRAME_NONE; k++)
+    ;
+  if (k > FRAME_MAX_ORDER) {
+    frame_stats.failed++;
+    restore_flags(flags);
+    return 0;
+  }
+
+  frame = free_lists[k];
+  list_remove(frame, k);
+  while (k > order) {
+    k--;
+    list_push(frame + (1 << k), k);  // the upper half stays free
+  }
+  frame_info[frame] = order;
+  frame_refs[frame] = 0;
+  frame_stats.allocs++;
+
+  restore_flags(flags);
+  return frame << FRAME_SHIFT;
+}
+
+/* Name: frame_free()
+ * Description: frees a block from frame_alloc, merging it with its buddy,
+ *              the other half of the block of the next order, for as long
+ *              as the buddy is free too
+ * Inputs: addr: the address frame_alloc returned, order: the order it was
+ *         allocated with
+ * Outputs: none
+ * Return Value: 0 on success, -1 if addr isn't an allocated block of that
+ *               order
+ * Side Effects: none
+ */
+int32_t frame_free(uint32_t addr, uint32_t order) {
+  uint32_t flags, frame = addr >> FRAME_SHIFT, buddy;
+  if (addr % FRAME_SIZE || frame >= FRAME_COUNT || order > FRAME_MAX_ORDER)
+    return ERROR;
+
+  cli_and_save(flags);
+
+  if (frame_info[frame] != order) {
+    restore_flags(flags);
+    return ERROR;  // free or a different size
+  }
+
+  for (; order < FRAME_MAX_ORDER; order++) {
+    buddy = frame ^ (1 << order);
+    if (buddy >= FRAME_COUNT || frame_info[buddy] != (order | FRAME_FREE))
+      break;
+    list_remove(buddy, order);
+    frame_info[buddy] = FRAME_UNUSED;
+    frame_info[frame] = FRAME_UNUSED;
+    if (buddy < frame) frame = buddy;
+  }
+  list_push(frame, order);
+
+  restore_flags(flags);
+  return 0;
+}
+
+/* Name: frame_get_order()
+ * Description: gets the order a block was allocated with, for callers such
+ *              as kfree that only keep the address
+ * Inputs: addr: the address frame_alloc returned
+ * Outputs: none
+ * Return Value: the order of the block, -1 if addr isn't an allocated block
+ * Side Effects: none
+ */
+int32_t frame_get_order(uint32_t addr) {
+  uint32_t frame = addr >> FRAME_SHIFT;
+  if (addr % FRAME_SIZE || frame >= FRAME_COUNT) return ERROR;
+  if (frame_info[frame] > FRAME_MAX_ORDER) return ERROR;  // free or not RAM
+  return frame_info[frame];
+}
+
+/* Name: frame_get()
+ * Description: adds a reference to an allocated 4 kB frame, for a page that
+ *              is mapped by more than one process
+ * Inputs: addr: the address frame_alloc returned
+ * Outputs: none
+ * Return Value: 0 on success, -1 if addr isn't an allocated frame or it has
+ *               FRAME_MAX_REFS references already
+ * Side Effects: none
+ */
+int32_t frame_get(uint32_t addr) {
+  uint32_t flags, frame = addr >> FRAME_SHIFT;
+  if (frame_get_order(addr) != FRAME_ORDER_4KB) return ERROR;
+
+  cli_and_save(flags);
+  if (frame_refs[frame] == FRAME_MAX_REFS - 1) {
+    restore_flags(flags);
+    return ERROR;
+  }
+  frame_refs[frame]++;
+  restore_flags(flags);
+  return 0;
+}
+
+/* Name: frame_put()
+ * Description: drops a reference to a 4 kB frame, freeing it when it was the
+ *              last one
+ * Inputs: addr: the address frame_alloc returned
+ * Outputs: none
+ * Return Value: 0 on success, -1 if addr isn't an allocated frame
+ * Side Effects: none
+ */
+int32_t frame_put(uint32_t addr) {
+  uint32_t flags, frame = addr >> FRAME_SHIFT;
+  if (frame_get_order(addr) != FRAME_ORDER_4KB) return ERROR;
+
+  cli_and_save(flags);
+  if (frame_refs[frame] > 0) {
+    frame_refs[frame]--;
+    restore_flags(flags);
+    return 0;
+  }
+  restore_flags(flags);
+  return frame_free(addr, FRAME_ORDER_4KB);
+}
+
+/* Name: frame_get_refs()
+ * Description: gets the number of references to a 4 kB frame
+ * Inputs: addr: the address frame_alloc returned
+ * Outputs: none
+ * Return Value: the references, 0 if addr isn't an allocated frame
+ * Side Effects: none
+ */
+uint32_t frame_get_refs(uint32_t addr) {
+  if (frame_get_order(addr) != FRAME_ORDER_4KB) return 0;
+  return frame_refs[addr >> FRAME_SHIFT] + 1;
+}
+
+/* Name: get_frame_stats()
+ * Description: copies out the frame allocator counters
+ * Inputs: stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_frame_stats(frame_stats_t* stats) {
+  memcpy(stats, &frame_stats, sizeof(frame_stats_t));
+}
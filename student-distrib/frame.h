@@ -0,0 +1,64 @@
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// Physical memory is handed out in blocks of 2^order 4 kB frames, from one
+// frame up to a 4 MB large page. Memory below 8 MB holds the kernel, its
+// modules and the kernel stacks, and the kernel maps the RAM above that up
+// to 128 MB where user programs start, so only that range is managed
+#define FRAME_SIZE 4096
+#define FRAME_SHIFT 12
+#define FRAME_MIN_ADDR 0x800000   // 8 MB
+#define FRAME_MAX_ADDR 0x8000000  // 128 MB
+#define FRAME_COUNT (FRAME_MAX_ADDR >> FRAME_SHIFT)
+#define FRAME_MAX_ORDER 10  // 4 MB
+#define FRAME_ORDER_4KB 0
+#define FRAME_ORDER_4MB FRAME_MAX_ORDER
+#define FRAME_NONE 0xFFFF  // end of a free list
+
+// State of a frame in frame_info, only the first frame of a block has one
+#define FRAME_FREE 0x80  // or'd with the order of a free block
+#define FRAME_UNUSED 0x7F  // inside a block, or not RAM
+
+#define FRAME_MAX_RESERVED 16  // ranges, such as modules, kept off the lists
+
+// A 4 kB frame can be shared, by processes after a fork, and is only freed
+// when its last reference is put. frame_alloc hands it out with one
+#define FRAME_MAX_REFS 256
+
+/* --- Local Types --- */
+
+// A range of physical memory frame_add_region must not hand out
+typedef struct frame_range {
+  uint32_t start;
+  uint32_t end;
+} frame_range_t;
+
+// Counters for the frame allocator
+typedef struct frame_stats {
+  uint32_t total_frames;  // 4 kB frames of RAM that are managed
+  uint32_t free_frames;
+  uint32_t free_blocks[FRAME_MAX_ORDER + 1];  // free blocks of each order
+  uint32_t allocs;
+  uint32_t failed;  // allocations there was no free block for
+} frame_stats_t;
+
+/* --- Function Prototypes --- */
+
+void frame_init();
+void frame_reserve(uint32_t start, uint32_t end);
+void frame_add_region(uint32_t base, uint32_t length);
+uint32_t frame_get_limit();
+uint32_t frame_alloc(uint32_t order);
+int32_t frame_free(uint32_t addr, uint32_t order);
+int32_t frame_get_order(uint32_t addr);
+int32_t frame_get(uint32_t addr);
+int32_t frame_put(uint32_t addr);
+uint32_t frame_get_refs(uint32_t addr);
+void get_frame_stats(frame_stats_t* stats);
+
+#endif
@@ -14,18 +14,19 @@ void init_idt() {
                     MF_EXC, AC_EXC, MC_EXC, XF_EXC, VE_EXC, SX_EXC};
 
   // array containing the possible interrupts
-  int int_vect[] = {NI_EXC, KB_INT, RT_INT, PT_INT};
+  int int_vect[] = {NI_EXC, KB_INT, RT_INT, PT_INT, AT_INT};
 
   // array containing all the exception handlers
   void* exc_handlers[] = {DE_handler, DB_handler, BP_handler, OF_handler,
                           BR_handler, UD_handler, NM_handler, DF_handler,
                           CP_handler, TS_handler, NP_handler, SS_handler,
-                          GP_handler, PF_handler, MF_handler, AC_handler,
-                          MC_handler, XF_handler, VE_handler, SX_handler};
+                          GP_handler, PF_handler_wrapper, MF_handler,
+                          AC_handler, MC_handler, XF_handler, VE_handler,
+                          SX_handler};
 
   // array containing all the interrupt handlers
   void* int_handlers[] = {NI_handler, KB_handler_wrapper, RT_handler_wrapper,
-                          PT_handler_wrapper};
+                          PT_handler_wrapper, AT_handler_wrapper};
 
   int i;  // iterator to go through each exception
 
@@ -242,13 +243,17 @@ void GP_handler() {
 }
 
 /* Name: PF_handler()
- * Description: Page Fault exception handler.
- * Inputs: None
+ * Description: Page Fault exception handler. Faults on pages of the program
+ *              that haven't been touched yet are resolved, the rest halt it
+ * Inputs: error: the error code the CPU pushed
  * Outputs: None
  * Return Value: None
- * Side Effects: Prints the message onto the screen.
+ * Side Effects: Maps the page, or prints the message onto the screen.
  */
-void PF_handler() {
+void PF_handler(uint32_t error) {
+  uint32_t addr;
+  asm volatile("movl %%cr2, %0" : "=r"(addr));
+  if (handle_user_fault(addr, error) == 0) return;
   blue_screen("Page Fault");
 }
 
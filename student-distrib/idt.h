@@ -39,11 +39,12 @@
 #define KB_INT 0x21 /* Keyboard Interrupt */
 #define RT_INT 0x28 /* RTC Interrupt */
 #define PT_INT 0x20 /* PIT Interrupt */
+#define AT_INT 0x2E /* Primary IDE Channel Interrupt */
 
 #define SYS_CALL 0x80 /* System call vector */
 
 #define NUM_EXCEPTIONS 20
-#define NUM_INTERRUPTS 16
+#define NUM_INTERRUPTS 5
 #define NUM_HANDLERS (NUM_EXCEPTIONS + NUM_INTERRUPTS)
 
 /* --- Function Prototypes ---
@@ -67,7 +68,7 @@ void TS_handler();
 void NP_handler();
 void SS_handler();
 void GP_handler();
-void PF_handler();
+void PF_handler(uint32_t error);
 void MF_handler();
 void AC_handler();
 void MC_handler();
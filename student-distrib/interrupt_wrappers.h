@@ -1,6 +1,7 @@
 #ifndef _INTERRUPT_WRAPPER_H
 #define _INTERRUPT_WRAPPER_H
 
+#include "ata.h"
 #include "keyboard.h"
 #include "lib.h"
 #include "rtc.h"
@@ -9,6 +10,8 @@
 extern void KB_handler_wrapper();
 extern void RT_handler_wrapper();
 extern void PT_handler_wrapper();
+extern void AT_handler_wrapper();
 extern void SYS_handler_wrapper();
+extern void PF_handler_wrapper();
 
 #endif
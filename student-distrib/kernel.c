@@ -2,17 +2,24 @@
  * vim:ts=4 noexpandtab
  */
 
+#include "ata.h"
+#include "block_cache.h"
 #include "debug.h"
 #include "file_system.h"
+#include "frame.h"
 #include "i8259.h"
 #include "idt.h"
 #include "keyboard.h"
+#include "kmalloc.h"
 #include "lib.h"
 #include "multiboot.h"
 #include "paging.h"
 #include "rtc.h"
 #include "pit.h"
+#include "shm.h"
 #include "tests.h"
+#include "tmpfs.h"
+#include "vfs.h"
 #include "x86_desc.h"
 
 #define RUN_TESTS
@@ -21,12 +28,17 @@
 /* Check if the bit BIT in FLAGS is set. */
 #define CHECK_FLAG(flags, bit) ((flags) & (1 << (bit)))
 
+#define MULTIBOOT_MEMORY_AVAILABLE 1  // type of RAM in the memory map
+#define MEM_UPPER_START 0x100000      // mem_upper counts kB from 1MB
+
 /* Check if MAGIC is valid and print the Multiboot information structure
    pointed by ADDR. */
 void entry(unsigned long magic, unsigned long addr) {
   multiboot_info_t *mbi;
 
-  uint32_t file_system_addr;
+  // every module is a file system image, mounted once paging is on
+  uint32_t mod_addrs[VFS_MAX_MODULES];
+  int num_mods = 0;
 
   /* Clear the screen. */
   clear();
@@ -40,6 +52,9 @@ void entry(unsigned long magic, unsigned long addr) {
   /* Set MBI to the address of the Multiboot information structure. */
   mbi = (multiboot_info_t *)addr;
 
+  // physical memory is added from the memory map, minus the modules
+  frame_init();
+
   /* Print out the flags. */
   // printf("flags = 0x%#x\n", (unsigned)mbi->flags);
 
@@ -61,9 +76,14 @@ void entry(unsigned long magic, unsigned long addr) {
         // int i;
         module_t *mod = (module_t *)mbi->mods_addr;
 
-        file_system_addr = mod->mod_start;  // Get file system address
-
-        while (mod_count < mbi->mods_count) {  // Only 1 module, loops once
+        while (mod_count < mbi->mods_count) {
+          // the last mounts are kept for the tmpfs and the disk
+          if (num_mods < VFS_MAX_MODULES)
+            mod_addrs[num_mods++] = mod->mod_start;
+          else
+            printf("Module %d not mounted, the mount table is full\n",
+                   mod_count);
+          frame_reserve(mod->mod_start, mod->mod_end);
           // printf("Module %d loaded at address: 0x%#x\n", mod_count,
           //        (unsigned int)mod->mod_start);
           // printf("Module %d ends at address: 0x%#x\n", mod_count,
@@ -107,7 +127,14 @@ void entry(unsigned long magic, unsigned long addr) {
       //     (unsigned)mmap->size, (unsigned)mmap->base_addr_high,
       //     (unsigned)mmap->base_addr_low, (unsigned)mmap->type,
       //     (unsigned)mmap->length_high, (unsigned)mmap->length_low);
+      if (mmap->type != MULTIBOOT_MEMORY_AVAILABLE || mmap->base_addr_high)
+        continue;  // reserved, or above 4GB
+      frame_add_region(mmap->base_addr_low,
+                       mmap->length_high ? 0xFFFFFFFF : mmap->length_low);
     }
+  } else if (CHECK_FLAG(mbi->flags, 0)) {
+    // no memory map, all of the upper memory is RAM
+    frame_add_region(MEM_UPPER_START, mbi->mem_upper * 1024);
   }
 
   /* Construct an LDT entry in the GDT */
@@ -166,13 +193,42 @@ void entry(unsigned long magic, unsigned long addr) {
 
   enable_irq(RTC_IRQ_NUM);  // enable RTC interrupts
   enable_irq(KB_IRQ_NUM);   // enable keyboard interrupts
-  enable_irq(PT_IRQ_NUM);   // enable PIT interrupts
 
-  init_paging();  // Initialize and enable paging
-  init_pid();     // Initialize the array that keeps tracks of the PIDs in use
+  init_paging();   // Initialize and enable paging
+  kmalloc_init();  // Slab caches on top of the frames paging just mapped
+  init_pid();      // Free every PID and set up the PCB of the boot stack
+  shm_init();      // No shared memory segments yet
+
+  // Mount the first module as the root and the rest at "mod<i>/"
+  vfs_init();
+  int8_t prefix[VFS_PREFIX_SIZE];
+  int i;
+  for (i = 0; i < num_mods; i++) {
+    if (i == 0) {
+      strcpy(prefix, VFS_ROOT_PREFIX);
+    } else {
+      strcpy(prefix, VFS_MODULE_PREFIX);
+      itoa(i, prefix + strlen(prefix), 10);
+      strcpy(prefix + strlen(prefix), "/");
+    }
+    if (vfs_mount_image(prefix, mod_addrs[i]) == ERROR)
+      printf("Couldn't mount module %d at %s\n", i, prefix);
+  }
 
-  file_system_init(
-      file_system_addr);  // Initialize file system variables (boot block)
+  tmpfs_init();  // Empty the RAM backed scratch file system
+  if (vfs_mount(TMPFS_PREFIX, NULL, &tmpfs_ops, &tmpfs_fot, &tmpfs_dir_fot) ==
+      ERROR)
+    printf("Couldn't mount the tmpfs at %s\n", TMPFS_PREFIX);
+
+  // Mount the image on the primary IDE disk, if there is one. Disk reads
+  // sleep on IRQ 14 with interrupts on, so the PIT is enabled after this
+  if (ata_init() == 0) {
+    enable_irq(ATA_IRQ_NUM);
+    bcache_init();
+    if (vfs_mount_disk(VFS_DISK_PREFIX) == ERROR)
+      printf("Couldn't mount the disk at %s\n", VFS_DISK_PREFIX);
+  }
+  enable_irq(PT_IRQ_NUM);  // enable PIT interrupts
 
   /* Enable interrupts */
   /* Do not enable the following until after you have set up your
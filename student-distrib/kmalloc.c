@@ -0,0 +1,310 @@
+#include "kmalloc.h"
+
+// Global Variables
+static kmem_cache_t kmem_caches[KMEM_MAX_CACHES];  // the size classes first
+static uint32_t num_caches;
+static kmalloc_stats_t kmalloc_stats;
+
+static const char* class_names[KMALLOC_NUM_CLASSES] = {
+    "kmalloc-16",  "kmalloc-32",  "kmalloc-64",  "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024"};
+
+/* Name: slab_push()
+ * Description: puts a slab at the head of one of its cache's lists
+ * Inputs: list: the head of the list, slab: the slab, on no list
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void slab_push(slab_t** list, slab_t* slab) {
+  slab->prev = NULL;
+  slab->next = *list;
+  if (*list != NULL) (*list)->prev = slab;
+  *list = slab;
+}
+
+/* Name: slab_remove()
+ * Description: takes a slab off one of its cache's lists
+ * Inputs: list: the head of the list, slab: the slab, on that list
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void slab_remove(slab_t** list, slab_t* slab) {
+  if (slab->prev != NULL)
+    slab->prev->next = slab->next;
+  else
+    *list = slab->next;
+  if (slab->next != NULL) slab->next->prev = slab->prev;
+  slab->prev = slab->next = NULL;
+}
+
+/* Name: slab_new()
+ * Description: takes a frame for a new slab of a cache and links all of its
+ *              objects onto the slab's free list
+ * Inputs: cache: the cache the slab is for
+ * Outputs: none
+ * Return Value: the slab, on no list, NULL if there is no free frame
+ * Side Effects: none
+ */
+static slab_t* slab_new(kmem_cache_t* cache) {
+  slab_t* slab = (slab_t*)frame_alloc(FRAME_ORDER_4KB);
+  uint8_t* obj;
+  uint32_t i;
+  if (slab == NULL) return NULL;
+
+  slab->cache = cache;
+  slab->prev = slab->next = NULL;
+  slab->in_use = 0;
+  slab->free = NULL;
+
+  // link from the last object back so the free list runs in address order
+  obj = (uint8_t*)slab + KMEM_SLAB_HDR + cache->per_slab * cache->obj_size;
+  for (i = 0; i < cache->per_slab; i++) {
+    obj -= cache->obj_size;
+    *(void**)obj = slab->free;
+    slab->free = obj;
+  }
+
+  cache->num_slabs++;
+  return slab;
+}
+
+/* Name: kmalloc_init()
+ * Description: sets up the size class caches, call once the frame allocator
+ *              has its memory. Slabs start out empty and are taken as the
+ *              caches fill
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: every cache is forgotten, along with the frames it held
+ */
+void kmalloc_init() {
+  uint32_t i;
+  memset(kmem_caches, 0, sizeof(kmem_caches));
+  memset(&kmalloc_stats, 0, sizeof(kmalloc_stats));
+  num_caches = 0;
+
+  for (i = 0; i < KMALLOC_NUM_CLASSES; i++)
+    kmem_cache_create(class_names[i], KMALLOC_MIN_SIZE << i);
+}
+
+/* Name: kmem_cache_create()
+ * Description: creates a cache for objects of one size, for structures that
+ *              are allocated often such as file objects
+ * Inputs: name: shown in the stats, size: the size of an object
+ * Outputs: none
+ * Return Value: the cache, NULL if the size doesn't fit in a slab or there
+ *               are already KMEM_MAX_CACHES caches
+ * Side Effects: none
+ */
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size) {
+  uint32_t flags;
+  kmem_cache_t* cache = NULL;
+  if (size == 0 || size > KMEM_MAX_OBJ_SIZE) return NULL;
+
+  cli_and_save(flags);
+
+  if (num_caches < KMEM_MAX_CACHES) {
+    cache = &kmem_caches[num_caches++];
+    memset(cache, 0, sizeof(kmem_cache_t));
+    strncpy(cache->name, (int8_t*)name, KMEM_NAME_SIZE - 1);
+    cache->obj_size = (size + KMEM_ALIGN - 1) & ~(KMEM_ALIGN - 1);
+    cache->per_slab = KMEM_MAX_OBJ_SIZE / cache->obj_size;
+  }
+
+  restore_flags(flags);
+  return cache;
+}
+
+/* Name: kmem_cache_alloc()
+ * Description: allocates an object from a cache. It comes off the free list
+ *              of the first partial slab, an empty slab or a new frame is
+ *              only used once no slab has room
+ * Inputs: cache: the cache
+ * Outputs: none
+ * Return Value: the object, its contents are undefined, NULL if there is no
+ *               free frame for a new slab
+ * Side Effects: the slab is moved to the full list when it fills
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+  uint32_t flags;
+  slab_t* slab;
+  void* obj;
+
+  cli_and_save(flags);
+
+  slab = cache->partial;
+  if (slab == NULL) {
+    if ((slab = cache->empty) != NULL) {
+      slab_remove(&cache->empty, slab);
+      cache->num_empty--;
+    } else if ((slab = slab_new(cache)) == NULL) {
+      kmalloc_stats.failed++;
+      restore_flags(flags);
+      return NULL;
+    }
+    slab_push(&cache->partial, slab);
+  }
+
+  obj = slab->free;
+  slab->free = *(void**)obj;
+  slab->in_use++;
+  if (slab->free == NULL) {
+    slab_remove(&cache->partial, slab);
+    slab_push(&cache->full, slab);
+  }
+
+  cache->objs_in_use++;
+  cache->allocs++;
+  restore_flags(flags);
+  return obj;
+}
+
+/* Name: kmem_cache_free()
+ * Description: gives an object back to its slab. A slab that empties is kept
+ *              for the next allocation, up to KMEM_MAX_EMPTY per cache, and
+ *              its frame is freed after that
+ * Inputs: cache: the cache, obj: an object kmem_cache_alloc returned
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: objects from another cache are ignored
+ */
+void kmem_cache_free(kmem_cache_t* cache, void* obj) {
+  uint32_t flags;
+  slab_t* slab = (slab_t*)((uint32_t)obj & ~(KMEM_SLAB_SIZE - 1));
+  if (obj == NULL || slab->cache != cache) return;
+
+  cli_and_save(flags);
+
+  if (slab->free == NULL) {
+    slab_remove(&cache->full, slab);
+    slab_push(&cache->partial, slab);
+  }
+  *(void**)obj = slab->free;
+  slab->free = obj;
+  slab->in_use--;
+
+  if (slab->in_use == 0) {
+    slab_remove(&cache->partial, slab);
+    if (cache->num_empty < KMEM_MAX_EMPTY) {
+      slab_push(&cache->empty, slab);
+      cache->num_empty++;
+    } else {
+      cache->num_slabs--;
+      frame_free((uint32_t)slab, FRAME_ORDER_4KB);
+    }
+  }
+
+  cache->objs_in_use--;
+  cache->frees++;
+  restore_flags(flags);
+}
+
+/* Name: kmalloc()
+ * Description: allocates memory from the smallest size class that fits, or
+ *              whole frames for requests larger than KMALLOC_MAX_SIZE
+ * Inputs: size: the number of bytes
+ * Outputs: none
+ * Return Value: the memory, its contents are undefined, NULL on failure.
+ *               Large allocations are page aligned, small ones only to
+ *               KMEM_ALIGN
+ * Side Effects: none
+ */
+void* kmalloc(uint32_t size) {
+  uint32_t flags, order, k, rounded;
+  void* ptr;
+  if (size == 0) return NULL;
+
+  if (size > KMALLOC_MAX_SIZE) {
+    for (order = 0; order <= FRAME_MAX_ORDER && (FRAME_SIZE << order) < size;
+         order++)
+      ;
+    ptr = (void*)frame_alloc(order);  // fails past FRAME_MAX_ORDER too
+    rounded = FRAME_SIZE << order;
+  } else {
+    for (k = 0; (KMALLOC_MIN_SIZE << k) < size; k++)
+      ;
+    ptr = kmem_cache_alloc(&kmem_caches[k]);
+    rounded = kmem_caches[k].obj_size;
+  }
+
+  cli_and_save(flags);
+  if (ptr == NULL) {
+    if (size > KMALLOC_MAX_SIZE) kmalloc_stats.failed++;
+  } else {
+    if (size > KMALLOC_MAX_SIZE) kmalloc_stats.large_bytes += rounded;
+    kmalloc_stats.requested += size;
+    kmalloc_stats.rounded += rounded;
+    kmalloc_stats.allocs++;
+  }
+  restore_flags(flags);
+  return ptr;
+}
+
+/* Name: kfree()
+ * Description: frees memory from kmalloc, a page aligned pointer is a large
+ *              allocation since slab objects never start a frame
+ * Inputs: ptr: the pointer kmalloc returned, or NULL
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: pointers kmalloc didn't return are ignored
+ */
+void kfree(void* ptr) {
+  uint32_t flags;
+  int32_t order;
+  slab_t* slab = (slab_t*)((uint32_t)ptr & ~(KMEM_SLAB_SIZE - 1));
+  if (ptr == NULL) return;
+
+  if ((uint32_t)ptr % KMEM_SLAB_SIZE == 0) {
+    order = frame_get_order((uint32_t)ptr);
+    if (order == ERROR || frame_free((uint32_t)ptr, order) == ERROR) return;
+    cli_and_save(flags);
+    kmalloc_stats.large_bytes -= FRAME_SIZE << order;
+  } else {
+    if (slab->cache < kmem_caches || slab->cache >= kmem_caches + num_caches)
+      return;  // not a slab
+    kmem_cache_free(slab->cache, ptr);
+    cli_and_save(flags);
+  }
+  kmalloc_stats.frees++;
+  restore_flags(flags);
+}
+
+/* Name: get_kmem_cache_stats()
+ * Description: copies out the counters of a cache
+ * Inputs: cache: the cache, stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_kmem_cache_stats(kmem_cache_t* cache, kmem_cache_stats_t* stats) {
+  stats->obj_size = cache->obj_size;
+  stats->per_slab = cache->per_slab;
+  stats->num_slabs = cache->num_slabs;
+  stats->objs_in_use = cache->objs_in_use;
+  stats->allocs = cache->allocs;
+  stats->frees = cache->frees;
+}
+
+/* Name: get_kmalloc_stats()
+ * Description: copies out the heap counters, with the memory held by every
+ *              cache added up
+ * Inputs: stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_kmalloc_stats(kmalloc_stats_t* stats) {
+  uint32_t flags, i;
+  cli_and_save(flags);
+
+  memcpy(stats, &kmalloc_stats, sizeof(kmalloc_stats_t));
+  stats->slab_bytes = stats->used_bytes = 0;
+  for (i = 0; i < num_caches; i++) {
+    stats->slab_bytes += kmem_caches[i].num_slabs * KMEM_SLAB_SIZE;
+    stats->used_bytes += kmem_caches[i].objs_in_use * kmem_caches[i].obj_size;
+  }
+
+  restore_flags(flags);
+}
@@ -0,0 +1,90 @@
+#ifndef _KMALLOC_H
+#define _KMALLOC_H
+
+#include "frame.h"
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// Small objects are carved out of slabs, single frames each holding objects
+// of one size behind a slab_t header. kmalloc rounds a request up to a power
+// of two size class, anything larger than the biggest class takes whole
+// frames straight from the frame allocator and is page aligned
+#define KMALLOC_MIN_SIZE 16
+#define KMALLOC_MAX_SIZE 1024
+#define KMALLOC_NUM_CLASSES 7  // 16 bytes to 1 kB
+#define KMEM_SLAB_SIZE FRAME_SIZE
+#define KMEM_SLAB_HDR 32       // the first object starts after the header
+#define KMEM_ALIGN 8           // objects are rounded up to this
+#define KMEM_MAX_OBJ_SIZE (KMEM_SLAB_SIZE - KMEM_SLAB_HDR)
+#define KMEM_MAX_CACHES 16     // the size classes and named caches
+#define KMEM_MAX_EMPTY 1       // empty slabs a cache keeps for reuse
+#define KMEM_NAME_SIZE 16
+
+/* --- Local Types --- */
+
+struct kmem_cache;
+
+// Header at the start of every slab, the free objects are linked through
+// their first word
+typedef struct slab {
+  struct kmem_cache* cache;
+  struct slab* prev;  // on the partial, full or empty list of the cache
+  struct slab* next;
+  void* free;         // first free object, NULL if the slab is full
+  uint32_t in_use;    // objects handed out
+} slab_t;
+
+// A cache of objects of one size, the fast path takes the first free object
+// of the first partial slab
+typedef struct kmem_cache {
+  char name[KMEM_NAME_SIZE];
+  uint32_t obj_size;  // rounded up to KMEM_ALIGN
+  uint32_t per_slab;  // objects that fit in a slab
+  slab_t* partial;    // slabs with both used and free objects
+  slab_t* full;
+  slab_t* empty;
+  uint32_t num_slabs;
+  uint32_t num_empty;
+  uint32_t objs_in_use;
+  uint32_t allocs;
+  uint32_t frees;
+} kmem_cache_t;
+
+// Counters for one cache
+typedef struct kmem_cache_stats {
+  uint32_t obj_size;
+  uint32_t per_slab;
+  uint32_t num_slabs;
+  uint32_t objs_in_use;
+  uint32_t allocs;
+  uint32_t frees;
+} kmem_cache_stats_t;
+
+// Counters for the whole heap. The bytes of the slabs not used by objects are
+// its external fragmentation, and rounded - requested the internal
+// fragmentation from rounding kmalloc requests up to their size class
+typedef struct kmalloc_stats {
+  uint32_t slab_bytes;   // frames held by the caches
+  uint32_t used_bytes;   // objects handed out, at their cache's size
+  uint32_t large_bytes;  // frames handed out by kmalloc for large requests
+  uint32_t requested;    // bytes asked of kmalloc over all calls
+  uint32_t rounded;      // the same requests rounded up to what was given
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t failed;       // allocations there was no memory for
+} kmalloc_stats_t;
+
+/* --- Function Prototypes --- */
+
+void kmalloc_init();
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+void* kmalloc(uint32_t size);
+void kfree(void* ptr);
+void get_kmem_cache_stats(kmem_cache_t* cache, kmem_cache_stats_t* stats);
+void get_kmalloc_stats(kmalloc_stats_t* stats);
+
+#endif
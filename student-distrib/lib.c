@@ -26,6 +26,8 @@ static int screen_x;  // Cursor positions
 static int screen_y;
 static char* video_mem = (char*)VIDEO;
 
+static void put_char(uint8_t c);
+
 /* void clear(void);
  * Inputs: void
  * Return Value: none
@@ -173,6 +175,39 @@ void putc(uint8_t c) {
   uint32_t flags;
   cli_and_save(flags);
 
+  put_char(c);
+
+  // if (on_screen) set_cursor(); }
+  set_cursor();
+
+  restore_flags(flags);
+}
+
+/* int32_t putbuf(const int8_t* buf, int32_t n);
+ * Inputs: const int8_t* buf = characters to print
+ *                 int32_t n = number of characters in buf
+ * Return Value: Number of bytes written
+ *  Function: Output a buffer to the console with interrupts disabled once and
+ *            a single cursor update at the end. Null characters are skipped */
+int32_t putbuf(const int8_t* buf, int32_t n) {
+  uint32_t flags;
+  int32_t i;
+  cli_and_save(flags);
+
+  for (i = 0; i < n; i++)
+    if (buf[i] != '\0') put_char(buf[i]);
+  set_cursor();
+
+  restore_flags(flags);
+  return n;
+}
+
+/* static void put_char(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Writes a character to video memory and advances the position,
+ *            without touching the cursor. Caller disables interrupts */
+static void put_char(uint8_t c) {
   if (c == '\n' || c == '\r') {
     screen_y++;
     // if reached the bottom of the screen, scroll up and set x to 0
@@ -196,11 +231,6 @@ void putc(uint8_t c) {
         ATTRIB;
     screen_x++;
   }
-
-  // if (on_screen) set_cursor(); }
-  set_cursor();
-
-  restore_flags(flags);
 }
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
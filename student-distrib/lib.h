@@ -18,6 +18,7 @@
 int32_t printf(int8_t* format, ...);
 void putc(uint8_t c);
 int32_t puts(int8_t* s);
+int32_t putbuf(const int8_t* buf, int32_t n);
 int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t* strrev(int8_t* s);
 uint32_t strlen(const int8_t* s);
@@ -129,7 +130,7 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
@@ -200,6 +201,18 @@ do {                              \
     );                            \
 } while (0)
 
+// Flush the TLB entry of a single page, for a mapping of one page changing
+#define flush_TLB_page(addr)      \
+do {                              \
+    asm volatile ("             \n\
+            invlpg (%0)         \n\
+            "                     \
+            :                     \
+            : "r"(addr)           \
+            : "memory"            \
+    );                            \
+} while (0)
+
 
 
 #endif /* _LIB_H */
@@ -0,0 +1,64 @@
+#include "lz.h"
+
+/* Name: lz_read_length()
+ * Description: adds the extra length bytes that follow a 15 in a token
+ * Inputs: ip: the input position, moved past the bytes, end: end of the
+ *         input, len: the length from the token
+ * Outputs: none
+ * Return Value: the full length, -1 if the input ends in the middle
+ * Side Effects: none
+ */
+static int32_t lz_read_length(const uint8_t** ip, const uint8_t* end,
+                              uint32_t len) {
+  uint8_t b;
+  if (len != LZ_LEN_MASK) return len;
+  do {
+    if (*ip >= end) return ERROR;
+    b = *(*ip)++;
+    len += b;
+  } while (b == LZ_LEN_MORE);
+  return len;
+}
+
+/* Name: lz_decompress()
+ * Description: decompresses one block, checking every length and offset so a
+ *              corrupt block can't write outside dst
+ * Inputs: src: the compressed block, src_len: its size in bytes,
+ *         dst: where the data goes, dst_len: the size of the data
+ * Outputs: none
+ * Return Value: number of bytes written to dst, -1 if the block is corrupt
+ * Side Effects: none
+ */
+int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst,
+                      uint32_t dst_len) {
+  const uint8_t* ip = src;
+  const uint8_t* end = src + src_len;
+  uint32_t i, token, offset, op = 0;
+  int32_t len;
+
+  while (ip < end) {
+    token = *ip++;
+
+    len = lz_read_length(&ip, end, token >> LZ_LEN_BITS);
+    if (len == ERROR || len > end - ip || len > dst_len - op) return ERROR;
+    memcpy(dst + op, ip, len);
+    ip += len;
+    op += len;
+    if (ip == end) break;  // the last sequence has no match
+
+    if (end - ip < 2) return ERROR;
+    offset = ip[0] | (ip[1] << LZ_OFFSET_SHIFT);
+    ip += 2;
+    if (offset == 0 || offset > op) return ERROR;
+
+    len = lz_read_length(&ip, end, token & LZ_LEN_MASK);
+    if (len == ERROR) return ERROR;
+    len += LZ_MIN_MATCH;
+    if (len > dst_len - op) return ERROR;
+
+    // the match may overlap the bytes it produces, so copy forwards
+    for (i = 0; i < len; i++, op++) dst[op] = dst[op - offset];
+  }
+
+  return op;
+}
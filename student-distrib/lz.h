@@ -0,0 +1,30 @@
+#ifndef _LZ_H
+#define _LZ_H
+
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// A compressed block is a list of sequences, each made of
+//   a token byte: literal count in the high 4 bits, match length - 4 in the
+//                 low 4 bits, 15 in either means more length bytes follow
+//   literal length bytes (only if the count was 15), each is added to the
+//                 count and a byte below 255 ends them
+//   the literals, copied as they are
+//   a 2 byte little endian offset back into the output, 1 is the last byte
+//   match length bytes (only if the length was 15), like the literal ones
+// The last sequence has only literals and ends the input, the same block
+// format as LZ4. mkfs -z writes it
+#define LZ_MIN_MATCH 4
+#define LZ_LEN_BITS 4
+#define LZ_LEN_MASK 0x0F  // 15, more length bytes follow
+#define LZ_LEN_MORE 0xFF  // a length byte of 255 is followed by another
+#define LZ_OFFSET_SHIFT 8
+
+/* --- Function Prototypes --- */
+
+int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst,
+                      uint32_t dst_len);
+
+#endif
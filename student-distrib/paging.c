@@ -1,4 +1,5 @@
 #include "paging.h"
+#include "pcb.h"
 
 // initializing the page directory with alignment to 4 KB
 page_dir_entry_t page_directory[DIR_SIZE] __attribute__((aligned(PAGE_SIZE)));
@@ -8,6 +9,14 @@ page_table_entry_t page_table[TABLE_SIZE] __attribute__((aligned(PAGE_SIZE)));
 page_table_entry_t vidmem_page_table[TABLE_SIZE]
     __attribute__((aligned(PAGE_SIZE)));
 
+// Each process's page directory and page tables are in its PCB. The kernel
+// entries of a directory are copied from page_directory, so they point at
+// the same page tables and large pages
+static page_dir_entry_t* curr_page_dir = page_directory;  // loaded in CR3
+
+static tlb_stats_t tlb_stats;
+static uint32_t last_flushes, last_page_flushes;  // at the last second
+
 void init_paging() {
   int i;  // iterator for each entry in table and directory
 
@@ -27,37 +36,388 @@ void init_paging() {
   page_directory[0].address = (uint32_t)(page_table) >> ALIGN_SIZE;
 
   // set the second entry of PDT to point to the kernel memory at 4MB
+  // the kernel's pages are the same in every directory, so they are global
+  // and stay in the TLB when CR3 is loaded
   page_directory[1].present = 1;
   page_directory[1].page_size = 1;
+  page_directory[1].global = 1;
   page_directory[1].address = (KERNEL_MEM_START >> ALIGN_SIZE);
 
   // set video memory page in page table
   int vid_mem_offest = (VIDEO >> ALIGN_SIZE);
-  page_table[vid_mem_offest].present = 1;      // The normal vid mem
-  page_table[vid_mem_offest + 1].present = 1;  // For the 3 terminals
-  page_table[vid_mem_offest + 2].present = 1;
-  page_table[vid_mem_offest + 3].present = 1;
+  for (i = 0; i <= NUM_TERMINALS; i++) {  // The normal vid mem, 3 terminals
+    page_table[vid_mem_offest + i].present = 1;
+    page_table[vid_mem_offest + i].global = 1;
+  }
+
+  // the RAM the frame allocator hands out, so the kernel can use its frames
+  for (i = FRAME_MIN_ADDR / _4_MB; i < (frame_get_limit() + _4_MB - 1) / _4_MB;
+       i++) {
+    page_directory[i].present = 1;
+    page_directory[i].page_size = 1;
+    page_directory[i].global = 1;
+    page_directory[i].address = (i * _4_MB) >> ALIGN_SIZE;
+  }
 
+  // the kernel's directory, the template of every process's kernel half
   uint32_t pd = (uint32_t)(page_directory);
+  curr_page_dir = page_directory;
   enable_paging(pd);
 }
 
 /* Name: enable_program_page()
- * Description: Enables a page for a process
+ * Description: Switches to the page directory of a process with one CR3
+ *              load, or to the kernel's own for a process without one
  * Inputs: process_num - the process that needs the page
  * Outputs: none
  * Return Value: none
- * Side Effects: TLBs are flushed.
+ * Side Effects: TLBs are flushed if the directory changes.
  */
 void enable_program_page(int process_num) {
-  int pd_index = process_num + 2;  // +2 for 8MB offset for phys mem start
-  page_directory[USER_PROGRAM_PD_IDX].present = 1;
-  page_directory[USER_PROGRAM_PD_IDX].page_size = 1;
-  page_directory[USER_PROGRAM_PD_IDX].user_supervisor = 1;
-  page_directory[USER_PROGRAM_PD_IDX].address =
-      (pd_index * _4_MB) >> ALIGN_SIZE;
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  page_dir_entry_t* dir = page_directory;
+  if (pcb != NULL && pcb->page_dir != NULL) dir = pcb->page_dir;
 
-  flush_TLB();
+  if (dir == curr_page_dir) return;
+  curr_page_dir = dir;
+  load_page_dir((uint32_t)dir);
+  tlb_stats.flushes++;
+}
+
+/* Name: set_mmap_page()
+ * Description: maps a page of a process's mmap area to a 4kb block, read
+ *              only so writes to it fault
+ * Inputs: process_num - the process, page - index of the page in the area,
+ *         addr - physical address of the block, 0 to unmap the page
+ * Outputs: none
+ * Return Value: the address the page mapped before, 0 if it was unmapped
+ * Side Effects: the caller has to flush the TLB
+ */
+uint32_t set_mmap_page(int process_num, uint32_t page, uint32_t addr) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || page >= MMAP_PAGES) return 0;
+
+  page_table_entry_t* table = pcb->mmap_table;
+  if (table == NULL) return 0;  // see alloc_mmap_table
+
+  page_table_entry_t* entry = &table[page];
+  uint32_t old = entry->present ? entry->address << ALIGN_SIZE : 0;
+
+  entry->val = 0;
+  if (addr) {
+    entry->present = 1;
+    entry->user_supervisor = 1;
+    entry->address = addr >> ALIGN_SIZE;
+  }
+  return old;
+}
+
+/* Name: alloc_mmap_table()
+ * Description: allocates the running process's mmap page table from the
+ *              kernel heap, the first time it maps a file
+ * Inputs: process_num - the running process
+ * Outputs: none
+ * Return Value: 0 on success, -1 if there is no free frame
+ * Side Effects: adds the table to the PDT
+ */
+int32_t alloc_mmap_table(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL) return -1;
+  if (pcb->mmap_table != NULL) return 0;
+
+  // a page sized kmalloc is a whole frame, aligned as a page table must be
+  page_dir_entry_t* dir = pcb->page_dir;
+  if (dir == NULL) return -1;
+  page_table_entry_t* table = (page_table_entry_t*)kmalloc(PAGE_SIZE);
+  if (table == NULL) return -1;
+  memset(table, 0, PAGE_SIZE);
+  pcb->mmap_table = table;
+
+  dir[MMAP_PD_IDX].present = 1;
+  dir[MMAP_PD_IDX].user_supervisor = 1;
+  dir[MMAP_PD_IDX].address = (uint32_t)table >> ALIGN_SIZE;
+  return 0;
+}
+
+/* Name: free_mmap_table()
+ * Description: gives a process's mmap page table back to the kernel heap
+ *              once every page in it is unmapped
+ * Inputs: process_num - the process, it must not be running
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void free_mmap_table(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || pcb->mmap_table == NULL) return;
+
+  if (pcb->page_dir != NULL) pcb->page_dir[MMAP_PD_IDX].present = 0;
+  kfree(pcb->mmap_table);
+  pcb->mmap_table = NULL;
+}
+
+/* Name: set_shm_page()
+ * Description: maps a page of a process's shared memory area to a frame of a
+ *              segment, writable by the program
+ * Inputs: process_num - the process, page - index of the page in the area,
+ *         frame - physical address of the frame, 0 to unmap the page
+ * Outputs: none
+ * Return Value: the frame the page mapped before, 0 if it was unmapped
+ * Side Effects: the caller has to flush the TLB when it unmaps a page
+ */
+uint32_t set_shm_page(int process_num, uint32_t page, uint32_t frame) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || page >= SHM_PAGES) return 0;
+
+  page_table_entry_t* table = pcb->shm_table;
+  if (table == NULL) return 0;  // see alloc_shm_table
+
+  page_table_entry_t* entry = &table[page];
+  uint32_t old = entry->present ? entry->address << ALIGN_SIZE : 0;
+
+  entry->val = 0;
+  if (frame) {
+    entry->present = 1;
+    entry->read_write = 1;
+    entry->user_supervisor = 1;
+    entry->address = frame >> ALIGN_SIZE;
+  }
+  return old;
+}
+
+/* Name: alloc_shm_table()
+ * Description: allocates the running process's shared memory page table
+ *              from the kernel heap, the first time it attaches a segment
+ * Inputs: process_num - the running process
+ * Outputs: none
+ * Return Value: 0 on success, -1 if there is no free frame
+ * Side Effects: adds the table to the PDT
+ */
+int32_t alloc_shm_table(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL) return -1;
+  if (pcb->shm_table != NULL) return 0;
+
+  page_dir_entry_t* dir = pcb->page_dir;
+  if (dir == NULL) return -1;
+  page_table_entry_t* table = (page_table_entry_t*)kmalloc(PAGE_SIZE);
+  if (table == NULL) return -1;
+  memset(table, 0, PAGE_SIZE);
+  pcb->shm_table = table;
+
+  dir[SHM_PD_IDX].present = 1;
+  dir[SHM_PD_IDX].user_supervisor = 1;
+  dir[SHM_PD_IDX].address = (uint32_t)table >> ALIGN_SIZE;
+  return 0;
+}
+
+/* Name: free_shm_table()
+ * Description: gives a process's shared memory page table back to the
+ *              kernel heap once every segment is detached
+ * Inputs: process_num - the process, it must not be running
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void free_shm_table(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || pcb->shm_table == NULL) return;
+
+  if (pcb->page_dir != NULL) pcb->page_dir[SHM_PD_IDX].present = 0;
+  kfree(pcb->shm_table);
+  pcb->shm_table = NULL;
+}
+
+/* Name: alloc_user_table()
+ * Description: allocates the page directory of a new process, sharing the
+ *              kernel's entries, and an empty page table for its program.
+ *              enable_program_page switches to it
+ * Inputs: process_num - the new process
+ * Outputs: none
+ * Return Value: 0 on success, -1 if there is no memory
+ * Side Effects: none
+ */
+int32_t alloc_user_table(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL) return -1;
+  if (pcb->user_table != NULL) return 0;
+
+  page_dir_entry_t* dir = (page_dir_entry_t*)kmalloc(PAGE_SIZE);
+  page_table_entry_t* table = (page_table_entry_t*)kmalloc(PAGE_SIZE);
+  if (dir == NULL || table == NULL) {
+    kfree(dir);
+    kfree(table);
+    return -1;
+  }
+  memset(table, 0, PAGE_SIZE);
+  memcpy(dir, page_directory, PAGE_SIZE);  // the kernel has no user entries
+
+  dir[USER_PROGRAM_PD_IDX].present = 1;
+  dir[USER_PROGRAM_PD_IDX].user_supervisor = 1;
+  dir[USER_PROGRAM_PD_IDX].address = (uint32_t)table >> ALIGN_SIZE;
+
+  pcb->page_dir = dir;
+  pcb->user_table = table;
+  pcb->num_user_pages = 0;
+  return 0;
+}
+
+/* Name: free_user_table()
+ * Description: frees every frame of a process's program, its page table and
+ *              its page directory, call after free_mmap_table
+ * Inputs: process_num - the process
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: switches to the kernel's page directory if the process's was
+ *               loaded
+ */
+void free_user_table(int process_num) {
+  int i;
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || pcb->user_table == NULL) return;
+  page_table_entry_t* table = pcb->user_table;
+
+  for (i = 0; i < USER_PAGES; i++)  // frames shared after a fork stay
+    if (table[i].present) frame_put(table[i].address << ALIGN_SIZE);
+
+  if (curr_page_dir == pcb->page_dir) {
+    curr_page_dir = page_directory;
+    load_page_dir((uint32_t)page_directory);
+    tlb_stats.flushes++;
+  }
+
+  kfree(pcb->page_dir);
+  kfree(table);
+  pcb->page_dir = NULL;
+  pcb->user_table = NULL;
+  pcb->num_user_pages = 0;
+}
+
+/* Name: share_user_table()
+ * Description: maps every page of a process's program into a new process,
+ *              copy on write. Both get the pages read only, and the first
+ *              write to one by either process copies it, see copy_user_page
+ * Inputs: from - the process, to - the new process, with an empty table from
+ *         alloc_user_table
+ * Outputs: none
+ * Return Value: 0 on success, -1 if either has no table or a page that has
+ *               FRAME_MAX_REFS references can't be copied for lack of a frame
+ * Side Effects: the TLB is flushed if from's directory is loaded. On failure
+ *               to keeps the pages mapped so far, free_user_table drops them
+ */
+int32_t share_user_table(int from, int to) {
+  int i, ret = 0;
+  uint32_t frame;
+  pcb_t* src_pcb = get_pcb_by_pid(from);
+  pcb_t* dst_pcb = get_pcb_by_pid(to);
+  if (src_pcb == NULL || dst_pcb == NULL) return -1;
+  page_table_entry_t* src = src_pcb->user_table;
+  page_table_entry_t* dst = dst_pcb->user_table;
+  if (src == NULL || dst == NULL) return -1;
+
+  for (i = 0; i < USER_PAGES; i++) {
+    if (!src[i].present) continue;
+    if (src[i].read_write) {
+      src[i].read_write = 0;
+      src[i].available |= PTE_COW;
+    }
+    dst[i].val = src[i].val;
+    if (frame_get(src[i].address << ALIGN_SIZE) == 0) continue;
+
+    // shared by as many processes as a frame counts, this one gets a copy
+    if ((frame = frame_alloc(FRAME_ORDER_4KB)) == 0) {
+      dst[i].val = 0;
+      ret = -1;
+      break;
+    }
+    memcpy((void*)frame, (void*)(src[i].address << ALIGN_SIZE), PAGE_SIZE);
+    dst[i].address = frame >> ALIGN_SIZE;
+    dst[i].read_write = 1;
+    dst[i].available &= ~PTE_COW;
+  }
+  if (ret == 0) {
+    dst_pcb->num_user_pages = src_pcb->num_user_pages;
+    // the video memory page too if the process has it
+    dst_pcb->page_dir[USER_PROGRAM_PD_IDX + 1] =
+        src_pcb->page_dir[USER_PROGRAM_PD_IDX + 1];
+  }
+
+  if (curr_page_dir == src_pcb->page_dir) tlb_flush();
+  return ret;
+}
+
+/* Name: copy_user_page()
+ * Description: gives a process a page of its own in place of one it shares
+ *              copy on write, or makes it writable again if the others have
+ *              copied it already
+ * Inputs: process_num - the process, page - index of the page in the 4MB
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the page isn't copy on write or there is
+ *               no free frame
+ * Side Effects: the TLB entry of the page is flushed
+ */
+int32_t copy_user_page(int process_num, uint32_t page) {
+  uint32_t old, frame;
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || page >= USER_PAGES) return -1;
+
+  page_table_entry_t* table = pcb->user_table;
+  if (table == NULL || !table[page].present ||
+      !(table[page].available & PTE_COW))
+    return -1;
+
+  old = table[page].address << ALIGN_SIZE;
+  if (frame_get_refs(old) > 1) {
+    if ((frame = frame_alloc(FRAME_ORDER_4KB)) == 0) return -1;
+    memcpy((void*)frame, (void*)old, PAGE_SIZE);
+    table[page].address = frame >> ALIGN_SIZE;
+    frame_put(old);
+  }
+  table[page].read_write = 1;
+  table[page].available &= ~PTE_COW;
+
+  tlb_flush_page(USER_START + page * PAGE_SIZE);
+  return 0;
+}
+
+/* Name: set_user_page()
+ * Description: maps a page of a process's program to a frame, writable by
+ *              the program
+ * Inputs: process_num - the process, page - index of the page in the 4MB,
+ *         frame - physical address of the frame, the table owns it after
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the page is already mapped
+ * Side Effects: the TLB entry of the page is flushed
+ */
+int32_t set_user_page(int process_num, uint32_t page, uint32_t frame) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || page >= USER_PAGES) return -1;
+
+  page_table_entry_t* table = pcb->user_table;
+  if (table == NULL || table[page].present) return -1;
+
+  table[page].val = 0;
+  table[page].present = 1;
+  table[page].read_write = 1;
+  table[page].user_supervisor = 1;
+  table[page].address = frame >> ALIGN_SIZE;
+  pcb->num_user_pages++;
+
+  tlb_flush_page(USER_START + page * PAGE_SIZE);
+  return 0;
+}
+
+/* Name: get_num_user_pages()
+ * Description: gets the number of pages of a process's program that have a
+ *              frame, its physical footprint
+ * Inputs: process_num - the process
+ * Outputs: none
+ * Return Value: the number of pages
+ * Side Effects: none
+ */
+uint32_t get_num_user_pages(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  return pcb ? pcb->num_user_pages : 0;
 }
 
 /* Name: change_vidmem()
@@ -65,7 +425,7 @@ void enable_program_page(int process_num) {
  * Inputs: process_num - the process that needs the page change
  * Outputs: none
  * Return Value: none
- * Side Effects: TLBs are flushed.
+ * Side Effects: The TLB entries of the two pages are flushed.
  */
 void change_vidmem(int process_num) {
   int vid_mem_offset = (VIDEO >> ALIGN_SIZE);
@@ -74,29 +434,85 @@ void change_vidmem(int process_num) {
   page_table[vid_mem_offset].address = vid_buffer;
   vidmem_page_table[0].address = vid_buffer;
 
-  flush_TLB();
+  tlb_flush_page(VIDEO);
+  tlb_flush_page(_132_MB);
 }
 
 /* Name: get_vidmem()
  * Description: adds 4kb page for video memory for user program
- * Inputs: none
+ * Inputs: process_num - the process, its directory gets the page table
  * Outputs: none
- * Return Value: pointer to the 4kb page that points to the video memory
- * Side Effects: TLBs are flushed, page added.
+ * Return Value: pointer to the 4kb page that points to the video memory, NULL
+ *               if the process has no page directory
+ * Side Effects: TLBs are flushed if the directory is loaded, page added.
  */
-uint8_t* get_vidmem() {
+uint8_t* get_vidmem(int process_num) {
+  pcb_t* pcb = get_pcb_by_pid(process_num);
+  if (pcb == NULL || pcb->page_dir == NULL) return NULL;
+  page_dir_entry_t* dir = pcb->page_dir;
+
   vidmem_page_table[0].val = 0;
   vidmem_page_table[0].read_write = 1;
   vidmem_page_table[0].present = 1;
   vidmem_page_table[0].user_supervisor = 1;
   vidmem_page_table[0].address = VIDEO >> ALIGN_SIZE;
 
-  page_directory[USER_PROGRAM_PD_IDX + 1].present = 1;
-  page_directory[USER_PROGRAM_PD_IDX + 1].user_supervisor = 1;
-  page_directory[USER_PROGRAM_PD_IDX + 1].address =
+  dir[USER_PROGRAM_PD_IDX + 1].present = 1;
+  dir[USER_PROGRAM_PD_IDX + 1].user_supervisor = 1;
+  dir[USER_PROGRAM_PD_IDX + 1].address =
       (uint32_t)(vidmem_page_table) >> ALIGN_SIZE;
 
-  flush_TLB();
+  if (dir == curr_page_dir) tlb_flush_page(_132_MB);
 
   return (uint8_t*)(_132_MB);  // Page is located at 8MB virtual mem
 }
+
+/* Name: tlb_flush()
+ * Description: flushes the whole TLB, for changes to more than a few pages.
+ *              Global pages are kept
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: counted in the TLB stats
+ */
+void tlb_flush() {
+  flush_TLB();
+  tlb_stats.flushes++;
+}
+
+/* Name: tlb_flush_page()
+ * Description: flushes the TLB entry of one page, global or not
+ * Inputs: addr - virtual address in the page
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: counted in the TLB stats
+ */
+void tlb_flush_page(uint32_t addr) {
+  flush_TLB_page(addr);
+  tlb_stats.page_flushes++;
+}
+
+/* Name: tlb_stats_second()
+ * Description: ends a second of the TLB stats, the PIT calls it once a second
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: the flushes of the second become the rates
+ */
+void tlb_stats_second() {
+  tlb_stats.flushes_per_sec = tlb_stats.flushes - last_flushes;
+  tlb_stats.page_flushes_per_sec = tlb_stats.page_flushes - last_page_flushes;
+  last_flushes = tlb_stats.flushes;
+  last_page_flushes = tlb_stats.page_flushes;
+}
+
+/* Name: get_tlb_stats()
+ * Description: copies out the TLB flush counters
+ * Inputs: stats - where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_tlb_stats(tlb_stats_t* stats) {
+  memcpy(stats, &tlb_stats, sizeof(tlb_stats_t));
+}
@@ -2,6 +2,8 @@
 #define _PAGING_H
 
 #include "en_paging.h"
+#include "frame.h"
+#include "kmalloc.h"
 #include "lib.h"
 
 /* --- Constant / Literal Definitions --- */
@@ -26,6 +28,33 @@
 //  PDT) = 32
 #define USER_PROGRAM_PD_IDX 32
 
+// The program's 4MB is mapped 4kB at a time by a page table per process from
+// the kernel heap. A page only gets a frame when the program first touches
+// it, see handle_user_fault
+#define USER_PAGES TABLE_SIZE
+#define USER_START 0x8000000  // 128 MB
+
+// After a fork the parent's and the child's pages share frames read only,
+// with this in the available bits, until a write fault copies the page
+#define PTE_COW 0x1
+
+// Bits of the error code of a page fault
+#define PF_ERR_PRESENT 0x1  // the page was present, a protection fault
+#define PF_ERR_WRITE 0x2
+#define PF_ERR_USER 0x4
+
+// Files mapped with sys_mmap go in the 4MB after the video memory page, one
+// page table per process from the kernel heap, taken on the first mmap
+#define MMAP_PD_IDX (USER_PROGRAM_PD_IDX + 2)
+#define MMAP_START 0x8800000  // 136 MB
+#define MMAP_PAGES TABLE_SIZE
+
+// Shared memory segments are attached in the 4MB after the mmap area, in a
+// page table per process taken on the first attach like the mmap one
+#define SHM_PD_IDX (USER_PROGRAM_PD_IDX + 3)
+#define SHM_START 0x8C00000  // 140 MB
+#define SHM_PAGES TABLE_SIZE
+
 /* --- Struct Definitions --- */
 
 // A page directory entry (goes into PDT)
@@ -41,7 +70,7 @@ typedef struct page_dir_entry {
       uint8_t accessed : 1;
       uint8_t zero : 1;
       uint8_t page_size : 1;
-      uint8_t ignored : 1;
+      uint8_t global : 1;  // only for a 4 MB page, ignored for a table
       uint8_t available : 3;
       uint32_t address : 20;
     } __attribute__((packed));
@@ -68,12 +97,38 @@ typedef struct page_table_entry {
   };
 } page_table_entry_t;
 
+// Counters for TLB flushes, a whole flush is a CR3 load and drops every
+// entry that isn't global, a page flush is one invlpg
+typedef struct tlb_stats {
+  uint32_t flushes;
+  uint32_t page_flushes;
+  uint32_t flushes_per_sec;  // over the last whole second
+  uint32_t page_flushes_per_sec;
+} tlb_stats_t;
+
 /* --- Function and Global Prototypes --- */
 
 extern void init_paging();
+extern page_dir_entry_t page_directory[DIR_SIZE];  // the kernel's own
 
 void enable_program_page(int process_num);
-uint8_t* get_vidmem();
+uint8_t* get_vidmem(int process_num);
 void change_vidmem(int process_num);
+uint32_t set_mmap_page(int process_num, uint32_t page, uint32_t addr);
+int32_t alloc_mmap_table(int process_num);
+void free_mmap_table(int process_num);
+uint32_t set_shm_page(int process_num, uint32_t page, uint32_t frame);
+int32_t alloc_shm_table(int process_num);
+void free_shm_table(int process_num);
+int32_t alloc_user_table(int process_num);
+void free_user_table(int process_num);
+int32_t share_user_table(int from, int to);
+int32_t copy_user_page(int process_num, uint32_t page);
+int32_t set_user_page(int process_num, uint32_t page, uint32_t frame);
+uint32_t get_num_user_pages(int process_num);
+void tlb_flush();
+void tlb_flush_page(uint32_t addr);
+void tlb_stats_second();
+void get_tlb_stats(tlb_stats_t* stats);
 
 #endif
@@ -1,11 +1,35 @@
 #include "pcb.h"
+#include "kmalloc.h"
+#include "tmpfs.h"
+
+// Global Variables
+static pcb_t* pid_hash[PID_HASH_SIZE];  // live processes by pid
+static int32_t* free_pids;  // stack of free pids, from kmalloc
+static int32_t free_pids_size;  // room in free_pids
+static int32_t num_free_pids;
+static int32_t next_pid;  // lowest pid never handed out
+static pcb_t* live_pcbs;
+static pcb_t* dead_pcbs;  // halted, their stacks not freed yet
+static uint32_t num_procs;
+static kmem_cache_t* pcb_cache;
+static pcb_t boot_pcb;
 
 // set up the different function operation tables
-fot_t rtc_fot = {rtc_read, rtc_write, rtc_open, rtc_close};
-fot_t file_fot = {file_read, file_write, file_open, file_close};
-fot_t dir_fot = {dir_read, dir_write, dir_open, dir_close};
-fot_t stdin_fot = {terminal_read, not_allowed, terminal_open, terminal_close};
-fot_t stdout_fot = {not_allowed, terminal_write, terminal_open, terminal_close};
+fot_t rtc_fot = {rtc_read,    rtc_write,   rtc_open,    rtc_close,
+                 not_allowed, not_allowed, not_allowed, not_allowed};
+fot_t file_fot = {file_read, file_write, file_open,  file_close,
+                  file_seek, file_pread, file_readv, file_writev};
+fot_t dir_fot = {dir_read, dir_write,   dir_open,    dir_close,
+                 dir_seek, not_allowed, not_allowed, not_allowed};
+fot_t tmpfs_fot = {tmpfs_read, tmpfs_write, tmpfs_open,  tmpfs_close,
+                   tmpfs_seek, tmpfs_pread, tmpfs_readv, tmpfs_writev};
+fot_t tmpfs_dir_fot = {tmpfs_dir_read, not_allowed, dir_open,    dir_close,
+                       tmpfs_dir_seek, not_allowed, not_allowed, not_allowed};
+fot_t stdin_fot = {terminal_read, not_allowed, terminal_open, terminal_close,
+                   not_allowed,   not_allowed, terminal_readv, not_allowed};
+fot_t stdout_fot = {not_allowed, terminal_write, terminal_open,
+                    terminal_close, not_allowed, not_allowed,
+                    not_allowed, terminal_writev};
 
 /* Name: not_allowed()
  * Description: A file operation that isnt allowed
@@ -16,6 +40,165 @@ fot_t stdout_fot = {not_allowed, terminal_write, terminal_open, terminal_close};
  */
 int32_t not_allowed() { return ERROR; }
 
+/* Name: init_pid()
+ * Description: empties the PID free list and sets up the PCB of the boot
+ *              stack, call after kmalloc_init
+ * Inputs: None
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: there are no processes
+ */
+void init_pid() {
+  pcb_cache = kmem_cache_create("pcb", sizeof(pcb_t));
+  memset(pid_hash, 0, sizeof(pid_hash));
+  live_pcbs = dead_pcbs = NULL;
+  num_procs = 0;
+
+  // pids are made from 0 up, so the base shells are 0 to 2 as before
+  free_pids = NULL;
+  free_pids_size = num_free_pids = next_pid = 0;
+
+  // the kernel runs on the boot stack before the first shell
+  memset(&boot_pcb, 0, sizeof(pcb_t));
+  boot_pcb.pid = boot_pcb.par_pid = -1;
+  boot_pcb.kstack = BOOT_KSTACK;
+  *(pcb_t**)BOOT_KSTACK = &boot_pcb;
+}
+
+/* Name: reap_dead_pcbs()
+ * Description: frees the PCBs and kernel stacks of halted processes, except
+ *              the stack the caller is running on. A halting process is still
+ *              on its stack when it frees its PCB, so the stack is only given
+ *              back on a later call
+ * Inputs: None
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: must be called with interrupts disabled
+ */
+static void reap_dead_pcbs() {
+  uint32_t curr_stack = (uint32_t)&curr_stack & KSTACK_MASK;
+  pcb_t* pcb = dead_pcbs;
+  pcb_t* next;
+
+  for (; pcb != NULL; pcb = next) {
+    next = pcb->next;
+    if (pcb->kstack == curr_stack) continue;
+    if (pcb->prev != NULL)
+      pcb->prev->next = pcb->next;
+    else
+      dead_pcbs = pcb->next;
+    if (pcb->next != NULL) pcb->next->prev = pcb->prev;
+
+    frame_free(pcb->kstack, KSTACK_ORDER);
+    kmem_cache_free(pcb_cache, pcb);
+  }
+}
+
+/* Name: alloc_pid()
+ * Description: takes the last freed pid, or makes a new one. The free list
+ *              is grown first so it has room for every pid made
+ * Inputs: None
+ * Outputs: None
+ * Return Value: the pid, -1 if there is no memory to grow the free list
+ * Side Effects: must be called with interrupts disabled
+ */
+static int32_t alloc_pid() {
+  int32_t size, *pids;
+  if (num_free_pids) return free_pids[--num_free_pids];
+
+  if (next_pid == free_pids_size) {
+    size = free_pids_size ? 2 * free_pids_size : PID_FREE_LIST_MIN;
+    if ((pids = kmalloc(size * sizeof(int32_t))) == NULL) return ERROR;
+    if (free_pids != NULL) kfree(free_pids);  // it is empty
+    free_pids = pids;
+    free_pids_size = size;
+  }
+  return next_pid++;
+}
+
+/* Name: pcb_alloc()
+ * Description: allocates a PID, a PCB and a kernel stack for a new process
+ *              and adds it to the live list. Each comes off a free list, so
+ *              this doesn't scan for a free slot
+ * Inputs: None
+ * Outputs: None
+ * Return Value: the zeroed PCB with its pid and stack set, NULL if there is no
+ *               memory
+ * Side Effects: frees the PCBs of processes that halted before
+ */
+pcb_t* pcb_alloc() {
+  uint32_t flags, kstack;
+  pcb_t* pcb = NULL;
+
+  cli_and_save(flags);
+  reap_dead_pcbs();
+
+  if ((pcb = kmem_cache_alloc(pcb_cache)) == NULL) {
+    restore_flags(flags);
+    return NULL;
+  }
+  if ((kstack = frame_alloc(KSTACK_ORDER)) == 0) {
+    kmem_cache_free(pcb_cache, pcb);
+    restore_flags(flags);
+    return NULL;
+  }
+
+  memset(pcb, 0, sizeof(pcb_t));
+  if ((pcb->pid = alloc_pid()) == ERROR) {
+    frame_free(kstack, KSTACK_ORDER);
+    kmem_cache_free(pcb_cache, pcb);
+    restore_flags(flags);
+    return NULL;
+  }
+  pcb->kstack = kstack;
+  pcb->exe_mount = ERROR;  // no program loaded yet
+  *(pcb_t**)kstack = pcb;
+  pcb->pid_next = pid_hash[pcb->pid & PID_HASH_MASK];
+  pid_hash[pcb->pid & PID_HASH_MASK] = pcb;
+
+  pcb->next = live_pcbs;
+  if (live_pcbs != NULL) live_pcbs->prev = pcb;
+  live_pcbs = pcb;
+  num_procs++;
+
+  restore_flags(flags);
+  return pcb;
+}
+
+/* Name: pcb_free()
+ * Description: takes a halting process off the live list and frees its PID.
+ *              The PCB and stack are freed by a later pcb_alloc, once the
+ *              process is off its stack
+ * Inputs: pcb: the process's PCB
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: get_pcb_by_pid no longer finds the process
+ */
+void pcb_free(pcb_t* pcb) {
+  uint32_t flags;
+  pcb_t** link;
+  cli_and_save(flags);
+
+  if (pcb->prev != NULL)
+    pcb->prev->next = pcb->next;
+  else
+    live_pcbs = pcb->next;
+  if (pcb->next != NULL) pcb->next->prev = pcb->prev;
+
+  link = &pid_hash[pcb->pid & PID_HASH_MASK];
+  while (*link != pcb) link = &(*link)->pid_next;
+  *link = pcb->pid_next;
+  free_pids[num_free_pids++] = pcb->pid;  // alloc_pid made room for it
+  num_procs--;
+
+  pcb->prev = NULL;
+  pcb->next = dead_pcbs;
+  if (dead_pcbs != NULL) dead_pcbs->prev = pcb;
+  dead_pcbs = pcb;
+
+  restore_flags(flags);
+}
+
 /* Name: get_curr_pcb()
  * Description: Gets the current processes pcb
  * Inputs: None
@@ -24,30 +207,61 @@ int32_t not_allowed() { return ERROR; }
  * Side Effects: None
  */
 pcb_t* get_curr_pcb() {
-  pcb_t* pcb;
-  // use bit mask to get the current pcb pointer
+  uint32_t stack;
+  // the bottom of the kernel stack points at the pcb
   // clang-format off
   asm volatile("          \n\
         movl %%esp, %%eax \n\
         andl %1, %%eax    \n\
         movl %%eax, %0    \n\
         "
-      : "=r"(pcb)
-      : "r"(PCB_8KB_MASK)
+      : "=r"(stack)
+      : "r"(KSTACK_MASK)
       : "cc", "eax"
   );
   // clang-format on
-  return pcb;
+  return *(pcb_t**)stack;
 }
 
 /* Name: get_pcb_by_pid()
  * Description: returns a pointer to the pcb of the process with id pid
- * Inputs: int8_t pid : the pid to use for PCB index
+ * Inputs: int32_t pid : the pid to look up
  * Outputs: None
- * Return Value: Pointer to PCB struct requested
+ * Return Value: Pointer to PCB struct requested, NULL if no live process has
+ *               that pid
  * Side Effects: None
  */
-pcb_t* get_pcb_by_pid(int8_t pid) {
-  if (pid == -1) return NULL;
-  return (pcb_t*)(_8MB - ((pid + 1) * _8KB));
+pcb_t* get_pcb_by_pid(int32_t pid) {
+  pcb_t* pcb;
+  if (pid < 0) return NULL;
+  for (pcb = pid_hash[pid & PID_HASH_MASK]; pcb != NULL; pcb = pcb->pid_next)
+    if (pcb->pid == pid) return pcb;
+  return NULL;
 }
+
+/* Name: get_live_pcbs()
+ * Description: gets the first live process, the rest follow through next
+ * Inputs: None
+ * Outputs: None
+ * Return Value: the first PCB, NULL if no process is running
+ * Side Effects: None
+ */
+pcb_t* get_live_pcbs() { return live_pcbs; }
+
+/* Name: get_boot_pcb()
+ * Description: gets the PCB of the boot stack, which isn't on the live list
+ * Inputs: None
+ * Outputs: None
+ * Return Value: the boot PCB
+ * Side Effects: None
+ */
+pcb_t* get_boot_pcb() { return &boot_pcb; }
+
+/* Name: get_num_procs()
+ * Description: gets the number of live processes
+ * Inputs: None
+ * Outputs: None
+ * Return Value: the number of processes
+ * Side Effects: None
+ */
+uint32_t get_num_procs() { return num_procs; }
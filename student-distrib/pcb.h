@@ -6,21 +6,50 @@
 #include "terminal.h"
 #include "types.h"
 
-#define FDT_ENTRY_SIZE_BYTES 16
+#define FDT_ENTRY_SIZE_BYTES 28
 #define FDT_MAX_ENTRIES 8
 #define BUF_LEN 128
 #define _8MB 0x800000
 #define _8KB 0x2000
 #define _4KB 0x1000
 
-// This mask ignores anything 128MiB or over, leaving a 10-bit count for number
-// of 8KiB blocks to offset.
-#define PCB_8KB_MASK 0x007FE000
+// PIDs come off a free list, the last one freed first, and a new one is
+// only made when the list is empty. A process's PCB, kernel stack and page
+// tables all come from the frame allocator and its program only holds the
+// frames it touches, so the number of processes is bounded by RAM alone
+#define PID_FREE_LIST_MIN 16  // pids the free list first has room for
+
+// Live processes are found by pid in a hash table, chained through pid_next
+#define PID_HASH_SIZE 64
+#define PID_HASH_MASK (PID_HASH_SIZE - 1)
+
+// Each process has an 8KB kernel stack from the frame allocator, aligned to
+// its size. Its lowest word points at the process's PCB, so the PCB is found
+// by masking esp. The boot stack below 8MB is set up the same way
+#define KSTACK_SIZE _8KB
+#define KSTACK_ORDER 1  // 2^1 frames
+#define KSTACK_MASK (~(KSTACK_SIZE - 1))
+#define BOOT_KSTACK (_8MB - KSTACK_SIZE)
+#define PCB_KSTACK_TOP(pcb) ((pcb)->kstack + KSTACK_SIZE - 4)  // esp offset
+
+// Most segments a single readv or writev may pass
+#define IOV_MAX 16
+
+// Most files a process may have mapped with mmap at once
+#define MMAP_MAX_REGIONS 4
+
+// Most shared memory segments a process may have attached at once
+#define SHM_MAX_ATTACH 4
 
 typedef int32_t (*ReadFn)(int32_t fd, void* buf, int32_t nbytes);
 typedef int32_t (*WriteFn)(int32_t fd, const void* buf, int32_t nbytes);
 typedef int32_t (*OpenFn)(const uint8_t* filename);
 typedef int32_t (*CloseFn)(int32_t fd);
+typedef int32_t (*SeekFn)(int32_t fd, int32_t offset, int32_t whence);
+typedef int32_t (*PreadFn)(int32_t fd, void* buf, int32_t nbytes,
+                           uint32_t offset);
+typedef int32_t (*ReadvFn)(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+typedef int32_t (*WritevFn)(int32_t fd, const iovec_t* iov, int32_t iovcnt);
 
 // File Operations Table
 typedef struct fot {
@@ -28,6 +57,10 @@ typedef struct fot {
   WriteFn write;
   OpenFn open;
   CloseFn close;
+  SeekFn seek;
+  PreadFn pread;
+  ReadvFn readv;
+  WritevFn writev;
 } fot_t;
 
 // Flags for a file descriptor table entry
@@ -38,7 +71,8 @@ typedef struct fdt_entry_flags {
       // Flags are active high
       uint8_t enabled : 1;
       uint8_t is_data_file : 1;
-      uint32_t available : 30;
+      uint32_t mount : 3;  // index of the mount the file is in
+      uint32_t available : 27;
     } __attribute__((packed));
   };
 } fdt_entry_flags_t;
@@ -52,15 +86,30 @@ typedef struct fdt_entry {
       uint32_t inode_idx;
       uint32_t file_position;
       fdt_entry_flags_t flags;
+      ind_cache_t ind_cache;  // for files of images with indirect blocks
     } __attribute__((packed));
   };
 } fdt_entry_t;
 
-// Process control block
+// Pages of a process's mmap area that map a file
+typedef struct mmap_region {
+  uint16_t page;       // first page in the area
+  uint16_t num_pages;  // 0 if the region isn't used
+  uint8_t mount;       // the mount of the file's image
+} mmap_region_t;
+
+// Pages of a process's shared memory area a segment is attached at
+typedef struct shm_attach {
+  uint16_t page;       // first page in the area
+  uint16_t num_pages;  // 0 if the attachment isn't used
+  uint8_t id;          // the segment
+} shm_attach_t;
+
+// Process control block, from a slab cache
 typedef struct pcb {
-  int8_t pid;
-  int8_t par_pid;
-  struct pcb* par_pcb_ptr;
+  int32_t pid;
+  int32_t par_pid;          // its own pid for the base shells
+  struct pcb* par_pcb_ptr;  // NULL for the base shells
   fdt_entry_t fdt[FDT_MAX_ENTRIES];
   int8_t args[BUF_LEN];
   int8_t arg_len;
@@ -77,18 +126,60 @@ typedef struct pcb {
   uint32_t prog_freq;  // Rtc frequency requested by this program
   uint32_t count;
   uint32_t divisor;  // Higher freq (curr rtc freq) / prog freq
+
+  // The program's file, its pages are read in as the program touches them
+  int32_t exe_mount;
+  uint32_t exe_inode;
+  uint32_t exe_size;
+
+  // Files mapped with mmap, a forked process doesn't inherit them
+  mmap_region_t mmaps[MMAP_MAX_REGIONS];
+
+  // Shared memory segments attached with shmat, also not inherited
+  shm_attach_t shms[SHM_MAX_ATTACH];
+
+  // Started by sys_fork, its parent waits there for it to halt rather than
+  // in sys_execute
+  uint8_t forked;
+
+  // Bottom of the kernel stack
+  uint32_t kstack;
+
+  // Paging, each a page from kmalloc. The directory and the program's table
+  // come with alloc_user_table, the mmap and shm tables with the first use.
+  // Struct tags, as paging.h includes this header through lib.h
+  struct page_dir_entry* page_dir;
+  struct page_table_entry* user_table;
+  struct page_table_entry* mmap_table;
+  struct page_table_entry* shm_table;
+  uint32_t num_user_pages;  // pages of the program with a frame
+
+  // Next process in the same pid hash chain
+  struct pcb* pid_next;
+
+  // List of live processes, or of halted ones waiting to be freed
+  struct pcb* prev;
+  struct pcb* next;
 } pcb_t;
 
 /* --- Function Prototypes --- */
 
+void init_pid();
+pcb_t* pcb_alloc();
+void pcb_free(pcb_t* pcb);
 pcb_t* get_curr_pcb();
-pcb_t* get_pcb_by_pid(int8_t pid);
+pcb_t* get_pcb_by_pid(int32_t pid);
+pcb_t* get_live_pcbs();
+pcb_t* get_boot_pcb();
+uint32_t get_num_procs();
 int32_t not_allowed();
 
 // Global vars for file operation tables
 extern fot_t rtc_fot;
 extern fot_t file_fot;
 extern fot_t dir_fot;
+extern fot_t tmpfs_fot;
+extern fot_t tmpfs_dir_fot;
 extern fot_t stdin_fot;
 extern fot_t stdout_fot;
 
@@ -0,0 +1,88 @@
+#include "pci.h"
+
+/* Name: pci_config_addr()
+ * Description: builds the configuration address of a register
+ * Inputs: dev: the device function, reg: offset of the register
+ * Outputs: none
+ * Return Value: the value to write to PCI_CONFIG_ADDR
+ * Side Effects: none
+ */
+static uint32_t pci_config_addr(const pci_dev_t* dev, uint32_t reg) {
+  return PCI_CONFIG_ENABLE | (dev->bus << PCI_BUS_SHIFT) |
+         (dev->device << PCI_DEVICE_SHIFT) |
+         (dev->function << PCI_FUNCTION_SHIFT) | (reg & PCI_REG_MASK);
+}
+
+/* Name: pci_read()
+ * Description: reads a 32 bit configuration register of a device
+ * Inputs: dev: the device function, reg: offset of the register
+ * Outputs: none
+ * Return Value: the value of the register, all ones if nothing is there
+ * Side Effects: none
+ */
+uint32_t pci_read(const pci_dev_t* dev, uint32_t reg) {
+  outl(pci_config_addr(dev, reg), PCI_CONFIG_ADDR);
+  return inl(PCI_CONFIG_DATA);
+}
+
+/* Name: pci_write()
+ * Description: writes a 32 bit configuration register of a device
+ * Inputs: dev: the device function, reg: offset of the register,
+ *         val: the value to write
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: changes the device's configuration
+ */
+void pci_write(const pci_dev_t* dev, uint32_t reg, uint32_t val) {
+  outl(pci_config_addr(dev, reg), PCI_CONFIG_ADDR);
+  outl(val, PCI_CONFIG_DATA);
+}
+
+/* Name: pci_find_class()
+ * Description: scans every bus for the first device function of a class
+ * Inputs: class, subclass: the class code to look for,
+ *         dev: set to the address of the function that was found
+ * Outputs: none
+ * Return Value: 0 on success, -1 if there is no such device
+ * Side Effects: none
+ */
+int32_t pci_find_class(uint32_t class, uint32_t subclass, pci_dev_t* dev) {
+  uint32_t class_reg, num_functions;
+
+  for (dev->bus = 0; dev->bus < PCI_NUM_BUSES; dev->bus++) {
+    for (dev->device = 0; dev->device < PCI_NUM_DEVICES; dev->device++) {
+      dev->function = 0;
+      if ((pci_read(dev, PCI_REG_ID) & PCI_VENDOR_MASK) == PCI_NO_VENDOR)
+        continue;
+
+      // only multi function devices answer past function 0
+      num_functions = ((pci_read(dev, PCI_REG_HEADER) >> PCI_HEADER_SHIFT) &
+                       PCI_HEADER_MULTI_FUNCTION)
+                          ? PCI_NUM_FUNCTIONS
+                          : 1;
+
+      for (; dev->function < num_functions; dev->function++) {
+        if ((pci_read(dev, PCI_REG_ID) & PCI_VENDOR_MASK) == PCI_NO_VENDOR)
+          continue;
+        class_reg = pci_read(dev, PCI_REG_CLASS);
+        if (((class_reg >> PCI_CLASS_SHIFT) & PCI_BYTE_MASK) == class &&
+            ((class_reg >> PCI_SUBCLASS_SHIFT) & PCI_BYTE_MASK) == subclass)
+          return 0;
+      }
+    }
+  }
+  return ERROR;
+}
+
+/* Name: pci_enable_bus_master()
+ * Description: lets a device decode its I/O ports and start DMA transfers
+ * Inputs: dev: the device function
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: sets the I/O and bus master bits of the command register
+ */
+void pci_enable_bus_master(const pci_dev_t* dev) {
+  uint32_t command = pci_read(dev, PCI_REG_COMMAND) & PCI_COMMAND_MASK;
+  pci_write(dev, PCI_REG_COMMAND,
+            command | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+}
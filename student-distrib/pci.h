@@ -0,0 +1,64 @@
+#ifndef _PCI_H
+#define _PCI_H
+
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// Configuration mechanism #1, an address is written to PCI_CONFIG_ADDR and
+// the register is then read or written through PCI_CONFIG_DATA
+#define PCI_CONFIG_ADDR 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define PCI_CONFIG_ENABLE 0x80000000
+#define PCI_BUS_SHIFT 16
+#define PCI_DEVICE_SHIFT 11
+#define PCI_FUNCTION_SHIFT 8
+#define PCI_REG_MASK 0xFC  // registers are read 32 bits at a time
+
+#define PCI_NUM_BUSES 256
+#define PCI_NUM_DEVICES 32
+#define PCI_NUM_FUNCTIONS 8
+
+// Configuration space registers
+#define PCI_REG_ID 0x00       // device id << 16 | vendor id
+#define PCI_REG_COMMAND 0x04  // status << 16 | command
+#define PCI_REG_CLASS 0x08    // class, subclass, prog if, revision
+#define PCI_REG_HEADER 0x0C   // bist, header type, latency, cache line
+#define PCI_REG_BAR0 0x10
+#define PCI_REG_BAR4 0x20
+
+#define PCI_VENDOR_MASK 0xFFFF
+#define PCI_NO_VENDOR 0xFFFF  // nothing at this address
+#define PCI_CLASS_SHIFT 24
+#define PCI_SUBCLASS_SHIFT 16
+#define PCI_PROG_IF_SHIFT 8
+#define PCI_BYTE_MASK 0xFF
+#define PCI_HEADER_SHIFT 16
+#define PCI_HEADER_MULTI_FUNCTION 0x80
+
+#define PCI_COMMAND_MASK 0xFFFF  // the status half is write one to clear
+#define PCI_COMMAND_IO 0x01
+#define PCI_COMMAND_BUS_MASTER 0x04
+#define PCI_BAR_IO_MASK 0xFFFFFFFC
+
+#define PCI_CLASS_STORAGE 0x01
+#define PCI_SUBCLASS_IDE 0x01
+
+/* --- Local Types --- */
+
+// Address of one function of a device on the bus
+typedef struct pci_dev {
+  uint32_t bus;
+  uint32_t device;
+  uint32_t function;
+} pci_dev_t;
+
+/* --- Function Prototypes --- */
+
+uint32_t pci_read(const pci_dev_t* dev, uint32_t reg);
+void pci_write(const pci_dev_t* dev, uint32_t reg, uint32_t val);
+int32_t pci_find_class(uint32_t class, uint32_t subclass, pci_dev_t* dev);
+void pci_enable_bus_master(const pci_dev_t* dev);
+
+#endif
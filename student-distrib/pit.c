@@ -1,6 +1,7 @@
 #include "pit.h"
 
 /*** Global Variables ***/
+static uint32_t ticks;  // PIT interrupts since the last whole second
 
 /* Name: init_pit()
  * Description: Initializes the PIT, setting it to send interrupts. Output
@@ -30,6 +31,10 @@ void init_pit() {
  * Side Effects: Schedules next process
  */
 void PT_handler() {
+  if (++ticks == PT_FREQ) {
+    ticks = 0;
+    tlb_stats_second();
+  }
   switch_running_process();
   send_eoi(PT_IRQ_NUM);
 }
@@ -79,9 +84,10 @@ void switch_running_process() {
     );
     // clang-format on
 
-    if (next_process != 0) {
-      // get the pcb of the current process and save the EBP and ESP values
-      pcb_t* pcb = get_pcb_by_pid(curr_process);
+    // get the pcb of the current process and save the EBP and ESP values,
+    // there is none when the first shell starts from the boot stack
+    pcb_t* pcb = get_pcb_by_pid(terminals[curr_process].prog_curr_pid);
+    if (pcb != NULL) {
       pcb->esp = esp_save;
       pcb->ebp = ebp_save;
     }
@@ -91,9 +97,11 @@ void switch_running_process() {
     sys_execute((uint8_t*)"shell");
   }
 
-  // Get current proccess' pcb
-  if (terminals[curr_process].prog_curr_pid == -1) return;
+  // Get current and next proccess' pcb, a process that is halting has none
+  // and keeps running until it is done
   pcb_t* pcb = get_pcb_by_pid(terminals[curr_process].prog_curr_pid);
+  pcb_t* pcb_next = get_pcb_by_pid(pid);
+  if (pcb == NULL || pcb_next == NULL) return;
 
   // Save curr process esp and ebp
   // clang-format off
@@ -113,7 +121,7 @@ void switch_running_process() {
 
   // Set TSS
   tss.ss0 = KERNEL_DS;
-  tss.esp0 = _8MB - 4 - (pid * _8KB);  // -4 for esp offset
+  tss.esp0 = PCB_KSTACK_TOP(pcb_next);
 
   // Update running video coordinates
   restore_cursor(terminals[next_process].screen_x_save,
@@ -122,9 +130,6 @@ void switch_running_process() {
   // update the flag if the next process is on the current terminal
   on_screen = (next_process == curr_ter) ? 1 : 0;
 
-  // Get next proccess' pcb
-  pcb_t* pcb_next = get_pcb_by_pid(terminals[next_process].prog_curr_pid);
-
   curr_process = next_process;
   // Restore next process' esp/ebp
   // clang-format off
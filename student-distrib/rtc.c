@@ -83,27 +83,18 @@ int32_t rtc_open(const uint8_t* filename) {
 int32_t rtc_close(int32_t fd) {
   uint32_t max_requested_freq = RTC_START_FREQ;
   pcb_t* pcb;
-  int i;
   // Get maximum frequency
-  for (i = 0; i < MAX_PROCESSES; i++) {
-    if (used_pids[i]) {
-      pcb = get_pcb_by_pid(i);
-      if (pcb->prog_freq > max_requested_freq)
-        max_requested_freq = pcb->prog_freq;
-    }
-  }
+  for (pcb = get_live_pcbs(); pcb != NULL; pcb = pcb->next)
+    if (pcb->prog_freq > max_requested_freq)
+      max_requested_freq = pcb->prog_freq;
 
   // Set maximum frequency
   higher_freq = max_requested_freq;
   rtc_set_frequency((uint32_t)higher_freq);
 
   // Update all PCB divisors
-  for (i = 0; i < MAX_PROCESSES; i++) {
-    if (used_pids[i]) {
-      pcb = get_pcb_by_pid(i);
-      if (pcb->prog_freq > 0) pcb->divisor = (higher_freq / pcb->prog_freq);
-    }
-  }
+  for (pcb = get_live_pcbs(); pcb != NULL; pcb = pcb->next)
+    if (pcb->prog_freq > 0) pcb->divisor = (higher_freq / pcb->prog_freq);
 
   return 0;
 }
@@ -173,13 +164,9 @@ int32_t rtc_write(int32_t fd, const void* buf, int32_t nbytes) {
     higher_freq = freq;
 
     // Update all PCBs divisors
-    int i;
-    for (i = 0; i < MAX_PROCESSES; i++) {
-      if (used_pids[i]) {
-        pcb = get_pcb_by_pid(i);
-        if (pcb->prog_freq > 0) {
-          pcb->divisor = (higher_freq / pcb->prog_freq);
-        }
+    for (pcb = get_live_pcbs(); pcb != NULL; pcb = pcb->next) {
+      if (pcb->prog_freq > 0) {
+        pcb->divisor = (higher_freq / pcb->prog_freq);
       }
     }
   } else {  // Only update current PCB divisor
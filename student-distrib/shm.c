@@ -0,0 +1,197 @@
+#include "shm.h"
+
+// Global Variables
+static shm_segment_t shm_segments[SHM_MAX_SEGMENTS];
+
+/* Name: shm_free_frames()
+ * Description: drops the segment's reference to its first frames, a frame
+ *              is freed once no process has it mapped either
+ * Inputs: seg: the segment, num_pages: how many of its frames
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void shm_free_frames(shm_segment_t* seg, uint32_t num_pages) {
+  uint32_t i;
+  for (i = 0; i < num_pages; i++) frame_put(seg->frames[i]);
+}
+
+/* Name: shm_init()
+ * Description: forgets every segment, call once the frame allocator has its
+ *              memory
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void shm_init() { memset(shm_segments, 0, sizeof(shm_segments)); }
+
+/* Name: shm_create()
+ * Description: finds the segment with a key, or creates it with zeroed
+ *              frames if there is none
+ * Inputs: key: the segment's name, size: bytes it needs, up to
+ *         SHM_MAX_PAGES pages, pid: the process asking for it
+ * Outputs: none
+ * Return Value: the segment's id, -1 if the segment with that key is smaller
+ *               than size, or there is no free segment or frame
+ * Side Effects: a new segment is held for pid until shm_disown
+ */
+int32_t shm_create(int32_t key, uint32_t size, int32_t pid) {
+  uint32_t flags, num_pages = (size + FRAME_SIZE - 1) / FRAME_SIZE, i;
+  int32_t id, free_id = ERROR;
+  shm_segment_t* seg;
+  if (num_pages > SHM_MAX_PAGES) return ERROR;
+
+  cli_and_save(flags);
+
+  for (id = 0; id < SHM_MAX_SEGMENTS; id++) {
+    if (shm_segments[id].num_pages == 0) {
+      if (free_id == ERROR) free_id = id;
+    } else if (shm_segments[id].key == key) {
+      restore_flags(flags);
+      return (num_pages <= shm_segments[id].num_pages) ? id : ERROR;
+    }
+  }
+  if (free_id == ERROR || num_pages == 0) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  seg = &shm_segments[free_id];
+  for (i = 0; i < num_pages; i++) {
+    if ((seg->frames[i] = frame_alloc(FRAME_ORDER_4KB)) == 0) {
+      shm_free_frames(seg, i);
+      restore_flags(flags);
+      return ERROR;
+    }
+    memset((void*)seg->frames[i], 0, FRAME_SIZE);
+  }
+  seg->key = key;
+  seg->num_pages = num_pages;
+  seg->attached = 0;
+  seg->creator = pid;
+  seg->held = 1;
+
+  restore_flags(flags);
+  return free_id;
+}
+
+/* Name: shm_get()
+ * Description: counts an attachment of a segment, it isn't freed until the
+ *              attachment is put
+ * Inputs: id: the segment's id
+ * Outputs: none
+ * Return Value: the number of pages in the segment, -1 if it isn't used
+ * Side Effects: none
+ */
+int32_t shm_get(int32_t id) {
+  uint32_t flags;
+  int32_t num_pages;
+  if (id < 0 || id >= SHM_MAX_SEGMENTS) return ERROR;
+
+  cli_and_save(flags);
+  num_pages = shm_segments[id].num_pages;
+  if (num_pages)
+    shm_segments[id].attached++;
+  else
+    num_pages = ERROR;
+  restore_flags(flags);
+  return num_pages;
+}
+
+/* Name: shm_get_frame()
+ * Description: gets the frame of a page of a segment, for mapping it
+ * Inputs: id: the segment's id, page: index of the page in the segment
+ * Outputs: none
+ * Return Value: physical address of the frame, 0 if there is no such page
+ * Side Effects: none
+ */
+uint32_t shm_get_frame(int32_t id, uint32_t page) {
+  if (id < 0 || id >= SHM_MAX_SEGMENTS) return 0;
+  if (page >= shm_segments[id].num_pages) return 0;
+  return shm_segments[id].frames[page];
+}
+
+/* Name: shm_put()
+ * Description: ends an attachment of a segment from shm_get, the segment is
+ *              removed with the last one unless its creator still holds it
+ * Inputs: id: the segment's id
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: the key may name a new segment after
+ */
+void shm_put(int32_t id) {
+  uint32_t flags;
+  shm_segment_t* seg;
+  if (id < 0 || id >= SHM_MAX_SEGMENTS) return;
+
+  cli_and_save(flags);
+  seg = &shm_segments[id];
+  if (seg->num_pages && seg->attached && --seg->attached == 0 && !seg->held) {
+    shm_free_frames(seg, seg->num_pages);
+    seg->num_pages = 0;
+  }
+  restore_flags(flags);
+}
+
+/* Name: shm_disown()
+ * Description: drops the hold a segment's creator has on it, once the
+ *              creator has attached it or is exiting. An unattached segment
+ *              is removed
+ * Inputs: id: the segment's id, pid: the process, nothing happens if it
+ *         isn't the creator
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: the key may name a new segment after
+ */
+void shm_disown(int32_t id, int32_t pid) {
+  uint32_t flags;
+  shm_segment_t* seg;
+  if (id < 0 || id >= SHM_MAX_SEGMENTS) return;
+
+  cli_and_save(flags);
+  seg = &shm_segments[id];
+  if (seg->num_pages && seg->held && seg->creator == pid) {
+    seg->held = 0;
+    if (seg->attached == 0) {
+      shm_free_frames(seg, seg->num_pages);
+      seg->num_pages = 0;
+    }
+  }
+  restore_flags(flags);
+}
+
+/* Name: shm_exit()
+ * Description: drops the holds of an exiting process on the segments it
+ *              created and never attached
+ * Inputs: pid: the process
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: segments nobody attached are removed
+ */
+void shm_exit(int32_t pid) {
+  int32_t id;
+  for (id = 0; id < SHM_MAX_SEGMENTS; id++) shm_disown(id, pid);
+}
+
+/* Name: get_shm_stats()
+ * Description: adds up the segments in use
+ * Inputs: stats: where to put the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_shm_stats(shm_stats_t* stats) {
+  uint32_t flags, id;
+  cli_and_save(flags);
+
+  memset(stats, 0, sizeof(shm_stats_t));
+  for (id = 0; id < SHM_MAX_SEGMENTS; id++) {
+    if (shm_segments[id].num_pages == 0) continue;
+    stats->segments++;
+    stats->pages += shm_segments[id].num_pages;
+    stats->attached += shm_segments[id].attached;
+  }
+
+  restore_flags(flags);
+}
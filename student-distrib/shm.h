@@ -0,0 +1,46 @@
+#ifndef _SHM_H
+#define _SHM_H
+
+#include "frame.h"
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// A segment is a set of frames that processes attach into their shared
+// memory area, so they all see the same memory. A segment is named by a key
+// the programs agree on. Its creator holds it until it attaches it or exits,
+// after that it lives until the last process detaches it
+#define SHM_MAX_SEGMENTS 16
+#define SHM_MAX_PAGES 64  // 256 kB
+
+/* --- Local Types --- */
+
+typedef struct shm_segment {
+  int32_t key;
+  uint32_t num_pages;  // 0 if the segment isn't used
+  uint32_t attached;   // attachments of processes
+  int32_t creator;     // pid that made it
+  uint8_t held;        // 1 until the creator attaches it or exits
+  uint32_t frames[SHM_MAX_PAGES];  // each holds a reference for the segment
+} shm_segment_t;
+
+// Counters for the segments
+typedef struct shm_stats {
+  uint32_t segments;  // segments in use
+  uint32_t pages;     // frames they hold
+  uint32_t attached;  // attachments of all of them
+} shm_stats_t;
+
+/* --- Function Prototypes --- */
+
+void shm_init();
+int32_t shm_create(int32_t key, uint32_t size, int32_t pid);
+int32_t shm_get(int32_t id);
+uint32_t shm_get_frame(int32_t id, uint32_t page);
+void shm_put(int32_t id);
+void shm_disown(int32_t id, int32_t pid);
+void shm_exit(int32_t pid);
+void get_shm_stats(shm_stats_t* stats);
+
+#endif
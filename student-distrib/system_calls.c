@@ -1,8 +1,16 @@
 #include "system_calls.h"
+#include "shm.h"
+#include "tmpfs.h"
+#include "vfs.h"
 
 // int8_t curr_pid = -1;                          // -1 means no processes
 char ELF_MAGIC[4] = {0x7f, 0x45, 0x4c, 0x46};  // ".ELF"
 
+static fault_stats_t fault_stats;
+
+static void mmap_release(pcb_t* pcb, mmap_region_t* region);
+static void shm_release(pcb_t* pcb, shm_attach_t* attach);
+
 /* Name: sys_halt()
  * Description: halt system call. Terminates a process and returns control to
  *              its parent.
@@ -16,35 +24,48 @@ int32_t sys_halt(uint8_t status) {
   if (pcb == NULL) return ERROR;
   int i;
   int pid = pcb->pid;
+  // base shells have no parent, they are started again below
+  pcb_t* par_pcb = (pcb->par_pcb_ptr != NULL) ? pcb->par_pcb_ptr : pcb;
 
   /* --- Restore parent data --- */
   tss.ss0 = KERNEL_DS;
-  tss.esp0 = _8MB - 4 - (pcb->par_pid * _8KB);
-  // curr_pid--;
-  used_pids[pid] = 0;
+  tss.esp0 = PCB_KSTACK_TOP(par_pcb);
   printf("-- Halting Process #%d --\n", pid);
 
   /* --- Restore parent paging --- */
-  enable_program_page(pcb->par_pid);
+  enable_program_page(par_pcb->pid);
 
   /* --- Close open files --- */
   for (i = 0; i < FDT_MAX_ENTRIES; i++)
     if (pcb->fdt[i].flags.enabled) pcb->fdt[i].fot_ptr->close(i);
+  for (i = 0; i < MMAP_MAX_REGIONS; i++) mmap_release(pcb, &pcb->mmaps[i]);
+  free_mmap_table(pid);
+  for (i = 0; i < SHM_MAX_ATTACH; i++) shm_release(pcb, &pcb->shms[i]);
+  free_shm_table(pid);
+  shm_exit(pid);
+
+  /* --- Free program memory --- */
+  free_user_table(pid);
+
+  // The scheduler skips a terminal whose process has no PCB, so from here on
+  // this process doesn't leave its kernel stack until it is off it for good
+  cli();
+  pcb_free(pcb);
 
-  if (pid < 3) {  // Restart the base shells if exited
+  if (par_pcb == pcb) {  // Restart the base shells if exited
     puts("-- Exited Root Process --\n");
     sys_execute((uint8_t*)"shell");
   }
 
   // Update PIDs in terminal state struct for scheduling
-  terminals[curr_process].prog_curr_pid = pcb->par_pcb_ptr->pid;
-  terminals[curr_process].prog_par_pid = pcb->par_pcb_ptr->par_pid;
+  terminals[curr_process].prog_curr_pid = par_pcb->pid;
+  terminals[curr_process].prog_par_pid = par_pcb->par_pid;
 
   /* --- Jump to execute return --- */
   uint32_t par_esp = pcb->par_esp;
   uint32_t par_ebp = pcb->par_ebp;
-
-  *pcb = (const pcb_t){0};  // Clear out old pcb
+  uint32_t forked = pcb->forked;
+  if (forked) status = pid;  // fork returns the child's pid to the parent
 
   // clang-format off
   asm volatile(
@@ -52,9 +73,11 @@ int32_t sys_halt(uint8_t status) {
       "movl %1, %%ebp;"
       "movl $0, %%eax;"   // Set return val
       "movb %2, %%al;"
+      "cmpl $0, %3;"
+      "jne ret_to_fork;"  // Go back to fork
       "jmp ret_to_exec;"  // Go back to execute
       :
-      : "r"(par_esp), "r"(par_ebp), "r"(status)
+      : "r"(par_esp), "r"(par_ebp), "r"(status), "r"(forked)
       : "eax", "cc");
   // clang-format on
 
@@ -105,49 +128,61 @@ int32_t sys_execute(const uint8_t* command) {
 
   /* --- Executable Check --- */
   dir_entry_t exe_dir_entry;
-  if (read_dentry_by_name(executable_name, &exe_dir_entry) == ERROR)
+  int32_t exe_mount;
+  if (vfs_lookup(executable_name, &exe_mount, &exe_dir_entry) == ERROR)
     return ERROR;
+  mount_t* exe_fs = vfs_get_mount(exe_mount);
 
-  // Check elf file magic constant (first 4 bytes)
-  uint8_t buf_elf[4];
-  if (read_data(exe_dir_entry.inode_num, 0, buf_elf, 4) == ERROR) return ERROR;
+  // Check elf file magic constant (first 4 bytes), the header also has the
+  // first instruction's address
+  uint8_t buf_elf[PROG_HEADER_SIZE];
+  if (exe_fs->ops->read_data(exe_fs->fs, exe_dir_entry.inode_num, 0, buf_elf,
+                             PROG_HEADER_SIZE) != PROG_HEADER_SIZE)
+    return ERROR;
 
   for (i = 0; i < 4; i++)
     if (buf_elf[i] != ELF_MAGIC[i]) return ERROR;
 
+  // The program has to fit in its 4MB above the load address
+  stat_t exe_stat;
+  if (exe_fs->ops->stat(exe_fs->fs, exe_dir_entry.file_type,
+                        exe_dir_entry.inode_num, &exe_stat) == ERROR)
+    return ERROR;
+  if (exe_stat.file_size > PROG_MAX_SIZE) return ERROR;
+
   /* --- Paging --- */
-  int new_pid = get_new_pid();
+  // the terminal's running process, none when starting a base shell
+  pcb_t* par_pcb = get_pcb_by_pid(terminals[curr_process].prog_curr_pid);
+  pcb_t* new_pcb = pcb_alloc();
 
-  if (new_pid == ERROR) {  // Max processes already running
-    printf("-- Max Processes Already Reached (%d) --\n", MAX_PROCESSES);
+  if (new_pcb == NULL) {  // no memory for the PCB or its stack
+    printf("-- Out Of Memory (%d Processes) --\n", get_num_procs());
+    return ERROR;
+  }
+  int new_pid = new_pcb->pid;
+  if (alloc_user_table(new_pid) == ERROR) {  // no memory for the page table
+    printf("-- Out Of Memory --\n");
+    pcb_free(new_pcb);
     return ERROR;
   }
   enable_program_page(new_pid);
 
   /* --- User-level Program loader --- */
-  // Copy contents
-  if (read_data(exe_dir_entry.inode_num, 0, (uint8_t*)PROG_LOAD_ADDR,
-                FOUR_MB) == ERROR)
-    return ERROR;
+  // Nothing is copied yet, handle_user_fault reads each page of the program
+  // in when it is first used
+  new_pcb->exe_mount = exe_mount;
+  new_pcb->exe_inode = exe_dir_entry.inode_num;
+  new_pcb->exe_size = exe_stat.file_size;
 
   // Get first instructions addr (eip)
-  uint32_t eip = *((uint32_t*)(PROG_LOAD_ADDR + PROG_ENTRY_OFFSET));
+  uint32_t eip = *((uint32_t*)(buf_elf + PROG_ENTRY_OFFSET));
   // eip for testprint should be 0x080481A4
   // eip for shell should be 0x080482E8
 
   /* --- Create PCB --- */
-  pcb_t* new_pcb = get_pcb_by_pid(new_pid);
-  new_pcb->pid = new_pid;
-
-  // set default values to prevent issues
-  new_pcb->prog_freq = 0;
-  new_pcb->count = 0;
-  new_pcb->divisor = 0;
-
-  new_pcb->par_pid = get_curr_pcb()->pid;
-  if (new_pid < 3) { new_pcb->par_pid = new_pid; }
-
-  new_pcb->par_pcb_ptr = get_curr_pcb();
+  // pcb_alloc zeroed the rest, the rtc and mmap state start out unused
+  new_pcb->par_pcb_ptr = par_pcb;
+  new_pcb->par_pid = (par_pcb != NULL) ? par_pcb->pid : new_pid;
   if (have_args) {  // Store program arguments in pcb
     new_pcb->arg_len = strlen(arguments);
     strncpy(new_pcb->args, arguments, new_pcb->arg_len);
@@ -188,13 +223,14 @@ int32_t sys_execute(const uint8_t* command) {
   }
 
   /* --- Context Switch --- */
-  // Kernel stack starts at 8MB, each process is 8KB, and esp is 4 from top of
-  //  stack
+  // esp is 4 from the top of the new process's kernel stack. The scheduler
+  // must not switch away before the iret, a base shell started by sys_halt is
+  // still on the stack of the process that halted
+  cli();
   tss.ss0 = KERNEL_DS;
-  tss.esp0 = _8MB - 4 - (new_pid * _8KB);  // -4 for esp offset
+  tss.esp0 = PCB_KSTACK_TOP(new_pcb);
 
   printf("-- Executing Process #%d (T%d) --\n", new_pid, curr_process);
-  used_pids[new_pid] = 1;
 
   // Update PIDs in terminal state struct for scheduling
   terminals[curr_process].prog_curr_pid = new_pid;
@@ -212,6 +248,7 @@ int32_t sys_execute(const uint8_t* command) {
     "pushl %%eax;"      // push user DS
     "pushl %2;"         // push ESP
     "pushfl;"           // push EFLAG
+    "orl $0x200, (%%esp);"  // with interrupts on in the program
     "pushl %3;"         // push CS
     "pushl %4;"         // push EIP
     "iret;"
@@ -229,34 +266,172 @@ int32_t sys_execute(const uint8_t* command) {
   return 0;
 }
 
-/* Name: init_pid()
- * Description: initializes pid array to allow for multiple proceses to be ran,
- *              called from kernel.c
+/* Name: sys_fork()
+ * Description: fork system call, starts a copy of the running process. The
+ *              child shares the parent's pages copy on write and gets a copy
+ *              of its PCB and FDT, it returns from fork to the same place.
+ *              There is one running process per terminal, so the parent
+ *              waits in fork until the child halts, as it would in execute
  * Inputs: None
  * Outputs: None
- * Return Value: None
- * Side Effects: Makes a array of size MAX_PROCESSES and initializes it
+ * Return Value: 0 in the child, the child's pid in the parent once it halts,
+ *               -1 if there is no free PID or memory
+ * Side Effects: the parent's pages are read only until it writes them
  */
-void init_pid() {
+int32_t sys_fork(void) {
+  pcb_t* par_pcb = get_curr_pcb();
+  pcb_t* new_pcb = pcb_alloc();
   int i;
-  for (i = 0; i < MAX_PROCESSES; i++) { used_pids[i] = 0; }
+
+  if (new_pcb == NULL) {  // no memory for the PCB or its stack
+    printf("-- Out Of Memory (%d Processes) --\n", get_num_procs());
+    return ERROR;
+  }
+  int new_pid = new_pcb->pid;
+  if (alloc_user_table(new_pid) == ERROR ||
+      share_user_table(par_pcb->pid, new_pid) == ERROR) {
+    printf("-- Out Of Memory --\n");
+    free_user_table(new_pid);
+    pcb_free(new_pcb);
+    return ERROR;
+  }
+
+  /* --- Create PCB --- */
+  // pcb_alloc zeroed the rest, the mmap regions start out unused
+  new_pcb->par_pcb_ptr = par_pcb;
+  new_pcb->par_pid = par_pcb->pid;
+  new_pcb->forked = 1;
+  memcpy(new_pcb->args, par_pcb->args, BUF_LEN);
+  new_pcb->arg_len = par_pcb->arg_len;
+  new_pcb->prog_freq = par_pcb->prog_freq;
+  new_pcb->count = par_pcb->count;
+  new_pcb->divisor = par_pcb->divisor;
+  new_pcb->exe_mount = par_pcb->exe_mount;
+  new_pcb->exe_inode = par_pcb->exe_inode;
+  new_pcb->exe_size = par_pcb->exe_size;
+
+  // The FDT is copied, each file keeps its own position from here on
+  memcpy(new_pcb->fdt, par_pcb->fdt, sizeof(new_pcb->fdt));
+  for (i = 0; i < FDT_MAX_ENTRIES; i++)
+    if (new_pcb->fdt[i].flags.enabled && new_pcb->fdt[i].fot_ptr == &tmpfs_fot)
+      tmpfs_dup(new_pcb->fdt[i].inode_idx);
+
+  // The child leaves the kernel through the end of SYS_handler_wrapper, with
+  // a copy of the registers the parent entered it with
+  uint32_t* par_frame = (uint32_t*)PCB_KSTACK_TOP(par_pcb) - SYS_FRAME_WORDS;
+  uint32_t* new_frame = (uint32_t*)PCB_KSTACK_TOP(new_pcb) - SYS_FRAME_WORDS;
+  memcpy(new_frame, par_frame, SYS_FRAME_WORDS * sizeof(uint32_t));
+
+  // Save parent esp and ebp
+  // clang-format off
+  asm volatile(
+      "movl %%esp, %0;"
+      "movl %%ebp, %1;"
+      : "=r"(new_pcb->par_esp), "=r"(new_pcb->par_ebp)
+      :
+      : "cc"
+  );
+  // clang-format on
+
+  /* --- Context Switch --- */
+  cli();
+  tss.ss0 = KERNEL_DS;
+  tss.esp0 = PCB_KSTACK_TOP(new_pcb);
+
+  printf("-- Forking Process #%d (T%d) --\n", new_pid, curr_process);
+
+  // Update PIDs in terminal state struct for scheduling
+  terminals[curr_process].prog_curr_pid = new_pid;
+  terminals[curr_process].prog_par_pid = new_pcb->par_pid;
+  enable_program_page(new_pid);
+
+  uint32_t ret = 0;
+  // clang-format off
+  asm volatile (
+    "movl %1, %%esp;"
+    "movl $0, %%eax;"   // the child's return val
+    "jmp sys_call_return;"
+    "ret_to_fork:;"     // Where halt jumps to
+    "movl %%eax, %0"    // Copy the child's pid
+    : "=r"(ret)
+    : "r"(new_frame)
+    : "eax", "cc"
+  );
+  // clang-format on
+
+  return ret;
 }
 
-/* Name: get_new_pid()
- * Description: Finds the next available pid
- * Inputs: None
+/* Name: handle_user_fault()
+ * Description: resolves a page fault in the running program's 4MB. A page
+ *              of the program's file is read in from the file, any other page
+ *              above the load address (bss, heap and stack) is zero filled,
+ *              and a write to a page shared since a fork copies it
+ * Inputs: addr - the address that faulted, error - the fault's error code
  * Outputs: None
- * Return Value: the new assigned pid or -1 if none available
- * Side Effects: Updates the global pid array
+ * Return Value: 0 if the page is mapped now, -1 for a fault the program has
+ *               to be halted for
+ * Side Effects: takes a frame, reading the file may sleep on the disk
  */
-int8_t get_new_pid() {
-  int i;
-  for (i = 0; i < MAX_PROCESSES; i++) {
-    if (used_pids[i] == 0) {
-      return i;
+int32_t handle_user_fault(uint32_t addr, uint32_t error) {
+  pcb_t* pcb = get_pcb_by_pid(terminals[curr_process].prog_curr_pid);
+  uint32_t page = addr & ~(PAGE_SIZE - 1), frame, len;
+  mount_t* mount;
+
+  if (pcb == NULL || page < PROG_LOAD_ADDR || page >= USER_START + FOUR_MB) {
+    fault_stats.failed++;
+    return ERROR;
+  }
+  if (error & PF_ERR_PRESENT) {
+    if (!(error & PF_ERR_WRITE) ||
+        copy_user_page(pcb->pid, (page - USER_START) / PAGE_SIZE) == ERROR) {
+      fault_stats.failed++;
+      return ERROR;
     }
+    fault_stats.cow_pages++;
+    return 0;
   }
-  return ERROR;
+  if ((frame = frame_alloc(FRAME_ORDER_4KB)) == 0) {
+    fault_stats.failed++;
+    return ERROR;
+  }
+  memset((void*)frame, 0, PAGE_SIZE);
+
+  if (page - PROG_LOAD_ADDR < pcb->exe_size) {
+    len = pcb->exe_size - (page - PROG_LOAD_ADDR);
+    if (len > PAGE_SIZE) len = PAGE_SIZE;
+    mount = vfs_get_mount(pcb->exe_mount);
+    if (mount == NULL ||
+        mount->ops->read_data(mount->fs, pcb->exe_inode,
+                              page - PROG_LOAD_ADDR, (uint8_t*)frame,
+                              len) == ERROR) {
+      frame_free(frame, FRAME_ORDER_4KB);
+      fault_stats.failed++;
+      return ERROR;
+    }
+    fault_stats.file_pages++;
+  } else {
+    fault_stats.zero_pages++;
+  }
+
+  if (set_user_page(pcb->pid, (page - USER_START) / PAGE_SIZE, frame) ==
+      ERROR) {
+    frame_free(frame, FRAME_ORDER_4KB);
+    fault_stats.failed++;
+    return ERROR;
+  }
+  return 0;
+}
+
+/* Name: get_fault_stats()
+ * Description: copies out the page fault counters
+ * Inputs: stats - where to copy the counters
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: None
+ */
+void get_fault_stats(fault_stats_t* stats) {
+  memcpy(stats, &fault_stats, sizeof(fault_stats_t));
 }
 
 /* Name: get_new_fd()
@@ -307,28 +482,38 @@ int32_t sys_write(int32_t fd, const void* buf, int32_t nbytes) {
 }
 
 /* Name: sys_open()
- * Description: open system call, routes to corresponding handler, inits the
- *  fdt
+ * Description: open system call, finds the file through the vfs, routes to
+ *  the handler of its type in the mount it is in, inits the fdt
  * Inputs: const uint8_t* filename
  * Outputs: None
  * Return Value: int32_t return value passed through from handler
  * Side Effects: None
  */
 int32_t sys_open(const uint8_t* filename) {
+  if (filename == NULL) return ERROR;
+
   dir_entry_t file;
-  if (read_dentry_by_name(filename, &file) == ERROR)  // no such file
+  int32_t mount;
+  if (vfs_lookup(filename, &mount, &file) == ERROR)  // no such file
     return ERROR;
 
+  // pick the file operations from the type and the mount
+  fot_t* fot;
+  mount_t* mnt = vfs_get_mount(mount);
+  if (file.file_type == FILE_TYPE_RTC)
+    fot = &rtc_fot;
+  else if (file.file_type == FILE_TYPE_DIR)
+    fot = mnt->dir_fot;
+  else
+    fot = mnt->file_fot;
+  if (fot == NULL) return ERROR;
+
   int fd = get_new_fd();
   if (fd == ERROR) return ERROR;  // fdt is full
 
   pcb_t* curr_pcb = get_curr_pcb();
   curr_pcb->fdt[fd].flags.enabled = 1;  // set to being used
 
-  // check if file being opened is rtc
-  int isRTC =
-      !(strncmp((int8_t*)filename, (int8_t*)"rtc", strlen((int8_t*)filename)));
-
   // For testing, stdin and stdout
   int i = 0;
   for (i = 0; i < 2; i++) {
@@ -340,18 +525,20 @@ int32_t sys_open(const uint8_t* filename) {
   }
 
   // init fdt entry
-  curr_pcb->fdt[fd].fot_ptr = isRTC ? &rtc_fot : &file_fot;
+  curr_pcb->fdt[fd].fot_ptr = fot;
   curr_pcb->fdt[fd].inode_idx = file.inode_num;
   curr_pcb->fdt[fd].file_position = 0;
   curr_pcb->fdt[fd].flags.enabled = 1;
-  curr_pcb->fdt[fd].flags.is_data_file = (file.file_type == 2) ? 1 : 0;
-
-  // update fot for directory files
-  if (file.file_type == 1) curr_pcb->fdt[fd].fot_ptr = &dir_fot;
+  curr_pcb->fdt[fd].flags.is_data_file =
+      (file.file_type == FILE_TYPE_FILE) ? 1 : 0;
+  curr_pcb->fdt[fd].flags.mount = mount;
+  curr_pcb->fdt[fd].ind_cache.gen = 0;  // nothing cached yet
 
   // if there is an issue with the file's open funciton, error
-  OpenFn open_func = curr_pcb->fdt[fd].fot_ptr->open;
-  if ((*open_func)(filename)) return ERROR;
+  if (fot->open(vfs_resolve(filename, &mount))) {
+    curr_pcb->fdt[fd].flags.enabled = 0;
+    return ERROR;
+  }
 
   return fd;
 }
@@ -413,7 +600,9 @@ int32_t sys_vidmap(uint8_t** screen_start) {
   // check if it is in the user space video mem
   if ((int)screen_start < _128_MB || (int)screen_start > _132_MB) return ERROR;
 
-  *screen_start = get_vidmem();
+  uint8_t* vidmem = get_vidmem(get_curr_pcb()->pid);
+  if (vidmem == NULL) return ERROR;
+  *screen_start = vidmem;
 
   return 0;
 }
@@ -441,3 +630,522 @@ int32_t sys_sigreturn(void) {
   printf("Not implemented yet\n");
   return ERROR;
 }
+
+/* Name: sys_create()
+ * Description: create system call, makes an empty file in the mount the
+ *  path is in
+ * Inputs: const uint8_t* filename
+ * Outputs: None
+ * Return Value: int32_t 0 on success, -1 on failure
+ * Side Effects: adds a directory entry and allocates an inode
+ */
+int32_t sys_create(const uint8_t* filename) {
+  if (filename == NULL) return ERROR;
+  if (vfs_create(filename) == ERROR) return ERROR;
+  return 0;
+}
+
+/* Name: sys_delete()
+ * Description: delete system call, removes a file from the mount the path is
+ *  in
+ * Inputs: const uint8_t* filename
+ * Outputs: None
+ * Return Value: int32_t 0 on success, -1 on failure
+ * Side Effects: frees the file's inode and data blocks
+ */
+int32_t sys_delete(const uint8_t* filename) {
+  if (filename == NULL) return ERROR;
+  return vfs_delete(filename);
+}
+
+/* Name: sys_truncate()
+ * Description: truncate system call, sets the length of an open file
+ * Inputs: int32_t fd, uint32_t length
+ * Outputs: None
+ * Return Value: int32_t 0 on success, -1 on failure
+ * Side Effects: frees or zero fills data blocks
+ */
+int32_t sys_truncate(int32_t fd, uint32_t length) {
+  if (fd < 2 || fd >= FDT_SIZE) return ERROR;
+  pcb_t* curr_pcb = get_curr_pcb();
+  if (!(curr_pcb->fdt[fd].flags.enabled)) return ERROR;  // sanity check
+  mount_t* mnt = vfs_get_mount(curr_pcb->fdt[fd].flags.mount);
+  if (mnt == NULL || curr_pcb->fdt[fd].fot_ptr != mnt->file_fot)
+    return ERROR;  // files only
+
+  return mnt->ops->truncate(mnt->fs, curr_pcb->fdt[fd].inode_idx, length);
+}
+
+/* Name: sys_getdents()
+ * Description: getdents system call, reads a batch of directory entries from
+ *  an open directory in a single call
+ * Inputs: int32_t fd, void* buf, int32_t nbytes
+ * Outputs: buf - filled with packed dirent_t records
+ * Return Value: int32_t bytes written, 0 at end of directory, -1 on failure
+ * Side Effects: advances the directory position
+ */
+int32_t sys_getdents(int32_t fd, void* buf, int32_t nbytes) {
+  if (buf == NULL) return ERROR;
+  if (fd < 0 || fd >= FDT_SIZE) return ERROR;
+  pcb_t* curr_pcb = get_curr_pcb();
+  if (!(curr_pcb->fdt[fd].flags.enabled)) return ERROR;  // sanity check
+  mount_t* mnt = vfs_get_mount(curr_pcb->fdt[fd].flags.mount);
+  if (mnt == NULL || curr_pcb->fdt[fd].fot_ptr != mnt->dir_fot)
+    return ERROR;  // dirs only
+
+  return mnt->ops->getdents(fd, buf, nbytes);
+}
+
+/* Name: sys_lseek()
+ * Description: lseek system call, routes to the seek handler of the fd to
+ *  move its position
+ * Inputs: int32_t fd, int32_t offset, int32_t whence - SEEK_SET, SEEK_CUR or
+ *  SEEK_END
+ * Outputs: None
+ * Return Value: int32_t new position, -1 on failure
+ * Side Effects: Updates the fd's position
+ */
+int32_t sys_lseek(int32_t fd, int32_t offset, int32_t whence) {
+  if (fd < 0 || fd >= FDT_SIZE) return ERROR;
+  if (!(get_curr_pcb()->fdt[fd].flags.enabled)) return ERROR;  // sanity check
+  return get_curr_pcb()->fdt[fd].fot_ptr->seek(fd, offset, whence);
+}
+
+/* Name: sys_pread()
+ * Description: pread system call, routes to the positional read handler of
+ *  the fd. Offset is passed in ESI
+ * Inputs: int32_t fd, void* buf, int32_t nbytes, uint32_t offset
+ * Outputs: None
+ * Return Value: int32_t bytes read, -1 on failure
+ * Side Effects: None, the fd's position is not changed
+ */
+int32_t sys_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset) {
+  if (buf == NULL) return ERROR;
+  if (fd < 0 || fd >= FDT_SIZE) return ERROR;
+  if (!(get_curr_pcb()->fdt[fd].flags.enabled)) return ERROR;  // sanity check
+  return get_curr_pcb()->fdt[fd].fot_ptr->pread(fd, buf, nbytes, offset);
+}
+
+/* Name: check_iov()
+ * Description: sanity checks the segment array passed to readv or writev
+ * Inputs: int32_t fd, const iovec_t* iov, int32_t iovcnt
+ * Outputs: None
+ * Return Value: int32_t 0 if the call can go ahead, -1 otherwise
+ * Side Effects: None
+ */
+static int32_t check_iov(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  int i;
+  if (iov == NULL) return ERROR;
+  if (iovcnt <= 0 || iovcnt > IOV_MAX) return ERROR;
+  if (fd < 0 || fd >= FDT_SIZE) return ERROR;
+  if (!(get_curr_pcb()->fdt[fd].flags.enabled)) return ERROR;
+  for (i = 0; i < iovcnt; i++)
+    if (iov[i].base == NULL || iov[i].len < 0) return ERROR;
+  return 0;
+}
+
+/* Name: sys_readv()
+ * Description: readv system call, fills several buffers with one trap by
+ *  routing to the readv handler of the fd
+ * Inputs: int32_t fd, const iovec_t* iov, int32_t iovcnt
+ * Outputs: None
+ * Return Value: int32_t total bytes read, -1 on failure
+ * Side Effects: None
+ */
+int32_t sys_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  if (check_iov(fd, iov, iovcnt) == ERROR) return ERROR;
+  return get_curr_pcb()->fdt[fd].fot_ptr->readv(fd, iov, iovcnt);
+}
+
+/* Name: sys_writev()
+ * Description: writev system call, writes several buffers with one trap by
+ *  routing to the writev handler of the fd
+ * Inputs: int32_t fd, const iovec_t* iov, int32_t iovcnt
+ * Outputs: None
+ * Return Value: int32_t total bytes written, -1 on failure
+ * Side Effects: None
+ */
+int32_t sys_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  if (check_iov(fd, iov, iovcnt) == ERROR) return ERROR;
+  return get_curr_pcb()->fdt[fd].fot_ptr->writev(fd, iov, iovcnt);
+}
+
+/* Name: sys_sendfile()
+ * Description: sendfile system call, copies data from an open file to another
+ *  fd inside the kernel. The file's data is handed to the out fd's write
+ *  handler straight from the file system image, so it never passes through
+ *  a user buffer
+ * Inputs: int32_t out_fd - where to write, int32_t in_fd - the file to read,
+ *  int32_t count - most bytes to send
+ * Outputs: None
+ * Return Value: int32_t bytes sent, -1 on failure
+ * Side Effects: advances the position of in_fd by the bytes sent
+ */
+int32_t sys_sendfile(int32_t out_fd, int32_t in_fd, int32_t count) {
+  if (out_fd < 0 || out_fd >= FDT_SIZE) return ERROR;
+  if (in_fd < 0 || in_fd >= FDT_SIZE) return ERROR;
+  if (count < 0) return ERROR;
+
+  pcb_t* curr_pcb = get_curr_pcb();
+  fdt_entry_t* in = &curr_pcb->fdt[in_fd];
+  fdt_entry_t* out = &curr_pcb->fdt[out_fd];
+  if (!(in->flags.enabled) || !(out->flags.enabled)) return ERROR;
+  if (in->fot_ptr != &file_fot) return ERROR;  // can only send from files
+
+  const uint8_t* data;
+  ind_cache_t cache = in->ind_cache;
+  int32_t run = 0, written = 0, sent = 0;
+  while (sent < count) {
+    run = get_data_run_cached(vfs_fd_fs(in_fd), in->inode_idx,
+                              in->file_position, &data, &cache);
+    if (run == ERROR) break;
+    if (run == 0) break;  // end of file
+    if (run > count - sent) run = count - sent;
+
+    written = out->fot_ptr->write(out_fd, data, run);
+    if (written == ERROR) break;
+
+    in->file_position += written;
+    sent += written;
+    if (written < run) break;  // out fd is full
+  }
+
+  in->ind_cache = cache;
+  return (sent == 0 && (run == ERROR || written == ERROR)) ? ERROR : sent;
+}
+
+/* Name: sys_stat()
+ * Description: stat system call, gets a file's size, type, inode and block
+ *  count by name without opening or reading it
+ * Inputs: const uint8_t* filename, stat_t* stat
+ * Outputs: stat - filled in with the file's metadata
+ * Return Value: int32_t 0 on success, -1 on failure
+ * Side Effects: None
+ */
+int32_t sys_stat(const uint8_t* filename, stat_t* stat) {
+  if (filename == NULL || stat == NULL) return ERROR;
+
+  dir_entry_t file;
+  int32_t mount;
+  if (vfs_lookup(filename, &mount, &file) == ERROR) return ERROR;
+  mount_t* mnt = vfs_get_mount(mount);
+  return mnt->ops->stat(mnt->fs, file.file_type, file.inode_num, stat);
+}
+
+/* Name: sys_fstat()
+ * Description: fstat system call, gets the metadata of an open fd. The type
+ *  comes from which of its mount's file operations tables the fd uses
+ * Inputs: int32_t fd, stat_t* stat
+ * Outputs: stat - filled in with the file's metadata
+ * Return Value: int32_t 0 on success, -1 on failure (or for stdin/stdout)
+ * Side Effects: None
+ */
+int32_t sys_fstat(int32_t fd, stat_t* stat) {
+  if (stat == NULL) return ERROR;
+  if (fd < 0 || fd >= FDT_SIZE) return ERROR;
+  fdt_entry_t* file = &get_curr_pcb()->fdt[fd];
+  if (!(file->flags.enabled)) return ERROR;  // sanity check
+
+  mount_t* mnt = vfs_get_mount(file->flags.mount);
+  uint32_t file_type;
+  if (mnt == NULL)
+    return ERROR;
+  else if (file->fot_ptr == mnt->file_fot)
+    file_type = FILE_TYPE_FILE;
+  else if (file->fot_ptr == mnt->dir_fot)
+    file_type = FILE_TYPE_DIR;
+  else if (file->fot_ptr == &rtc_fot)
+    file_type = FILE_TYPE_RTC;
+  else
+    return ERROR;  // the terminal isn't in the file system
+
+  return mnt->ops->stat(mnt->fs, file_type, file->inode_idx, stat);
+}
+
+/* Name: mmap_release()
+ * Description: unmaps a region of a process's mmap area and drops its
+ *              mappings of the file's data blocks
+ * Inputs: pcb_t* pcb, mmap_region_t* region - one of the process's regions
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: the region is marked unused, flushes the TLB entry of each
+ *  page
+ */
+static void mmap_release(pcb_t* pcb, mmap_region_t* region) {
+  mount_t* mnt = vfs_get_mount(region->mount);
+  uint32_t i, addr;
+
+  for (i = 0; i < region->num_pages; i++) {
+    addr = set_mmap_page(pcb->pid, region->page + i, 0);
+    if (addr && mnt != NULL && mnt->fs != NULL) unmap_data_block(mnt->fs, addr);
+    tlb_flush_page(MMAP_START + (region->page + i) * PAGE_SIZE);
+  }
+  region->num_pages = 0;
+}
+
+/* Name: mmap_find_overlap()
+ * Description: finds a region of a process that uses any of a run of pages
+ *  of its mmap area
+ * Inputs: pcb_t* pcb, uint32_t page - first page of the run, uint32_t
+ *  num_pages - its length
+ * Outputs: None
+ * Return Value: the region, NULL if the pages are free
+ * Side Effects: None
+ */
+static mmap_region_t* mmap_find_overlap(pcb_t* pcb, uint32_t page,
+                                        uint32_t num_pages) {
+  int i;
+  for (i = 0; i < MMAP_MAX_REGIONS; i++) {
+    mmap_region_t* used = &pcb->mmaps[i];
+    if (used->num_pages && page < used->page + used->num_pages &&
+        used->page < page + num_pages)
+      return used;
+  }
+  return NULL;
+}
+
+/* Name: sys_mmap()
+ * Description: mmap system call, maps part of an open file read only into
+ *  the process's mmap area at 136MB. The pages point at the image's own
+ *  data blocks, so nothing is copied. If the file is written later its
+ *  blocks are copied first and the mapping keeps the old contents
+ * Inputs: int32_t fd, uint32_t length - bytes to map, uint32_t offset -
+ *  where in the file to start, a multiple of 4kb
+ * Outputs: None
+ * Return Value: int32_t virtual address of the mapping, -1 on failure, for
+ *  files not in a memory image, compressed files or a full area
+ * Side Effects: adds pages to the process's mmap page table. They weren't
+ *  present before, so there is nothing in the TLB to flush
+ */
+int32_t sys_mmap(int32_t fd, uint32_t length, uint32_t offset) {
+  if (fd < 0 || fd >= FDT_SIZE || length == 0) return ERROR;
+  if (offset % PAGE_SIZE) return ERROR;
+  pcb_t* pcb = get_curr_pcb();
+  fdt_entry_t* file = &pcb->fdt[fd];
+  if (!(file->flags.enabled) || !(file->flags.is_data_file)) return ERROR;
+
+  mount_t* mnt = vfs_get_mount(file->flags.mount);
+  if (mnt == NULL || mnt->fs == NULL) return ERROR;  // not an image
+  uint32_t size = get_file_size(mnt->fs, file->inode_idx);
+  if (offset >= size) return ERROR;
+  if (length > size - offset) length = size - offset;
+  uint32_t num_pages = (length + PAGE_SIZE - 1) / PAGE_SIZE;
+
+  // a free region, then the first pages it fits in
+  mmap_region_t *region = NULL, *used;
+  uint32_t i, page = 0, flags, addr;
+  for (i = 0; i < MMAP_MAX_REGIONS; i++)
+    if (pcb->mmaps[i].num_pages == 0) region = &pcb->mmaps[i];
+  if (region == NULL) return ERROR;
+
+  while ((used = mmap_find_overlap(pcb, page, num_pages)) != NULL)
+    page = used->page + used->num_pages;
+  if (page + num_pages > MMAP_PAGES) return ERROR;
+
+  cli_and_save(flags);
+  if (alloc_mmap_table(pcb->pid) == ERROR) {
+    restore_flags(flags);
+    return ERROR;
+  }
+  region->page = page;
+  region->mount = file->flags.mount;
+  for (region->num_pages = 0; region->num_pages < num_pages;
+       region->num_pages++) {
+    addr = map_data_block(mnt->fs, file->inode_idx,
+                          offset / PAGE_SIZE + region->num_pages);
+    if (addr == 0) {
+      mmap_release(pcb, region);
+      restore_flags(flags);
+      return ERROR;
+    }
+    set_mmap_page(pcb->pid, page + region->num_pages, addr);
+  }
+  restore_flags(flags);
+
+  return MMAP_START + page * PAGE_SIZE;
+}
+
+/* Name: sys_munmap()
+ * Description: munmap system call, removes a mapping made by mmap
+ * Inputs: void* addr - the address mmap returned, uint32_t length - the
+ *  length that was mapped
+ * Outputs: None
+ * Return Value: int32_t 0 on success, -1 if addr doesn't start a mapping of
+ *  that many pages
+ * Side Effects: flushes the unmapped pages from the TLB, may free data blocks
+ *  of files that were written or deleted while mapped
+ */
+int32_t sys_munmap(void* addr, uint32_t length) {
+  uint32_t start = (uint32_t)addr, flags;
+  if (start < MMAP_START || start % PAGE_SIZE) return ERROR;
+  pcb_t* pcb = get_curr_pcb();
+
+  int i;
+  for (i = 0; i < MMAP_MAX_REGIONS; i++) {
+    mmap_region_t* region = &pcb->mmaps[i];
+    if (region->num_pages == 0 ||
+        region->page != (start - MMAP_START) / PAGE_SIZE)
+      continue;
+    if ((length + PAGE_SIZE - 1) / PAGE_SIZE != region->num_pages)
+      return ERROR;
+
+    cli_and_save(flags);
+    mmap_release(pcb, region);
+    restore_flags(flags);
+    return 0;
+  }
+  return ERROR;
+}
+
+/* Name: shm_release()
+ * Description: unmaps a segment from a process's shared memory area and
+ *  drops the process's references to its frames
+ * Inputs: pcb_t* pcb, shm_attach_t* attach - one of the process's
+ *  attachments
+ * Outputs: None
+ * Return Value: None
+ * Side Effects: the attachment is marked unused, the segment is removed if
+ *  it was the last one
+ */
+static void shm_release(pcb_t* pcb, shm_attach_t* attach) {
+  uint32_t i, frame;
+  if (attach->num_pages == 0) return;
+
+  for (i = 0; i < attach->num_pages; i++) {
+    frame = set_shm_page(pcb->pid, attach->page + i, 0);
+    if (frame) frame_put(frame);
+    tlb_flush_page(SHM_START + (attach->page + i) * PAGE_SIZE);
+  }
+  shm_put(attach->id);
+  attach->num_pages = 0;
+}
+
+/* Name: shm_find_overlap()
+ * Description: finds an attachment of a process that uses any of a run of
+ *  pages of its shared memory area
+ * Inputs: pcb_t* pcb, uint32_t page - first page of the run, uint32_t
+ *  num_pages - its length
+ * Outputs: None
+ * Return Value: the attachment, NULL if the pages are free
+ * Side Effects: None
+ */
+static shm_attach_t* shm_find_overlap(pcb_t* pcb, uint32_t page,
+                                      uint32_t num_pages) {
+  int i;
+  for (i = 0; i < SHM_MAX_ATTACH; i++) {
+    shm_attach_t* used = &pcb->shms[i];
+    if (used->num_pages && page < used->page + used->num_pages &&
+        used->page < page + num_pages)
+      return used;
+  }
+  return NULL;
+}
+
+/* Name: sys_shmget()
+ * Description: shmget system call, gets the shared memory segment with a
+ *  key, creating it if no program has yet. Programs that use the same key
+ *  share the segment
+ * Inputs: int32_t key - the segment's name, uint32_t size - bytes it needs
+ * Outputs: None
+ * Return Value: int32_t id of the segment for shmat, -1 if the segment is
+ *  smaller than size or there is no memory for it
+ * Side Effects: takes zeroed frames for a new segment, which is freed when
+ *  the process exits if it never attaches it
+ */
+int32_t sys_shmget(int32_t key, uint32_t size) {
+  return shm_create(key, size, get_curr_pcb()->pid);
+}
+
+/* Name: sys_shmat()
+ * Description: shmat system call, maps a shared memory segment into the
+ *  process's shared memory area at 140MB, writable. The pages are the
+ *  segment's own frames, so every process attached to it sees the writes
+ * Inputs: int32_t shmid - id from shmget, void* addr - where in the area to
+ *  map it, page aligned, or NULL for the kernel to choose
+ * Outputs: None
+ * Return Value: int32_t virtual address of the segment, -1 on failure, for
+ *  an unused id, an address outside the area, pages already in use or a
+ *  segment attached too many times to count more references to its frames
+ * Side Effects: adds pages to the process's shared memory page table, the
+ *  segment is no longer held for its creator
+ */
+int32_t sys_shmat(int32_t shmid, void* addr) {
+  uint32_t start = (uint32_t)addr, page = 0, flags, i;
+  if (start % PAGE_SIZE) return ERROR;
+  if (start &&
+      (start < SHM_START || start >= SHM_START + SHM_PAGES * PAGE_SIZE))
+    return ERROR;
+  pcb_t* pcb = get_curr_pcb();
+
+  shm_attach_t *attach = NULL, *used;
+  for (i = 0; i < SHM_MAX_ATTACH; i++)
+    if (pcb->shms[i].num_pages == 0) attach = &pcb->shms[i];
+  if (attach == NULL) return ERROR;
+
+  cli_and_save(flags);
+  int32_t num_pages = shm_get(shmid);
+  if (num_pages == ERROR) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  if (start) {
+    page = (start - SHM_START) / PAGE_SIZE;
+    if (shm_find_overlap(pcb, page, num_pages) != NULL) page = SHM_PAGES;
+  } else {  // the first pages it fits in
+    while ((used = shm_find_overlap(pcb, page, num_pages)) != NULL)
+      page = used->page + used->num_pages;
+  }
+  if (page + num_pages > SHM_PAGES || alloc_shm_table(pcb->pid) == ERROR) {
+    shm_put(shmid);
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  attach->page = page;
+  attach->id = shmid;
+  for (i = 0; i < num_pages; i++) {
+    uint32_t frame = shm_get_frame(shmid, i);
+    if (frame_get(frame) == ERROR) {  // FRAME_MAX_REFS attachments
+      // the pages mapped so far were never touched, so aren't in the TLB
+      while (i-- > 0) frame_put(set_shm_page(pcb->pid, page + i, 0));
+      shm_put(shmid);
+      restore_flags(flags);
+      return ERROR;
+    }
+    set_shm_page(pcb->pid, page + i, frame);
+  }
+  attach->num_pages = num_pages;
+  shm_disown(shmid, pcb->pid);
+  restore_flags(flags);
+
+  return SHM_START + page * PAGE_SIZE;
+}
+
+/* Name: sys_shmdt()
+ * Description: shmdt system call, unmaps a shared memory segment attached
+ *  with shmat
+ * Inputs: void* addr - the address shmat returned
+ * Outputs: None
+ * Return Value: int32_t 0 on success, -1 if addr doesn't start an attachment
+ * Side Effects: the segment is removed if this was its last attachment
+ */
+int32_t sys_shmdt(void* addr) {
+  uint32_t start = (uint32_t)addr, flags;
+  if (start < SHM_START || start % PAGE_SIZE) return ERROR;
+  pcb_t* pcb = get_curr_pcb();
+
+  int i;
+  for (i = 0; i < SHM_MAX_ATTACH; i++) {
+    shm_attach_t* attach = &pcb->shms[i];
+    if (attach->num_pages == 0 ||
+        attach->page != (start - SHM_START) / PAGE_SIZE)
+      continue;
+
+    cli_and_save(flags);
+    shm_release(pcb, attach);
+    restore_flags(flags);
+    return 0;
+  }
+  return ERROR;
+}
@@ -12,7 +12,6 @@
 
 #define MAX_CMD_LEN 32
 #define MAX_ARG_LEN 128
-#define MAX_PROCESSES 6
 #define FDT_SIZE 8
 
 #define HALT_STATUS_EXC 0x04
@@ -21,20 +20,42 @@
 
 #define PROG_LOAD_ADDR 0x08048000  // Where user program is loaded
 #define PROG_ENTRY_OFFSET 24       // Where program actually starts
+#define PROG_HEADER_SIZE 28        // ELF magic up to the entry point
 #define FOUR_MB 0x400000
 #define _128_MB 0x8000000
 #define _132_MB 0x8400000
+// Largest program, from the load address to the end of its 4MB page
+#define PROG_MAX_SIZE (_128_MB + FOUR_MB - PROG_LOAD_ADDR)
 #define FOT_READ 0
 #define FOT_WRITE 1
 #define FOT_OPEN 2
 #define FOT_CLOSE 3
+#define FOT_SEEK 4
+#define FOT_PREAD 5
+
+// Values of whence for sys_lseek
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
 
 // User level program loaded into page startign at 128MB, program block is 4MB,
 //  -4B for esp offset
 #define USER_ESP (_128_MB + FOUR_MB - 4)
 
-// Keeps tracks of which PIDs are being used
-int8_t used_pids[MAX_PROCESSES];
+// What SYS_handler_wrapper leaves at the top of the kernel stack on a system
+// call: ebp, esi, edi, ebx and eflags it saves, then the CPU's iret frame
+#define SYS_FRAME_WORDS 10
+
+// Defined in file_system.h, which may include this header first
+struct stat;
+
+// Counters for handle_user_fault
+typedef struct fault_stats {
+  uint32_t file_pages;  // pages read in from the program file
+  uint32_t zero_pages;  // bss, heap and stack pages
+  uint32_t cow_pages;   // writes to pages shared since a fork
+  uint32_t failed;      // faults that halted the program
+} fault_stats_t;
 
 int32_t sys_halt(uint8_t status);
 int32_t sys_execute(const uint8_t* command);
@@ -46,8 +67,25 @@ int32_t sys_getargs(uint8_t* buf, int32_t nbytes);
 int32_t sys_vidmap(uint8_t** screen_start);
 int32_t sys_set_handler(int32_t signum, void* handler_address);
 int32_t sys_sigreturn(void);
+int32_t sys_create(const uint8_t* filename);
+int32_t sys_delete(const uint8_t* filename);
+int32_t sys_truncate(int32_t fd, uint32_t length);
+int32_t sys_getdents(int32_t fd, void* buf, int32_t nbytes);
+int32_t sys_lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t sys_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+int32_t sys_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t sys_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t sys_sendfile(int32_t out_fd, int32_t in_fd, int32_t count);
+int32_t sys_stat(const uint8_t* filename, struct stat* stat);
+int32_t sys_fstat(int32_t fd, struct stat* stat);
+int32_t sys_mmap(int32_t fd, uint32_t length, uint32_t offset);
+int32_t sys_munmap(void* addr, uint32_t length);
+int32_t sys_fork(void);
+int32_t sys_shmget(int32_t key, uint32_t size);
+int32_t sys_shmat(int32_t shmid, void* addr);
+int32_t sys_shmdt(void* addr);
 
-void init_pid();
-int8_t get_new_pid();
+int32_t handle_user_fault(uint32_t addr, uint32_t error);
+void get_fault_stats(fault_stats_t* stats);
 
 #endif
@@ -83,13 +83,58 @@ int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes) {
   // ----- Making the shell say "BigBrainOS>" instead of "391OS>" -----
   char prompt[] = "391OS> ";
   char BBprompt[] = "\xF4 [BigBrainOS] \n\xF5 \xAF ";
-  if (!strncmp(buffer, prompt, strlen(prompt))) {
+  int32_t prompt_len = strlen(prompt);
+  if (nbytes >= prompt_len && !strncmp(buffer, prompt, prompt_len)) {
     for (i = 0; i < strlen(BBprompt); i++) putc(BBprompt[i]);
-    return strlen(BBprompt);
+    // the caller wrote its own prompt, so that is what gets counted
+    putbuf(buffer + prompt_len, nbytes - prompt_len);
+    return nbytes;
   }
   // ---------- End of BigBrainOS change ----------
 
   // print the buffer onto the screen
-  for (i = 0; i < nbytes; i++) if(buffer[i]!='\0') putc(buffer[i]);
-  return nbytes;
+  return putbuf(buffer, nbytes);
+}
+
+/* Name: terminal_readv()
+ * Description: reads one line from the terminal and scatters it across the
+ *              segments in order
+ * Inputs: fd: the file descriptor being looked at
+ *         iov: the segments to fill
+ *         iovcnt: number of segments
+ * Outputs: none
+ * Return Value: returns number of bytes read, -1 on failure
+ * Side Effects: Terminal is read from
+ */
+int32_t terminal_readv(int32_t fd, const iovec_t *iov, int32_t iovcnt) {
+  char line[BUF_SIZE];
+  int32_t i, chunk, copied = 0;
+
+  int32_t nbytes = terminal_read(fd, line, BUF_SIZE);
+  if (nbytes == ERROR) return ERROR;
+
+  for (i = 0; i < iovcnt && copied < nbytes; i++) {
+    chunk = (iov[i].len < nbytes - copied) ? iov[i].len : nbytes - copied;
+    memcpy(iov[i].base, line + copied, chunk);
+    copied += chunk;
+  }
+  return copied;
+}
+
+/* Name: terminal_writev()
+ * Description: writes every segment to the terminal in order, one
+ *              terminal_write each, so the cursor moves once per segment
+ * Inputs: fd: the file descriptor being looked at
+ *         iov: the segments to write
+ *         iovcnt: number of segments
+ * Outputs: none
+ * Return Value: returns total number of bytes written
+ * Side Effects: Terminal is written to
+ */
+int32_t terminal_writev(int32_t fd, const iovec_t *iov, int32_t iovcnt) {
+  int32_t i, written = 0;
+
+  for (i = 0; i < iovcnt; i++)
+    written += terminal_write(fd, iov[i].base, iov[i].len);
+  return written;
 }
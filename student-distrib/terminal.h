@@ -9,5 +9,7 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes);
 int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes);
 int32_t terminal_open(const uint8_t* filename);
 int32_t terminal_close(int32_t fd);
+int32_t terminal_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t terminal_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
 
 #endif
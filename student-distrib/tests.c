@@ -1,11 +1,18 @@
 #include "tests.h"
+#include "block_cache.h"
 #include "file_system.h"
+#include "frame.h"
 #include "keyboard.h"
+#include "kmalloc.h"
 #include "lib.h"
 #include "rtc.h"
+#include "shm.h"
 #include "system_calls.h"
 #include "terminal.h"
+#include "tmpfs.h"
+#include "vfs.h"
 #include "x86_desc.h"
+#include "zcache.h"
 // clang-format off
 
 #define PASS 1
@@ -13,10 +20,15 @@
 
 // For testing derefing addresses
 #define RIGHT_ADDRESS 0x400000
-#define WRONG_ADDRESS 0x1000000
+#define WRONG_ADDRESS 0x10000000  // above the RAM the kernel maps
 #define VIDEO_ADDRESS 0xB8000
 #define DIR_ENTRY_SIZE_BYTES 64
 #define FOUR_KB 4096
+#define CR4_PGE 0x80  // global pages enabled
+#define TEST_NUM_PCBS (2 * PID_HASH_SIZE + 1)  // two pids in some chains
+
+// The image mounted at the root, the file system tests run against it
+#define ROOT_FS (vfs_get_mount(VFS_ROOT_MOUNT)->fs)
 
 /* format these macros as you see fit */
 #define TEST_HEADER                                                     \
@@ -137,13 +149,13 @@ void test_sys_call() {
 // outputs the directory listing to the screen
 int test_ls() {
   dir_entry_t curr_dir;
-  int32_t i, file_size, file_type, num_dir = get_num_dir_entries();
+  int32_t i, file_size, file_type, num_dir = get_num_dir_entries(ROOT_FS);
   int8_t file_name[33], s_file_name[33], s_file_size[10], s_index[3],
       index_buf[2], file_size_buf[9];
   puts(" Index |                        File Name | Type |      Size \n");
   for (i = 0; i < num_dir; i++) {
-    if (read_dentry_by_index(i, &curr_dir) == -1) return FAIL;
-    file_size = get_file_size(curr_dir.inode_num);
+    if (read_dentry_by_index(ROOT_FS, i, &curr_dir) == -1) return FAIL;
+    file_size = get_file_size(ROOT_FS, curr_dir.inode_num);
     file_type = curr_dir.file_type;
     strncpy(file_name, curr_dir.file_name, 32);
     file_name[32] = '\0';
@@ -164,7 +176,7 @@ int test_ls() {
 int test_dir_read() {
   int8_t buf[33];
 
-  int32_t i, num_dir = get_num_dir_entries();
+  int32_t i, num_dir = get_num_dir_entries(ROOT_FS);
 
   for (i = 0; i < num_dir; i++) {
     if (dir_read(0, buf, 600) == -1) return FAIL;
@@ -284,11 +296,958 @@ int test_sys_read_write(int32_t fd) {
 
 
 /* ----- Checkpoint 4 tests ----- */
+
+// Looks up every directory entry by name and a few missing names, checking
+//  that the hash index counts each lookup as a hit or a miss
+int test_dentry_index() {
+  dir_entry_t by_index, by_name;
+  dentry_index_stats_t before, after;
+  int8_t file_name[FILE_NAME_SIZE + 1];
+  int32_t i, num_dir = get_num_dir_entries(ROOT_FS);
+
+  get_dentry_index_stats(ROOT_FS, &before);
+  for (i = 0; i < num_dir; i++) {
+    if (read_dentry_by_index(ROOT_FS, i, &by_index) == -1) return FAIL;
+    strncpy(file_name, by_index.file_name, FILE_NAME_SIZE);
+    file_name[FILE_NAME_SIZE] = '\0';
+    if (read_dentry_by_name(ROOT_FS, (uint8_t*)file_name, &by_name) == -1) return FAIL;
+    if (by_name.inode_num != by_index.inode_num) return FAIL;
+  }
+  if (read_dentry_by_name(ROOT_FS, (uint8_t*)"filedoesntexist", &by_name) != -1)
+    return FAIL;
+  if (read_dentry_by_name(ROOT_FS, (uint8_t*)"hell", &by_name) != -1) return FAIL;
+  get_dentry_index_stats(ROOT_FS, &after);
+
+  printf("hits %u extended %u misses %u filtered %u\n", after.hits,
+         after.ext_hits, after.misses, after.filtered);
+  if (after.hits + after.ext_hits - before.hits - before.ext_hits != num_dir)
+    return FAIL;
+  if (after.misses - before.misses != 2) return FAIL;
+  return PASS;
+}
+
 /* ----- Checkpoint 5 tests ----- */
 
+
+
+// Creates a file, appends to it, truncates it and deletes it, checking the
+//  contents and that every data block is returned to the free block bitmap
+int test_file_write() {
+  dir_entry_t file;
+  uint8_t buf[200];
+  int8_t text[] = "writable file system test ";
+  int32_t i, inode, len = strlen(text);
+  int32_t free_blocks = get_num_free_data_blocks(ROOT_FS);
+
+  if ((inode = file_create(ROOT_FS, (uint8_t*)"scratch.txt")) == -1) return FAIL;
+  if (file_create(ROOT_FS, (uint8_t*)"scratch.txt") != -1) return FAIL;  // duplicate
+  if (read_dentry_by_name(ROOT_FS, (uint8_t*)"scratch.txt", &file) == -1) return FAIL;
+
+  // append len bytes 200 times so the file spans two blocks
+  for (i = 0; i < 200; i++)
+    if (write_data(ROOT_FS, inode, get_file_size(ROOT_FS, inode), (uint8_t*)text, len) != len)
+      return FAIL;
+  if (get_file_size(ROOT_FS, inode) != 200 * len) return FAIL;
+  if (get_num_free_data_blocks(ROOT_FS) != free_blocks - 2) return FAIL;
+  if (read_data(ROOT_FS, inode, 199 * len, buf, 200) != len) return FAIL;
+  if (strncmp((int8_t*)buf, text, len)) return FAIL;
+
+  if (file_truncate(ROOT_FS, inode, 10) == -1) return FAIL;
+  if (get_num_free_data_blocks(ROOT_FS) != free_blocks - 1) return FAIL;
+  if (read_data(ROOT_FS, inode, 0, buf, 200) != 10) return FAIL;
+
+  if (file_delete(ROOT_FS, (uint8_t*)"scratch.txt") == -1) return FAIL;
+  if (read_dentry_by_name(ROOT_FS, (uint8_t*)"scratch.txt", &file) != -1) return FAIL;
+  if (get_num_free_data_blocks(ROOT_FS) != free_blocks) return FAIL;
+  return PASS;
+}
+
+// Fills the boot block and spills two files into the extended directory
+int test_ext_dir() {
+  dir_entry_t file;
+  uint8_t name[FILE_NAME_SIZE];
+  int32_t i, num_created, num_dir = get_num_dir_entries(ROOT_FS);
+  int32_t free_blocks = get_num_free_data_blocks(ROOT_FS);
+
+  strcpy((int8_t*)name, "ext");
+  for (num_created = 0; get_num_dir_entries(ROOT_FS) < NUM_DIR_ENTRY + 2;
+       num_created++) {
+    itoa(num_created, (int8_t*)name + 3, 10);
+    if (file_create(ROOT_FS, name) == -1) return FAIL;
+  }
+  if (file_create(ROOT_FS, name) != -1) return FAIL;  // duplicate in the extension
+
+  for (i = 0; i < num_created; i++) {
+    itoa(i, (int8_t*)name + 3, 10);
+    if (read_dentry_by_name(ROOT_FS, name, &file) == -1) return FAIL;
+  }
+  if (read_dentry_by_index(ROOT_FS, NUM_DIR_ENTRY + 1, &file) == -1) return FAIL;
+  if (read_dentry_by_index(ROOT_FS, NUM_DIR_ENTRY + 2, &file) != -1) return FAIL;
+
+  for (i = 0; i < num_created; i++) {
+    itoa(i, (int8_t*)name + 3, 10);
+    if (file_delete(ROOT_FS, name) == -1) return FAIL;
+  }
+  if (get_num_dir_entries(ROOT_FS) != num_dir) return FAIL;
+  if (get_num_free_data_blocks(ROOT_FS) != free_blocks) return FAIL;
+  return PASS;
+}
+
+// Looks files up in the root and tmpfs mounts through the dentry cache
+int test_vfs() {
+  dir_entry_t file;
+  dcache_stats_t before, after;
+  int32_t mount;
+
+  get_dcache_stats(&before);
+  if (vfs_lookup((uint8_t*)"frame0.txt", &mount, &file) == -1) return FAIL;
+  if (mount != VFS_ROOT_MOUNT) return FAIL;
+  if (vfs_lookup((uint8_t*)"frame0.txt", &mount, &file) == -1) return FAIL;
+  get_dcache_stats(&after);
+  if (after.hits == before.hits) return FAIL;  // second lookup is cached
+
+  if (sys_create((uint8_t*)"tmp/vfs") == -1) return FAIL;
+  if (vfs_lookup((uint8_t*)"tmp/vfs", &mount, &file) == -1) return FAIL;
+  if (mount == VFS_ROOT_MOUNT) return FAIL;
+  if (sys_delete((uint8_t*)"tmp/vfs") == -1) return FAIL;
+  if (vfs_lookup((uint8_t*)"tmp/vfs", &mount, &file) != -1) return FAIL;
+  return PASS;
+}
+
+// Reads frame0.txt from the disk (QEMU -hda with a copy of filesys_img) and
+// checks it against the root image, the second read hits the block cache
+int test_disk() {
+  dir_entry_t root_file, disk_file;
+  bcache_stats_t before, after;
+  uint8_t root_buf[FOUR_KB], disk_buf[FOUR_KB];
+  int32_t i, root_len, disk_len, mount;
+
+  if (vfs_lookup((uint8_t*)"frame0.txt", &mount, &root_file) == -1) return FAIL;
+  root_len = read_data(ROOT_FS, root_file.inode_num, 0, root_buf, FOUR_KB);
+  if (vfs_lookup((uint8_t*)VFS_DISK_PREFIX "frame0.txt", &mount, &disk_file) == -1) return FAIL;
+  fs_t* disk_fs = vfs_get_mount(mount)->fs;
+
+  disk_len = read_data(disk_fs, disk_file.inode_num, 0, disk_buf, FOUR_KB);
+  if (disk_len != root_len) return FAIL;
+  for (i = 0; i < disk_len; i++)
+    if (disk_buf[i] != root_buf[i]) return FAIL;
+
+  get_bcache_stats(&before);
+  if (read_data(disk_fs, disk_file.inode_num, 0, disk_buf, FOUR_KB) != disk_len) return FAIL;
+  get_bcache_stats(&after);
+  if (after.hits == before.hits || after.misses != before.misses) return FAIL;
+  printf("hits %d misses %d readahead %d readahead hits %d\n", after.hits,
+         after.misses, after.readahead, after.readahead_hits);
+
+  // the disk is mounted read only
+  if (sys_create((uint8_t*)VFS_DISK_PREFIX "new") != -1) return FAIL;
+  return PASS;
+}
+
+// Compares every file in the root image with its copy in the image at mount,
+//  skipping files the image doesn't have. With whole_runs set each file also
+//  has to be a single run of blocks
+int compare_with_root(int32_t mount, int32_t whole_runs) {
+  dir_entry_t root_file, mod_file;
+  uint8_t path[VFS_PREFIX_SIZE + FILE_NAME_SIZE + 1];
+  uint8_t root_buf[FOUR_KB], mod_buf[FOUR_KB];
+  const uint8_t* run;
+  int32_t i, j, offset, root_len, file_mount, num_dir = get_num_dir_entries(ROOT_FS);
+
+  mount_t* mnt = vfs_get_mount(mount);
+  if (mnt == NULL) return FAIL;
+
+  for (i = 0; i < num_dir; i++) {
+    if (read_dentry_by_index(ROOT_FS, i, &root_file) == -1) return FAIL;
+    if (root_file.file_type != FILE_TYPE_FILE) continue;
+
+    strcpy((int8_t*)path, mnt->prefix);
+    strncpy((int8_t*)path + mnt->prefix_len, root_file.file_name, FILE_NAME_SIZE);
+    path[mnt->prefix_len + FILE_NAME_SIZE] = '\0';
+    if (vfs_lookup(path, &file_mount, &mod_file) == -1) continue;  // not in fsdir
+
+    root_len = get_file_size(ROOT_FS, root_file.inode_num);
+    if (get_file_size(mnt->fs, mod_file.inode_num) != root_len) return FAIL;
+    if (whole_runs && root_len && get_data_run(mnt->fs, mod_file.inode_num, 0, &run) != root_len) return FAIL;
+
+    for (offset = 0; offset < root_len; offset += FOUR_KB) {
+      if (read_data(ROOT_FS, root_file.inode_num, offset, root_buf, FOUR_KB) !=
+          read_data(mnt->fs, mod_file.inode_num, offset, mod_buf, FOUR_KB))
+        return FAIL;
+      for (j = 0; j < FOUR_KB && offset + j < root_len; j++)
+        if (root_buf[j] != mod_buf[j]) return FAIL;
+    }
+  }
+  return PASS;
+}
+
+// Compares every file in the root image with its copy in "mod1/", a version
+// 2 image from mkfs loaded as the second module, where each file is one run
+int test_extent_image() {
+  mount_t* v2 = vfs_get_mount(1);
+  if (v2 == NULL || !v2->fs->extents) return FAIL;
+  return compare_with_root(1, 1);
+}
+
+// Reads every file of "mod2/", an image from mkfs -z loaded as the third
+// module, twice and compares it with the root image. The second pass should
+// be served by the cache of decompressed blocks
+int test_compressed_image() {
+  zcache_stats_t before, after;
+  int32_t pass;
+
+  mount_t* z = vfs_get_mount(2);
+  if (z == NULL || !z->fs->extents) return FAIL;
+
+  for (pass = 0; pass < 2; pass++) {
+    get_zcache_stats(&before);
+    if (compare_with_root(2, 0) == FAIL) return FAIL;
+    get_zcache_stats(&after);
+    printf("pass %d: hits %d misses %d evictions %d\n", pass,
+           after.hits - before.hits, after.misses - before.misses,
+           after.evictions - before.evictions);
+  }
+
+  // fsdir fits in the cache, so nothing is decompressed again
+  if (after.misses != before.misses) return FAIL;
+  return PASS;
+}
+
+// Finds a block that two files of "mod3/", an image from mkfs -d loaded as
+// the fourth module, share. Writing it in one file must leave the other as
+// it was and cost one new data block
+int test_shared_blocks() {
+  dir_entry_t file_a, file_b;
+  const uint8_t *run_a, *run_b;
+  uint8_t saved, changed;
+  int32_t i, j, offset, len_a, len_b, free_blocks, num_dir;
+
+  mount_t* dedup = vfs_get_mount(3);
+  if (dedup == NULL || get_num_shared_data_blocks(dedup->fs) == 0) return FAIL;
+  num_dir = get_num_dir_entries(dedup->fs);
+  printf("%d shared data blocks\n", get_num_shared_data_blocks(dedup->fs));
+
+  for (i = 0; i < num_dir; i++) {
+    if (read_dentry_by_index(dedup->fs, i, &file_a) == -1) return FAIL;
+    if (file_a.file_type != FILE_TYPE_FILE) continue;
+    len_a = get_file_size(dedup->fs, file_a.inode_num);
+
+    for (j = i + 1; j < num_dir; j++) {
+      if (read_dentry_by_index(dedup->fs, j, &file_b) == -1) return FAIL;
+      if (file_b.file_type != FILE_TYPE_FILE) continue;
+      len_b = get_file_size(dedup->fs, file_b.inode_num);
+
+      for (offset = 0; offset < len_a && offset < len_b; offset += FOUR_KB) {
+        get_data_run(dedup->fs, file_a.inode_num, offset, &run_a);
+        get_data_run(dedup->fs, file_b.inode_num, offset, &run_b);
+        if (run_a != run_b) continue;
+
+        // flip a byte of file_a, then put it back
+        saved = *run_a;
+        free_blocks = get_num_free_data_blocks(dedup->fs);
+        changed = saved ^ 1;
+        if (write_data(dedup->fs, file_a.inode_num, offset, &changed, 1) != 1)
+          return FAIL;
+        if (get_num_free_data_blocks(dedup->fs) != free_blocks - 1) return FAIL;
+        if (*run_b != saved) return FAIL;
+        if (write_data(dedup->fs, file_a.inode_num, offset, &saved, 1) != 1)
+          return FAIL;
+        return PASS;
+      }
+    }
+  }
+  return FAIL;  // no two files share a block
+}
+
+// Grows a file of "mod4/", an image from mkfs -3 with free blocks loaded as
+// the fifth module, past the single and double indirect limits, then reads
+// it back through a file descriptor. Reading on should find the block of
+// indices in the cache of the descriptor almost every time
+int test_indirect_file() {
+  static uint8_t block[FOUR_KB];
+  ind_stats_t before, after;
+  uint32_t i, j, size = (IND_LIMIT + 1) * FOUR_KB;
+  int32_t fd, inode, free_blocks;
+
+  mount_t* v3 = vfs_get_mount(4);
+  if (v3 == NULL || !v3->fs->indirect) return FAIL;
+  free_blocks = get_num_free_data_blocks(v3->fs);
+  if ((inode = file_create(v3->fs, (uint8_t*)"indirect")) == -1) return FAIL;
+
+  for (i = 0; i < size; i += FOUR_KB) {
+    for (j = 0; j < FOUR_KB; j++) block[j] = (i / FOUR_KB + j) & 0xFF;
+    if (write_data(v3->fs, inode, i, block, FOUR_KB) != FOUR_KB) return FAIL;
+  }
+  printf("%d bytes in %d blocks\n", size,
+         free_blocks - get_num_free_data_blocks(v3->fs));
+
+  get_ind_stats(v3->fs, &before);
+  if ((fd = sys_open((uint8_t*)"mod4/indirect")) == -1) return FAIL;
+  for (i = 0; i < size; i += FOUR_KB) {
+    if (sys_read(fd, block, FOUR_KB) != FOUR_KB) return FAIL;
+    for (j = 0; j < FOUR_KB; j++)
+      if (block[j] != ((i / FOUR_KB + j) & 0xFF)) return FAIL;
+  }
+  if (sys_read(fd, block, FOUR_KB) != 0 || sys_close(fd) == -1) return FAIL;
+  get_ind_stats(v3->fs, &after);
+  printf("%d hits %d misses\n", after.hits - before.hits,
+         after.misses - before.misses);
+
+  if (file_delete(v3->fs, (uint8_t*)"indirect") == -1) return FAIL;
+  if (get_num_free_data_blocks(v3->fs) != free_blocks) return FAIL;
+  return (after.misses - before.misses < 4) ? PASS : FAIL;
+}
+
+// Lists the whole directory with a single getdents call and prints it
+int test_getdents() {
+  dirent_t records[NUM_DIR_ENTRY];
+  int8_t file_name[FILE_NAME_SIZE + 1];
+  int32_t i, num_records, fd = sys_open((uint8_t*)".");
+  if (fd == -1) return FAIL;
+
+  num_records = sys_getdents(fd, records, sizeof(records)) / sizeof(dirent_t);
+  if (num_records != get_num_dir_entries(ROOT_FS)) return FAIL;
+  if (sys_getdents(fd, records, sizeof(records)) != 0) return FAIL;  // at end
+
+  for (i = 0; i < num_records; i++) {
+    strncpy(file_name, records[i].file_name, FILE_NAME_SIZE);
+    file_name[FILE_NAME_SIZE] = '\0';
+    printf("%s %d %d %d\n", file_name, records[i].file_type,
+           records[i].inode_num, records[i].file_size);
+  }
+  return (sys_close(fd) == -1) ? FAIL : PASS;
+}
+
+// Seeks around frame1.txt and checks pread against read after a seek
+int test_lseek_pread() {
+  uint8_t read_buf[32], pread_buf[32];
+  int32_t size, fd = sys_open((uint8_t*)"frame1.txt");
+  if (fd == -1) return FAIL;
+
+  size = sys_lseek(fd, 0, SEEK_END);
+  if (size != get_file_size(ROOT_FS, get_curr_pcb()->fdt[fd].inode_idx)) return FAIL;
+  if (sys_read(fd, read_buf, 32) != 0) return FAIL;  // at end of file
+  if (sys_lseek(fd, -1, SEEK_SET) != -1) return FAIL;
+
+  if (sys_lseek(fd, 100, SEEK_SET) != 100) return FAIL;
+  if (sys_read(fd, read_buf, 32) != 32) return FAIL;
+  if (sys_pread(fd, pread_buf, 32, 100) != 32) return FAIL;
+  if (strncmp((int8_t*)read_buf, (int8_t*)pread_buf, 32)) return FAIL;
+  if (sys_lseek(fd, 0, SEEK_CUR) != 132) return FAIL;  // pread didn't move
+
+  return (sys_close(fd) == -1) ? FAIL : PASS;
+}
+
+// Prints a prompt, a value and a newline with one writev, then reads
+//  frame0.txt back in two segments with one readv
+int test_readv_writev() {
+  int8_t value[] = "42";
+  uint8_t head[16], tail[32], expected[48];
+  iovec_t out[3] = {{"value: ", 7}, {value, 2}, {"\n", 1}};
+  iovec_t in[2] = {{head, 16}, {tail, 32}};
+  int32_t fd;
+
+  if (sys_writev(1, out, 3) != 10) return FAIL;
+
+  if ((fd = sys_open((uint8_t*)"frame0.txt")) == -1) return FAIL;
+  if (sys_readv(fd, in, 2) != 48) return FAIL;
+  if (sys_pread(fd, expected, 48, 0) != 48) return FAIL;
+  if (strncmp((int8_t*)head, (int8_t*)expected, 16)) return FAIL;
+  if (strncmp((int8_t*)tail, (int8_t*)expected + 16, 32)) return FAIL;
+  if (sys_readv(fd, in, 0) != -1) return FAIL;
+
+  return (sys_close(fd) == -1) ? FAIL : PASS;
+}
+
+// Sends frame0.txt to the terminal and into a new file without a user
+//  buffer, then checks the copy against the original
+int test_sendfile() {
+  uint8_t original[200], copy[200];
+  int32_t size, in_fd, out_fd;
+
+  if ((in_fd = sys_open((uint8_t*)"frame0.txt")) == -1) return FAIL;
+  size = sys_lseek(in_fd, 0, SEEK_END);
+  sys_lseek(in_fd, 0, SEEK_SET);
+  if (sys_sendfile(1, in_fd, size) != size) return FAIL;
+  if (sys_sendfile(1, in_fd, size) != 0) return FAIL;  // at end of file
+
+  if (sys_create((uint8_t*)"frame0.copy") == -1) return FAIL;
+  if ((out_fd = sys_open((uint8_t*)"frame0.copy")) == -1) return FAIL;
+  sys_lseek(in_fd, 0, SEEK_SET);
+  if (sys_sendfile(out_fd, in_fd, size) != size) return FAIL;
+
+  if (sys_pread(in_fd, original, size, 0) != size) return FAIL;
+  if (sys_pread(out_fd, copy, size, 0) != size) return FAIL;
+  if (strncmp((int8_t*)original, (int8_t*)copy, size)) return FAIL;
+
+  sys_close(out_fd);
+  sys_close(in_fd);
+  return (sys_delete((uint8_t*)"frame0.copy") == -1) ? FAIL : PASS;
+}
+
+// Stats a few files by name and by fd and checks them against the inodes
+int test_stat() {
+  stat_t by_name, by_fd;
+  int32_t fd;
+
+  if (sys_stat((uint8_t*)"fish", &by_name) == -1) return FAIL;
+  if (by_name.file_type != FILE_TYPE_FILE) return FAIL;
+  if (by_name.file_size != get_file_size(ROOT_FS, by_name.inode_num)) return FAIL;
+  if (by_name.num_blocks != (by_name.file_size + FOUR_KB - 1) / FOUR_KB)
+    return FAIL;
+  if (sys_stat((uint8_t*)"filedoesntexist", &by_name) != -1) return FAIL;
+
+  if ((fd = sys_open((uint8_t*)"fish")) == -1) return FAIL;
+  if (sys_fstat(fd, &by_fd) == -1) return FAIL;
+  if (by_fd.inode_num != by_name.inode_num) return FAIL;
+  if (by_fd.file_size != by_name.file_size) return FAIL;
+  sys_close(fd);
+
+  if (sys_stat((uint8_t*)".", &by_name) == -1) return FAIL;
+  if (by_name.file_type != FILE_TYPE_DIR) return FAIL;
+  if (sys_fstat(1, &by_fd) != -1) return FAIL;  // stdout
+  return PASS;
+}
+
+// Hands a file between two fds through the tmpfs and checks its pages are
+//  given back to the frame allocator on delete
+int test_tmpfs() {
+  int8_t text[] = "scratch data";
+  uint8_t buf[16];
+  int32_t fd, pages = get_num_tmpfs_pages();
+
+  if (sys_create((uint8_t*)"tmp/pipe") == -1) return FAIL;
+  if ((fd = sys_open((uint8_t*)"tmp/pipe")) == -1) return FAIL;
+  if (sys_write(fd, text, 12) != 12) return FAIL;
+  if (sys_read(fd, buf, 16) != 12) return FAIL;
+  if (strncmp((int8_t*)buf, text, 12)) return FAIL;
+  if (get_num_tmpfs_pages() != pages + 1) return FAIL;
+
+  if (sys_delete((uint8_t*)"tmp/pipe") != -1) return FAIL;  // still open
+  sys_close(fd);
+  if (sys_delete((uint8_t*)"tmp/pipe") == -1) return FAIL;
+  if (sys_open((uint8_t*)"tmp/pipe") != -1) return FAIL;
+  return (get_num_tmpfs_pages() == pages) ? PASS : FAIL;
+}
+
+// Maps frame1.txt and compares it with what sys_read returns, then writes
+//  the file while it is mapped. The mapping has to keep the old contents and
+//  the copied block has to be freed once it is unmapped
+int test_mmap() {
+  static uint8_t buf[FOUR_KB];
+  uint8_t* map;
+  uint8_t saved, changed;
+  int32_t fd, size, free_blocks = get_num_free_data_blocks(ROOT_FS);
+
+  if ((fd = sys_open((uint8_t*)"frame1.txt")) == -1) return FAIL;
+  size = sys_read(fd, buf, FOUR_KB);
+  if (size <= 0) return FAIL;
+  map = (uint8_t*)sys_mmap(fd, size, 0);
+  if ((int32_t)map == -1) return FAIL;
+  if (strncmp((int8_t*)map, (int8_t*)buf, size)) return FAIL;
+  if (sys_mmap(fd, size, 1) != -1) return FAIL;  // unaligned offset
+
+  saved = buf[0];
+  changed = saved ^ 1;
+  uint32_t inode = get_curr_pcb()->fdt[fd].inode_idx;
+  if (write_data(ROOT_FS, inode, 0, &changed, 1) != 1) return FAIL;
+  if (map[0] != saved) return FAIL;
+  if (write_data(ROOT_FS, inode, 0, &saved, 1) != 1) return FAIL;
+
+  if (sys_munmap(map, size) == -1 || sys_munmap(map, size) != -1) return FAIL;
+  sys_close(fd);
+  return (get_num_free_data_blocks(ROOT_FS) == free_blocks) ? PASS : FAIL;
+}
+
+// Takes a 4MB frame and a run of 4kb frames from the allocator and checks
+//  they are aligned, then frees them and checks every block merged back
+int test_frame_alloc() {
+  static uint32_t frames[FRAME_COUNT / 64];
+  frame_stats_t before, after;
+  uint32_t i, large;
+
+  get_frame_stats(&before);
+  printf("%d of %d frames free\n", before.free_frames, before.total_frames);
+  if ((large = frame_alloc(FRAME_ORDER_4MB)) == 0) return FAIL;
+  if (large % (FRAME_SIZE << FRAME_ORDER_4MB)) return FAIL;
+
+  for (i = 0; i < FRAME_COUNT / 64; i++) {
+    if ((frames[i] = frame_alloc(FRAME_ORDER_4KB)) == 0) return FAIL;
+    if (frames[i] % FRAME_SIZE || frames[i] < FRAME_MIN_ADDR) return FAIL;
+    *(uint32_t*)frames[i] = i;  // the kernel can use the frame
+  }
+  for (i = 0; i < FRAME_COUNT / 64; i++)
+    if (*(uint32_t*)frames[i] != i) return FAIL;  // no frame given twice
+
+  for (i = 0; i < FRAME_COUNT / 64; i++)
+    if (frame_free(frames[i], FRAME_ORDER_4KB) == -1) return FAIL;
+  if (frame_free(large, FRAME_ORDER_4MB) == -1) return FAIL;
+  if (frame_free(large, FRAME_ORDER_4MB) != -1) return FAIL;  // twice
+
+  get_frame_stats(&after);
+  if (after.free_frames != before.free_frames) return FAIL;
+  if (after.free_blocks[FRAME_MAX_ORDER] != before.free_blocks[FRAME_MAX_ORDER])
+    return FAIL;
+  return PASS;
+}
+
+// Allocates objects of every size class and a large block from the kernel
+//  heap and checks they don't overlap, then frees them and checks the slabs
+//  went back to the frame allocator
+int test_kmalloc() {
+  static uint8_t* objs[256];
+  kmalloc_stats_t before, after;
+  uint32_t i, j;
+  uint8_t* large;
+
+  get_kmalloc_stats(&before);
+  for (i = 0; i < 256; i++) {
+    if ((objs[i] = kmalloc(1 + i * 4)) == NULL) return FAIL;
+    memset(objs[i], i, 1 + i * 4);
+  }
+  for (i = 0; i < 256; i++)
+    for (j = 0; j < 1 + i * 4; j++)
+      if (objs[i][j] != (uint8_t)i) return FAIL;  // no overlap
+
+  if ((large = kmalloc(FRAME_SIZE * 3)) == NULL) return FAIL;
+  if ((uint32_t)large % FRAME_SIZE) return FAIL;
+  get_kmalloc_stats(&after);
+  printf("%d bytes of slabs, %d used, %d asked for\n", after.slab_bytes,
+         after.used_bytes, after.requested - before.requested);
+  if (after.large_bytes - before.large_bytes != FRAME_SIZE * 4) return FAIL;
+
+  for (i = 0; i < 256; i++) kfree(objs[i]);
+  kfree(large);
+  get_kmalloc_stats(&after);
+  if (after.used_bytes != before.used_bytes) return FAIL;
+  if (after.large_bytes != before.large_bytes) return FAIL;
+  if (after.slab_bytes > before.slab_bytes +
+                             KMALLOC_NUM_CLASSES * KMEM_MAX_EMPTY * FRAME_SIZE)
+    return FAIL;  // only the empty slabs kept for reuse
+  return PASS;
+}
+
+// Allocates more PCBs than the pid hash table has chains and checks each has
+//  its own pid and kernel stack, then frees them and checks the pids are
+//  handed out again, the last one freed first
+int test_pcb_alloc() {
+  static pcb_t* pcbs[TEST_NUM_PCBS];
+  uint32_t i, n, live = get_num_procs();
+  pcb_t* pcb;
+
+  for (n = 0; n < TEST_NUM_PCBS; n++) {
+    if ((pcbs[n] = pcb_alloc()) == NULL) return FAIL;
+    if (pcbs[n]->kstack % KSTACK_SIZE) return FAIL;
+    if (*(pcb_t**)pcbs[n]->kstack != pcbs[n]) return FAIL;
+    if (get_pcb_by_pid(pcbs[n]->pid) != pcbs[n]) return FAIL;
+  }
+  printf("%d processes running\n", get_num_procs());
+  if (get_num_procs() != live + n) return FAIL;
+
+  for (i = 0, pcb = get_live_pcbs(); pcb != NULL; pcb = pcb->next) i++;
+  if (i != live + n) return FAIL;  // every process is on the live list
+
+  for (i = 0; i < n; i++) pcb_free(pcbs[i]);
+  if (get_num_procs() != live || get_pcb_by_pid(pcbs[0]->pid) != NULL)
+    return FAIL;
+  if ((pcb = pcb_alloc()) == NULL) return FAIL;
+  if (pcb->pid != pcbs[n - 1]->pid) return FAIL;  // the last pid freed
+  pcb_free(pcb);
+  return PASS;
+}
+
+// Sets up a process for hello without loading it, then touches its first
+//  page and its stack and checks the faults read in the file and zero filled
+//  the stack, with only those two pages given frames. hello can't be
+//  truncated or deleted until the process is gone
+int test_demand_paging() {
+  static uint8_t expected[PROG_HEADER_SIZE];
+  uint8_t* text = (uint8_t*)PROG_LOAD_ADDR;
+  uint32_t* stack = (uint32_t*)USER_ESP;
+  int saved_pid = terminals[curr_process].prog_curr_pid;
+  int result = PASS;
+  fault_stats_t before, after;
+  dir_entry_t dentry;
+  stat_t exe_stat;
+  int32_t mount, i;
+  pcb_t* pcb;
+
+  if (vfs_lookup((uint8_t*)"hello", &mount, &dentry) == ERROR) return FAIL;
+  mount_t* exe_fs = vfs_get_mount(mount);
+  exe_fs->ops->stat(exe_fs->fs, dentry.file_type, dentry.inode_num, &exe_stat);
+  exe_fs->ops->read_data(exe_fs->fs, dentry.inode_num, 0, expected,
+                         PROG_HEADER_SIZE);
+  if ((pcb = pcb_alloc()) == NULL) return FAIL;
+  if (alloc_user_table(pcb->pid) == -1) {
+    pcb_free(pcb);
+    return FAIL;
+  }
+  pcb->exe_mount = mount;
+  pcb->exe_inode = dentry.inode_num;
+  pcb->exe_size = exe_stat.file_size;
+  terminals[curr_process].prog_curr_pid = pcb->pid;
+  enable_program_page(pcb->pid);
+  get_fault_stats(&before);
+
+  for (i = 0; i < PROG_HEADER_SIZE; i++)
+    if (text[i] != expected[i]) result = FAIL;
+  if (*stack != 0) result = FAIL;
+  *stack = 1;  // the page is writable
+
+  get_fault_stats(&after);
+  printf("%d of %d pages touched\n", get_num_user_pages(pcb->pid), USER_PAGES);
+  if (after.file_pages != before.file_pages + 1) result = FAIL;
+  if (after.zero_pages != before.zero_pages + 1) result = FAIL;
+  if (get_num_user_pages(pcb->pid) != 2) result = FAIL;
+
+  // the file is busy while the process runs it, a truncate to its own
+  // length changes nothing if that check is missing
+  if (exe_fs->ops->truncate(exe_fs->fs, dentry.inode_num,
+                            exe_stat.file_size) != ERROR ||
+      vfs_delete((uint8_t*)"hello") != ERROR)
+    result = FAIL;
+
+  terminals[curr_process].prog_curr_pid = saved_pid;
+  free_user_table(pcb->pid);
+  enable_program_page(saved_pid);
+  pcb_free(pcb);
+  if (exe_fs->ops->truncate(exe_fs->fs, dentry.inode_num,
+                            exe_stat.file_size) == ERROR)
+    result = FAIL;
+  return result;
+}
+
+// Gives two processes page directories and switches between them, they
+//  share every kernel entry and CR3 follows the switch
+int test_page_dirs() {
+  int saved_pid = terminals[curr_process].prog_curr_pid;
+  int result = PASS;
+  page_dir_entry_t *dir_a, *dir_b;
+  uint32_t cr3, i;
+  pcb_t *a, *b;
+
+  if ((a = pcb_alloc()) == NULL) return FAIL;
+  if ((b = pcb_alloc()) == NULL) {
+    pcb_free(a);
+    return FAIL;
+  }
+  if (alloc_user_table(a->pid) == -1 || alloc_user_table(b->pid) == -1)
+    result = FAIL;
+  dir_a = a->page_dir;
+  dir_b = b->page_dir;
+
+  if (result == PASS) {
+    // the kernel half is shared, only the program's page table differs
+    for (i = 0; i < DIR_SIZE; i++)
+      if (i != USER_PROGRAM_PD_IDX && (dir_a[i].val != page_directory[i].val ||
+                                       dir_b[i].val != page_directory[i].val))
+        result = FAIL;
+    if (dir_a[USER_PROGRAM_PD_IDX].address ==
+        dir_b[USER_PROGRAM_PD_IDX].address)
+      result = FAIL;
+
+    enable_program_page(a->pid);
+    asm volatile("movl %%cr3, %0" : "=r"(cr3));
+    if (cr3 != (uint32_t)dir_a) result = FAIL;
+    enable_program_page(b->pid);
+    asm volatile("movl %%cr3, %0" : "=r"(cr3));
+    if (cr3 != (uint32_t)dir_b) result = FAIL;
+    if (page_directory[USER_PROGRAM_PD_IDX].present) result = FAIL;
+  }
+
+  enable_program_page(saved_pid);
+  free_user_table(a->pid);
+  free_user_table(b->pid);
+  pcb_free(a);
+  pcb_free(b);
+  return result;
+}
+
+// Checks the kernel pages are global and that switching the video memory
+//  flushes its two pages alone, without a whole flush
+int test_tlb_stats() {
+  tlb_stats_t before, after;
+  uint32_t cr4;
+
+  asm volatile("movl %%cr4, %0" : "=r"(cr4));
+  if (!(cr4 & CR4_PGE)) return FAIL;
+  if (!page_directory[1].global) return FAIL;
+
+  get_tlb_stats(&before);
+  change_vidmem(curr_process);
+  change_vidmem(curr_process == curr_ter ? MAIN_VID : curr_process);
+  get_tlb_stats(&after);
+  printf("%d flushes, %d page flushes in the last second\n",
+         after.flushes_per_sec, after.page_flushes_per_sec);
+
+  if (after.flushes != before.flushes) return FAIL;
+  if (after.page_flushes != before.page_flushes + 4) return FAIL;
+  return PASS;
+}
+
+// Forks a process for hello by hand, the child shares its stack page copy on
+//  write. The child's first write copies the page, the parent's then only
+//  makes its own page writable again, and each sees its own value
+int test_fork_cow() {
+  uint32_t* stack = (uint32_t*)USER_ESP;
+  int saved_pid = terminals[curr_process].prog_curr_pid;
+  int result = PASS;
+  fault_stats_t before, after;
+  dir_entry_t dentry;
+  int32_t mount;
+  pcb_t *par, *child;
+
+  if (vfs_lookup((uint8_t*)"hello", &mount, &dentry) == ERROR) return FAIL;
+  if ((par = pcb_alloc()) == NULL) return FAIL;
+  if ((child = pcb_alloc()) == NULL) {
+    pcb_free(par);
+    return FAIL;
+  }
+  if (alloc_user_table(par->pid) == -1 || alloc_user_table(child->pid) == -1)
+    result = FAIL;
+  par->exe_mount = child->exe_mount = mount;
+  par->exe_inode = child->exe_inode = dentry.inode_num;
+  par->exe_size = child->exe_size = 0;  // only the stack is touched
+
+  if (result == PASS) {
+    terminals[curr_process].prog_curr_pid = par->pid;
+    enable_program_page(par->pid);
+    *stack = 1;
+    if (share_user_table(par->pid, child->pid) == -1) result = FAIL;
+    get_fault_stats(&before);
+
+    terminals[curr_process].prog_curr_pid = child->pid;
+    enable_program_page(child->pid);
+    if (*stack != 1) result = FAIL;
+    *stack = 2;  // copies the page
+    *stack = 3;
+
+    terminals[curr_process].prog_curr_pid = par->pid;
+    enable_program_page(par->pid);
+    if (*stack != 1) result = FAIL;
+    *stack = 4;  // the child has its own copy, so this one isn't copied
+
+    get_fault_stats(&after);
+    printf("%d pages copied\n", after.cow_pages - before.cow_pages);
+    if (after.cow_pages != before.cow_pages + 2) result = FAIL;
+    if (get_num_user_pages(par->pid) != 1) result = FAIL;
+  }
+
+  terminals[curr_process].prog_curr_pid = saved_pid;
+  enable_program_page(saved_pid);
+  free_user_table(par->pid);
+  free_user_table(child->pid);
+  pcb_free(par);
+  pcb_free(child);
+  return result;
+}
+
+// Attaches a segment twice, once where the kernel chooses and once at a
+//  chosen address, and checks a write through one shows through the other.
+//  The segment has to be gone once both are detached, and one that is never
+//  attached once its creator exits
+int test_shm() {
+  uint32_t* chosen = (uint32_t*)(SHM_START + 16 * FOUR_KB);
+  uint32_t *first, *second;
+  shm_stats_t before, after;
+  int32_t id;
+
+  get_shm_stats(&before);
+  if ((id = sys_shmget(0x5151, 2 * FOUR_KB)) == -1) return FAIL;
+  if (sys_shmget(0x5151, FOUR_KB) != id) return FAIL;  // the same segment
+  if (sys_shmget(0x5151, 3 * FOUR_KB) != -1) return FAIL;  // too large
+
+  first = (uint32_t*)sys_shmat(id, NULL);
+  if ((int32_t)first == -1) return FAIL;
+  second = (uint32_t*)sys_shmat(id, chosen);
+  if (second != chosen) return FAIL;
+  if (sys_shmat(id, chosen + 1) != -1) return FAIL;  // unaligned
+  if (sys_shmat(id, first) != -1) return FAIL;       // in use
+
+  if (first[FOUR_KB / 4] != 0) return FAIL;  // zeroed
+  first[FOUR_KB / 4] = 0xC0FFEE;
+  if (second[FOUR_KB / 4] != 0xC0FFEE) return FAIL;
+
+  if (sys_shmdt(first) == -1 || sys_shmdt(first) != -1) return FAIL;
+  if (second[FOUR_KB / 4] != 0xC0FFEE) return FAIL;  // still attached
+  if (sys_shmdt(second) == -1) return FAIL;
+
+  // a segment its creator never attaches goes when the creator exits
+  if (sys_shmget(0x5152, FOUR_KB) == -1) return FAIL;
+  shm_exit(get_curr_pcb()->pid);
+  get_shm_stats(&after);
+  return (after.segments == before.segments) ? PASS : FAIL;
+}
+
+// Deletes a file while it is open, which has to fail so the fd can't end up
+//  reading the next file to get its inode, then again once it is closed
+int test_delete_open() {
+  int8_t text[] = "still open";
+  uint8_t buf[16];
+  int32_t fd;
+
+  if (sys_create((uint8_t*)"open.txt") == -1) return FAIL;
+  if ((fd = sys_open((uint8_t*)"open.txt")) == -1) return FAIL;
+  if (sys_write(fd, text, 10) != 10) return FAIL;
+
+  if (sys_delete((uint8_t*)"open.txt") != -1) return FAIL;
+  if (sys_pread(fd, buf, 16, 0) != 10) return FAIL;
+  if (strncmp((int8_t*)buf, text, 10)) return FAIL;
+
+  sys_close(fd);
+  if (sys_delete((uint8_t*)"open.txt") == -1) return FAIL;
+  return (sys_open((uint8_t*)"open.txt") == -1) ? PASS : FAIL;
+}
+
+// Writes a tmpfs file in three segments with one writev and reads it back
+//  split differently with one readv
+int test_tmpfs_vectored() {
+  uint8_t head[4], tail[16];
+  iovec_t out[3] = {{"scratch", 7}, {"", 0}, {" data", 5}};
+  iovec_t in[2] = {{head, 4}, {tail, 16}};
+  int32_t fd, ok;
+
+  if (sys_create((uint8_t*)"tmp/vec") == -1) return FAIL;
+  if ((fd = sys_open((uint8_t*)"tmp/vec")) == -1) return FAIL;
+  ok = sys_writev(fd, out, 3) == 12 && sys_readv(fd, in, 2) == 12 &&
+       !strncmp((int8_t*)head, "scra", 4) &&
+       !strncmp((int8_t*)tail, "tch data", 8);
+
+  sys_close(fd);
+  sys_delete((uint8_t*)"tmp/vec");
+  return ok ? PASS : FAIL;
+}
+
+// Claims a version 1 file is longer than its inode can map. Runs near the
+//  last index must stop at it and offsets past it must fail instead of
+//  reading the next inode as indices
+int test_data_run_bounds() {
+  dir_entry_t file;
+  const uint8_t* run;
+  inode_t* node;
+  uint32_t len;
+  int32_t last, past;
+
+  if (ROOT_FS->extents || ROOT_FS->indirect || ROOT_FS->on_disk) return PASS;
+  if (read_dentry_by_name(ROOT_FS, (uint8_t*)"frame0.txt", &file) == -1)
+    return FAIL;
+  node = (inode_t*)(ROOT_FS->file_system_addr +
+                    (FS_INODE_START + file.inode_num) * FOUR_KB);
+
+  len = node->length_in_bytes;
+  node->length_in_bytes = (DATA_BLOCK + 4) * FOUR_KB;
+  last = get_data_run(ROOT_FS, file.inode_num, (DATA_BLOCK - 1) * FOUR_KB, &run);
+  past = get_data_run(ROOT_FS, file.inode_num, DATA_BLOCK * FOUR_KB, &run);
+  node->length_in_bytes = len;
+
+  if (last != -1 && last > FOUR_KB) return FAIL;
+  return (past == -1) ? PASS : FAIL;
+}
+
+// Lists the tmpfs directory with getdents, which goes through the tmpfs's
+//  own directory operations instead of the image's
+int test_getdents_tmpfs() {
+  dirent_t records[4];
+  int32_t fd, num_records, ok;
+
+  if (sys_create((uint8_t*)"tmp/listed") == -1) return FAIL;
+  if ((fd = sys_open((uint8_t*)"tmp/.")) == -1) return FAIL;
+  num_records = sys_getdents(fd, records, sizeof(records)) / sizeof(dirent_t);
+  ok = num_records >= 1 && sys_getdents(fd, records, sizeof(records)) == 0;
+
+  sys_close(fd);
+  sys_delete((uint8_t*)"tmp/listed");
+  return ok ? PASS : FAIL;
+}
+
+/* ----- Performance tests ----- */
+
+#define BENCH_ITERATIONS 64
+#define BENCH_BUF_SIZE 0x10000  // 64 kB, larger than any file in fsdir
+#define ONE_KB 1024
+
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+
+// Reads the low 32 bits of the time stamp counter
+static inline uint32_t read_tsc() {
+  uint32_t low, high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return low;
+}
+
+// Reads every regular file in the directory BENCH_ITERATIONS times through
+//  read_data and prints the cycles spent per kB for each one
+int test_read_data_throughput() {
+  dir_entry_t curr_dir;
+  int32_t i, j, num_dir = get_num_dir_entries(ROOT_FS);
+  uint32_t start, cycles, file_size, total_bytes = 0, total_cycles = 0;
+  int8_t file_name[FILE_NAME_SIZE + 1];
+
+  puts("File Name  Size  Cycles/kB\n");
+  for (i = 0; i < num_dir; i++) {
+    if (read_dentry_by_index(ROOT_FS, i, &curr_dir) == -1) return FAIL;
+    if (curr_dir.file_type != 2) continue;  // only regular files
+    file_size = get_file_size(ROOT_FS, curr_dir.inode_num);
+    if (file_size == 0 || file_size > BENCH_BUF_SIZE) continue;
+
+    start = read_tsc();
+    for (j = 0; j < BENCH_ITERATIONS; j++) {
+      if (read_data(ROOT_FS, curr_dir.inode_num, 0, bench_buf, BENCH_BUF_SIZE) !=
+          file_size)
+        return FAIL;
+    }
+    cycles = read_tsc() - start;
+
+    strncpy(file_name, curr_dir.file_name, FILE_NAME_SIZE);
+    file_name[FILE_NAME_SIZE] = '\0';
+    printf("%s  %u  %u\n", file_name, file_size,
+           cycles / ((file_size * BENCH_ITERATIONS) / ONE_KB + 1));
+    total_bytes += file_size * BENCH_ITERATIONS;
+    total_cycles += cycles;
+  }
+
+  printf("Total: %u bytes in %u cycles\n", total_bytes, total_cycles);
+  return PASS;
+}
+
 /* Test suite entry point */
 void launch_tests() {
 
+  /* ----- Tests for Checkpoint 4 ----- */
+
+  // TEST_OUTPUT("test_dentry_index", test_dentry_index());
+  // TEST_OUTPUT("test_file_write", test_file_write());
+  // TEST_OUTPUT("test_ext_dir", test_ext_dir());
+  // TEST_OUTPUT("test_vfs", test_vfs());
+  // TEST_OUTPUT("test_disk", test_disk());
+  // TEST_OUTPUT("test_extent_image", test_extent_image());
+  // TEST_OUTPUT("test_compressed_image", test_compressed_image());
+  // TEST_OUTPUT("test_shared_blocks", test_shared_blocks());
+  // TEST_OUTPUT("test_indirect_file", test_indirect_file());
+  // TEST_OUTPUT("test_getdents", test_getdents());
+  // TEST_OUTPUT("test_lseek_pread", test_lseek_pread());
+  // TEST_OUTPUT("test_readv_writev", test_readv_writev());
+  // TEST_OUTPUT("test_sendfile", test_sendfile());
+  // TEST_OUTPUT("test_stat", test_stat());
+  // TEST_OUTPUT("test_tmpfs", test_tmpfs());
+  // TEST_OUTPUT("test_mmap", test_mmap());
+  // TEST_OUTPUT("test_frame_alloc", test_frame_alloc());
+  // TEST_OUTPUT("test_kmalloc", test_kmalloc());
+  // TEST_OUTPUT("test_pcb_alloc", test_pcb_alloc());
+  // TEST_OUTPUT("test_demand_paging", test_demand_paging());
+  // TEST_OUTPUT("test_page_dirs", test_page_dirs());
+  // TEST_OUTPUT("test_tlb_stats", test_tlb_stats());
+  // TEST_OUTPUT("test_fork_cow", test_fork_cow());
+  // TEST_OUTPUT("test_shm", test_shm());
+  // TEST_OUTPUT("test_delete_open", test_delete_open());
+  // TEST_OUTPUT("test_tmpfs_vectored", test_tmpfs_vectored());
+  // TEST_OUTPUT("test_data_run_bounds", test_data_run_bounds());
+  // TEST_OUTPUT("test_getdents_tmpfs", test_getdents_tmpfs());
+
+  /* ----- Performance tests ----- */
+
+  // TEST_OUTPUT("test_read_data_throughput", test_read_data_throughput());
+
   /* ----- Tests for Checkpoint 3 ----- */
 
   // -- Check sys call handlers --
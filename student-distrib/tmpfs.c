@@ -0,0 +1,611 @@
+#include "tmpfs.h"
+
+// Global Variables
+tmpfs_file_t* tmpfs_files[TMPFS_MAX_FILES];  // NULL where there is no file
+static kmem_cache_t* tmpfs_file_cache;
+
+// open addressed hash table of tmpfs_files indices, keyed by file name
+int8_t tmpfs_hash_table[TMPFS_HASH_SIZE];
+
+// pages the files hold, each a frame from the frame allocator
+int32_t num_tmpfs_pages = 0;
+
+/* Name: tmpfs_init()
+ * Description: empties the tmpfs, call after kmalloc_init
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: tmpfs is initialized, files from before are dropped
+ */
+void tmpfs_init() {
+  memset(tmpfs_files, 0, sizeof(tmpfs_files));
+  tmpfs_file_cache = kmem_cache_create("tmpfs_file", sizeof(tmpfs_file_t));
+  memset(tmpfs_hash_table, TMPFS_SLOT_EMPTY, sizeof(tmpfs_hash_table));
+  num_tmpfs_pages = 0;
+}
+
+/* Name: tmpfs_alloc_page()
+ * Description: takes a zeroed frame for a page of a file
+ * Inputs: none
+ * Outputs: none
+ * Return Value: pointer to the page, NULL if there is no free frame
+ * Side Effects: none
+ */
+static uint8_t* tmpfs_alloc_page() {
+  uint8_t* page = (uint8_t*)frame_alloc(FRAME_ORDER_4KB);
+  if (page == NULL) return NULL;
+  memset(page, 0, TMPFS_PAGE_SIZE);
+  num_tmpfs_pages++;
+  return page;
+}
+
+/* Name: tmpfs_free_page()
+ * Description: gives a page's frame back to the frame allocator
+ * Inputs: page: the page to free
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void tmpfs_free_page(uint8_t* page) {
+  frame_free((uint32_t)page, FRAME_ORDER_4KB);
+  num_tmpfs_pages--;
+}
+
+/* Name: tmpfs_find_slot()
+ * Description: probes the hash table for a file name
+ * Inputs: fname: the name of the file
+ * Outputs: none
+ * Return Value: the slot holding the file, -1 if it doesn't exist
+ * Side Effects: none
+ */
+static int32_t tmpfs_find_slot(const uint8_t* fname) {
+  uint32_t slot = dentry_name_hash(fname) & TMPFS_HASH_MASK;
+  int32_t i, probes;
+
+  // deleted slots keep the chain going, empty ones end it
+  for (probes = 0; probes < TMPFS_HASH_SIZE; probes++) {
+    i = tmpfs_hash_table[slot];
+    if (i == TMPFS_SLOT_EMPTY) break;
+    if (i != TMPFS_SLOT_DELETED &&
+        !strncmp((int8_t*)fname, tmpfs_files[i]->file_name, FILE_NAME_SIZE))
+      return slot;
+    slot = (slot + 1) & TMPFS_HASH_MASK;
+  }
+  return ERROR;
+}
+
+/* Name: tmpfs_lookup()
+ * Description: finds a tmpfs file by name
+ * Inputs: fname: the name inside the tmpfs, without the mount point
+ * Outputs: none
+ * Return Value: index of the file in tmpfs_files, -1 if it doesn't exist
+ * Side Effects: none
+ */
+int32_t tmpfs_lookup(const uint8_t* fname) {
+  if (strlen((int8_t*)fname) > FILE_NAME_SIZE) return ERROR;
+
+  int32_t slot = tmpfs_find_slot(fname);
+  if (slot == ERROR) return ERROR;
+  return tmpfs_hash_table[slot];
+}
+
+/* Name: tmpfs_read_dentry()
+ * Description: fills in a directory entry for a tmpfs file, the file's index
+ *              is used as its inode, or for the directory
+ * Inputs: fs: unused, there is only one tmpfs
+ *         fname: the name of the file, dentry: where to write the entry
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the file doesn't exist
+ * Side Effects: none
+ */
+int32_t tmpfs_read_dentry(fs_t* fs, const uint8_t* fname,
+                          dir_entry_t* dentry) {
+  memset(dentry, 0, DIR_ENTRY_SIZE_BYTES);
+  if (!strncmp((int8_t*)fname, TMPFS_DIR_NAME, FILE_NAME_SIZE)) {
+    strcpy(dentry->file_name, TMPFS_DIR_NAME);
+    dentry->file_type = FILE_TYPE_DIR;
+    return 0;
+  }
+
+  int32_t i = tmpfs_lookup(fname);
+  if (i == ERROR) return ERROR;
+
+  strncpy(dentry->file_name, tmpfs_files[i]->file_name, FILE_NAME_SIZE);
+  dentry->file_type = FILE_TYPE_FILE;
+  dentry->inode_num = i;
+  return 0;
+}
+
+/* Name: tmpfs_create()
+ * Description: creates an empty file in the tmpfs
+ * Inputs: fs: unused, there is only one tmpfs
+ *         fname: the name of the new file
+ * Outputs: none
+ * Return Value: index of the new file, -1 on failure
+ * Side Effects: adds the file to the hash table
+ */
+int32_t tmpfs_create(fs_t* fs, const uint8_t* fname) {
+  uint32_t len = strlen((int8_t*)fname);
+  if (len == 0 || len > FILE_NAME_SIZE) return ERROR;
+  if (!strncmp((int8_t*)fname, TMPFS_DIR_NAME, FILE_NAME_SIZE)) return ERROR;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  int32_t i;
+  if (tmpfs_find_slot(fname) != ERROR) i = TMPFS_MAX_FILES;  // name taken
+  else
+    for (i = 0; i < TMPFS_MAX_FILES && tmpfs_files[i] != NULL; i++)
+      ;
+  if (i == TMPFS_MAX_FILES ||
+      (tmpfs_files[i] = kmem_cache_alloc(tmpfs_file_cache)) == NULL) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  memset(tmpfs_files[i], 0, sizeof(tmpfs_file_t));
+  strncpy(tmpfs_files[i]->file_name, (int8_t*)fname, FILE_NAME_SIZE);
+
+  // reuse the first empty or deleted slot in the chain
+  uint32_t slot = dentry_name_hash(fname) & TMPFS_HASH_MASK;
+  while (tmpfs_hash_table[slot] >= 0) slot = (slot + 1) & TMPFS_HASH_MASK;
+  tmpfs_hash_table[slot] = i;
+
+  restore_flags(flags);
+  return i;
+}
+
+/* Name: tmpfs_delete()
+ * Description: deletes a tmpfs file and frees its pages
+ * Inputs: fs: unused, there is only one tmpfs
+ *         fname: the name of the file
+ * Outputs: none
+ * Return Value: 0 on success, -1 if it doesn't exist, is open or a process
+ *               runs it
+ * Side Effects: removes the file from the hash table
+ */
+int32_t tmpfs_delete(fs_t* fs, const uint8_t* fname) {
+  if (strlen((int8_t*)fname) > FILE_NAME_SIZE) return ERROR;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  int32_t slot = tmpfs_find_slot(fname);
+  if (slot == ERROR || tmpfs_files[(int)tmpfs_hash_table[slot]]->open_count ||
+      file_is_running(NULL, tmpfs_hash_table[slot])) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  int32_t i = tmpfs_hash_table[slot];
+  tmpfs_truncate(fs, i, 0);
+  kmem_cache_free(tmpfs_file_cache, tmpfs_files[i]);
+  tmpfs_files[i] = NULL;
+  tmpfs_hash_table[slot] = TMPFS_SLOT_DELETED;
+
+  restore_flags(flags);
+  return 0;
+}
+
+/* Name: tmpfs_truncate()
+ * Description: sets a tmpfs file's length, freeing pages past the new end or
+ *              adding zeroed pages up to it
+ * Inputs: fs: unused, there is only one tmpfs
+ *         file_idx: the file, length: the new length
+ * Outputs: none
+ * Return Value: 0 on success, -1 on failure or if a process runs the file
+ * Side Effects: frames are taken or freed
+ */
+int32_t tmpfs_truncate(fs_t* fs, uint32_t file_idx, uint32_t length) {
+  if (file_idx >= TMPFS_MAX_FILES || tmpfs_files[file_idx] == NULL)
+    return ERROR;
+  if (length > TMPFS_MAX_FILE_PAGES * TMPFS_PAGE_SIZE) return ERROR;
+  tmpfs_file_t* file = tmpfs_files[file_idx];
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  // a running program's pages are still read in from its file
+  if (file_is_running(NULL, file_idx)) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  uint32_t new_pages = (length + TMPFS_PAGE_SIZE - 1) / TMPFS_PAGE_SIZE;
+  while (file->num_pages > new_pages)
+    tmpfs_free_page(file->pages[--file->num_pages]);
+
+  // zero the rest of the old last page, new pages come zeroed
+  if (length > file->length_in_bytes &&
+      file->length_in_bytes % TMPFS_PAGE_SIZE)
+    memset(file->pages[file->num_pages - 1] +
+               file->length_in_bytes % TMPFS_PAGE_SIZE,
+           0, TMPFS_PAGE_SIZE - file->length_in_bytes % TMPFS_PAGE_SIZE);
+
+  while (file->num_pages < new_pages) {
+    uint8_t* page = tmpfs_alloc_page();
+    if (page == NULL) {
+      file->length_in_bytes = file->num_pages * TMPFS_PAGE_SIZE;
+      restore_flags(flags);
+      return ERROR;  // no free frame
+    }
+    file->pages[file->num_pages++] = page;
+  }
+
+  file->length_in_bytes = length;
+  restore_flags(flags);
+  return 0;
+}
+
+/* Name: tmpfs_stat()
+ * Description: fills in a tmpfs file's metadata
+ * Inputs: fs: unused, there is only one tmpfs
+ *         file_type: FILE_TYPE_DIR for the directory, else a regular file
+ *         file_idx: the file, stat: where to write the metadata
+ * Outputs: none
+ * Return Value: 0 on success, -1 on a bad file
+ * Side Effects: none
+ */
+int32_t tmpfs_stat(fs_t* fs, uint32_t file_type, uint32_t file_idx,
+                   stat_t* stat) {
+  if (file_type == FILE_TYPE_DIR) {
+    memset(stat, 0, sizeof(stat_t));
+    stat->file_type = FILE_TYPE_DIR;
+    return 0;
+  }
+  if (file_idx >= TMPFS_MAX_FILES || tmpfs_files[file_idx] == NULL)
+    return ERROR;
+  stat->file_type = FILE_TYPE_FILE;
+  stat->inode_num = file_idx;
+  stat->file_size = tmpfs_files[file_idx]->length_in_bytes;
+  stat->num_blocks = tmpfs_files[file_idx]->num_pages;
+  return 0;
+}
+
+/* Name: tmpfs_read_data()
+ * Description: copies data out of a tmpfs file, one page at a time
+ * Inputs: fs: unused, there is only one tmpfs
+ *         file_idx: the file, offset: where to start reading, buf: the buffer
+ *         for the data, length: how much to read
+ * Outputs: none
+ * Return Value: the number of bytes written to buffer, -1 on a bad file
+ * Side Effects: none
+ */
+int32_t tmpfs_read_data(fs_t* fs, uint32_t file_idx, uint32_t offset,
+                        uint8_t* buf, uint32_t length) {
+  if (file_idx >= TMPFS_MAX_FILES || tmpfs_files[file_idx] == NULL)
+    return ERROR;
+  tmpfs_file_t* file = tmpfs_files[file_idx];
+
+  // clamp the request to the end of the file
+  if (offset >= file->length_in_bytes) return 0;
+  if (length > file->length_in_bytes - offset)
+    length = file->length_in_bytes - offset;
+
+  uint32_t chunk, num_bytes_read = 0;
+  while (num_bytes_read < length) {
+    uint32_t page_offset = (offset + num_bytes_read) % TMPFS_PAGE_SIZE;
+    chunk = TMPFS_PAGE_SIZE - page_offset;
+    if (chunk > length - num_bytes_read) chunk = length - num_bytes_read;
+
+    memcpy(buf + num_bytes_read,
+           file->pages[(offset + num_bytes_read) / TMPFS_PAGE_SIZE] +
+               page_offset,
+           chunk);
+    num_bytes_read += chunk;
+  }
+  return num_bytes_read;
+}
+
+/* Name: tmpfs_write_data()
+ * Description: copies data into a tmpfs file, growing it as needed
+ * Inputs: file_idx: the file, offset: where to start writing, buf: the data,
+ *         length: how much to write
+ * Outputs: none
+ * Return Value: the number of bytes written, -1 if nothing could be written
+ *               or a process runs the file
+ * Side Effects: pages are taken from the frame allocator as the file grows
+ */
+int32_t tmpfs_write_data(uint32_t file_idx, uint32_t offset,
+                         const uint8_t* buf, uint32_t length) {
+  if (file_idx >= TMPFS_MAX_FILES || tmpfs_files[file_idx] == NULL)
+    return ERROR;
+  tmpfs_file_t* file = tmpfs_files[file_idx];
+  uint32_t max_len = TMPFS_MAX_FILE_PAGES * TMPFS_PAGE_SIZE;
+
+  if (offset > max_len) return ERROR;
+  if (length > max_len - offset) length = max_len - offset;
+  if (length == 0) return 0;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  // a running program's pages are still read in from its file
+  if (file_is_running(NULL, file_idx)) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  // grow the file first, a partial grow still lets part of the data in
+  if (offset + length > file->length_in_bytes &&
+      tmpfs_truncate(NULL, file_idx, offset + length) == ERROR) {
+    if (file->length_in_bytes <= offset) {
+      restore_flags(flags);
+      return ERROR;  // no free frame
+    }
+    length = file->length_in_bytes - offset;
+  }
+
+  uint32_t chunk, num_bytes_written = 0;
+  while (num_bytes_written < length) {
+    uint32_t page_offset = (offset + num_bytes_written) % TMPFS_PAGE_SIZE;
+    chunk = TMPFS_PAGE_SIZE - page_offset;
+    if (chunk > length - num_bytes_written) chunk = length - num_bytes_written;
+
+    memcpy(file->pages[(offset + num_bytes_written) / TMPFS_PAGE_SIZE] +
+               page_offset,
+           buf + num_bytes_written, chunk);
+    num_bytes_written += chunk;
+  }
+
+  restore_flags(flags);
+  return num_bytes_written;
+}
+
+/* Name: get_num_tmpfs_pages()
+ * Description: gets the number of pages the tmpfs files hold
+ * Inputs: none
+ * Outputs: none
+ * Return Value: the number of pages
+ * Side Effects: none
+ */
+int32_t get_num_tmpfs_pages() { return num_tmpfs_pages; }
+
+/* Name: tmpfs_open()
+ * Description: opens a tmpfs file, it can't be deleted until it is closed
+ * Inputs: filename: name of the file inside the tmpfs
+ * Outputs: none
+ * Return Value: 0 on success, -1 if it doesn't exist
+ * Side Effects: increments the file's open count
+ */
+int32_t tmpfs_open(const uint8_t* filename) {
+  int32_t i = tmpfs_lookup(filename);
+  if (i == ERROR) return ERROR;
+  tmpfs_files[i]->open_count++;
+  return 0;
+}
+
+/* Name: tmpfs_close()
+ * Description: closes a tmpfs file
+ * Inputs: fd: the file descriptor
+ * Outputs: none
+ * Return Value: 0 on success
+ * Side Effects: decrements the file's open count
+ */
+int32_t tmpfs_close(int32_t fd) {
+  uint32_t i = get_curr_pcb()->fdt[fd].inode_idx;
+  if (i < TMPFS_MAX_FILES && tmpfs_files[i]->open_count)
+    tmpfs_files[i]->open_count--;
+  return 0;
+}
+
+/* Name: tmpfs_dup()
+ * Description: counts another fd open on a tmpfs file, for the copy of a
+ *              parent's fd a forked process gets
+ * Inputs: file_idx: the file's index, from the fd
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: increments the file's open count
+ */
+void tmpfs_dup(uint32_t file_idx) {
+  if (file_idx < TMPFS_MAX_FILES && tmpfs_files[file_idx] != NULL)
+    tmpfs_files[file_idx]->open_count++;
+}
+
+/* Name: tmpfs_read()
+ * Description: reads a tmpfs file from the file position
+ * Inputs: fd: the file descriptor, buf: the buffer for the data,
+ *         nbytes: the number of bytes to be read
+ * Outputs: none
+ * Return Value: number of bytes written to buffer, -1 on failure
+ * Side Effects: advances the file position
+ */
+int32_t tmpfs_read(int32_t fd, void* buf, int32_t nbytes) {
+  if (nbytes < 0) return ERROR;
+  pcb_t* file_pcb = get_curr_pcb();
+  int32_t rd = tmpfs_read_data(NULL, file_pcb->fdt[fd].inode_idx,
+                               file_pcb->fdt[fd].file_position, (uint8_t*)buf,
+                               (uint32_t)nbytes);
+  if (rd != ERROR) file_pcb->fdt[fd].file_position += rd;
+  return rd;
+}
+
+/* Name: tmpfs_write()
+ * Description: appends to the end of a tmpfs file, like file_write
+ * Inputs: fd: the file descriptor, buf: the data to append,
+ *         nbytes: the number of bytes to be written
+ * Outputs: none
+ * Return Value: number of bytes written, -1 on failure
+ * Side Effects: takes frames as the file grows
+ */
+int32_t tmpfs_write(int32_t fd, const void* buf, int32_t nbytes) {
+  if (nbytes < 0) return ERROR;
+  uint32_t i = get_curr_pcb()->fdt[fd].inode_idx;
+  if (i >= TMPFS_MAX_FILES) return ERROR;
+  return tmpfs_write_data(i, tmpfs_files[i]->length_in_bytes,
+                          (const uint8_t*)buf, (uint32_t)nbytes);
+}
+
+/* Name: tmpfs_seek()
+ * Description: moves the file position of a tmpfs file
+ * Inputs: fd: the file descriptor, offset: the new position relative to
+ *         whence, whence: SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Return Value: the new position, -1 on failure
+ * Side Effects: updates the file position in the pcb
+ */
+int32_t tmpfs_seek(int32_t fd, int32_t offset, int32_t whence) {
+  pcb_t* file_pcb = get_curr_pcb();
+  uint32_t i = file_pcb->fdt[fd].inode_idx;
+  if (i >= TMPFS_MAX_FILES) return ERROR;
+
+  int32_t pos = seek_position(file_pcb->fdt[fd].file_position,
+                              tmpfs_files[i]->length_in_bytes, offset, whence);
+  if (pos == ERROR) return ERROR;
+
+  file_pcb->fdt[fd].file_position = pos;
+  return pos;
+}
+
+/* Name: tmpfs_pread()
+ * Description: reads a tmpfs file at an offset without moving the position
+ * Inputs: fd: the file descriptor, buf: the buffer for the data,
+ *         nbytes: the number of bytes to be read, offset: where to start
+ * Outputs: none
+ * Return Value: number of bytes written to buffer, -1 on failure
+ * Side Effects: none
+ */
+int32_t tmpfs_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset) {
+  if (nbytes < 0) return ERROR;
+  return tmpfs_read_data(NULL, get_curr_pcb()->fdt[fd].inode_idx, offset,
+                         (uint8_t*)buf, (uint32_t)nbytes);
+}
+
+/* Name: tmpfs_readv()
+ * Description: reads the file into each segment in turn starting at the file
+ *              position, stopping early at the end of the file. Each segment
+ *              is read like a read call
+ * Inputs: fd: the file descriptor
+ *         iov: the segments to fill
+ *         iovcnt: number of segments
+ * Outputs: none
+ * Return Value: total number of bytes read, -1 if the first segment fails
+ * Side Effects: advances the file position
+ */
+int32_t tmpfs_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  int32_t i, len, rd, total = 0;
+
+  for (i = 0; i < iovcnt; i++) {
+    len = iov[i].len;
+    rd = tmpfs_read(fd, iov[i].base, len);
+    if (rd == ERROR) return total ? total : ERROR;
+    total += rd;
+    if (rd < len) break;  // end of file
+  }
+  return total;
+}
+
+/* Name: tmpfs_writev()
+ * Description: appends every segment to the end of the file in order, each
+ *              like a write call
+ * Inputs: fd: the file descriptor
+ *         iov: the segments to write
+ *         iovcnt: number of segments
+ * Outputs: none
+ * Return Value: total number of bytes written, -1 if nothing could be
+ *               written, like tmpfs_write
+ * Side Effects: takes frames as the file grows
+ */
+int32_t tmpfs_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+  int32_t i, len, wr, total = 0;
+
+  for (i = 0; i < iovcnt; i++) {
+    len = iov[i].len;
+    if (len == 0) continue;
+    wr = tmpfs_write(fd, iov[i].base, len);
+    if (wr == ERROR) return total ? total : ERROR;  // out of frames
+    total += wr;
+    if (wr < len) break;
+  }
+  return total;
+}
+
+/* Name: tmpfs_next_file()
+ * Description: finds the first file at or after a directory position, the
+ *              position of a file is its index in tmpfs_files
+ * Inputs: pos: the directory position
+ * Outputs: none
+ * Return Value: index of the file, TMPFS_MAX_FILES if there are no more
+ * Side Effects: none
+ */
+static uint32_t tmpfs_next_file(uint32_t pos) {
+  while (pos < TMPFS_MAX_FILES && tmpfs_files[pos] == NULL) pos++;
+  return pos;
+}
+
+/* Name: tmpfs_dir_read()
+ * Description: reads the name of the next file in the tmpfs directory
+ * Inputs: fd: the directory descriptor
+ *         buf: where the name is copied, nbytes: unused like dir_read
+ * Outputs: none
+ * Return Value: length of the name, 0 at the end of the directory
+ * Side Effects: advances the directory position past the file
+ */
+int32_t tmpfs_dir_read(int32_t fd, void* buf, int32_t nbytes) {
+  pcb_t* pcb = get_curr_pcb();
+  uint32_t i = tmpfs_next_file(pcb->fdt[fd].file_position);
+  if (i == TMPFS_MAX_FILES) return 0;
+
+  int8_t* file_name = tmpfs_files[i]->file_name;
+  strncpy((int8_t*)buf, file_name, FILE_NAME_SIZE);
+  pcb->fdt[fd].file_position = i + 1;
+
+  // names that fill the field have no null
+  int32_t len = 0;
+  while (len < FILE_NAME_SIZE && file_name[len] != '\0') len++;
+  return len;
+}
+
+/* Name: tmpfs_dir_seek()
+ * Description: moves the tmpfs directory position, which counts slots of
+ *              tmpfs_files, empty ones included
+ * Inputs: fd: the directory descriptor
+ *         offset: the new position relative to whence
+ *         whence: SEEK_SET, SEEK_CUR or SEEK_END
+ * Outputs: none
+ * Return Value: the new position, -1 on failure
+ * Side Effects: updates the directory position in the pcb
+ */
+int32_t tmpfs_dir_seek(int32_t fd, int32_t offset, int32_t whence) {
+  pcb_t* pcb = get_curr_pcb();
+  int32_t pos = seek_position(pcb->fdt[fd].file_position, TMPFS_MAX_FILES,
+                              offset, whence);
+  if (pos == ERROR) return ERROR;
+
+  pcb->fdt[fd].file_position = pos;
+  return pos;
+}
+
+/* Name: tmpfs_getdents()
+ * Description: reads as many tmpfs files as fit in the buffer in one call,
+ *              packed as dirent_t records
+ * Inputs: fd: the directory descriptor
+ *         buf: where the records are written
+ *         nbytes: the size of buf in bytes
+ * Outputs: none
+ * Return Value: number of bytes written to buf, 0 at the end of the
+ *               directory, -1 if buf can't hold a single record
+ * Side Effects: advances the directory position past the files read
+ */
+int32_t tmpfs_getdents(int32_t fd, void* buf, int32_t nbytes) {
+  if (nbytes < (int32_t)sizeof(dirent_t)) return ERROR;
+
+  pcb_t* pcb = get_curr_pcb();
+  dirent_t* records = (dirent_t*)buf;
+  uint32_t max_records = nbytes / sizeof(dirent_t);
+  uint32_t i = pcb->fdt[fd].file_position;
+  uint32_t count = 0;
+
+  while (count < max_records && (i = tmpfs_next_file(i)) < TMPFS_MAX_FILES) {
+    memcpy(records[count].file_name, tmpfs_files[i]->file_name,
+           FILE_NAME_SIZE);
+    records[count].file_type = FILE_TYPE_FILE;
+    records[count].inode_num = i;
+    records[count].file_size = tmpfs_files[i]->length_in_bytes;
+    count++;
+    i++;
+  }
+
+  pcb->fdt[fd].file_position = i;
+  return count * sizeof(dirent_t);
+}
@@ -0,0 +1,68 @@
+#ifndef _TMPFS_H
+#define _TMPFS_H
+
+#include "file_system.h"
+#include "kmalloc.h"
+#include "lib.h"
+#include "pcb.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// Mount point of the tmpfs
+#define TMPFS_PREFIX "tmp/"
+// The tmpfs's one directory, listing every file
+#define TMPFS_DIR_NAME "."
+
+#define TMPFS_MAX_FILES 64
+#define TMPFS_PAGE_SIZE 4096
+#define TMPFS_MAX_FILE_PAGES 128      // 512 kB a file, only RAM bounds the
+                                      // pages of all of them
+#define TMPFS_HASH_SIZE 128           // twice TMPFS_MAX_FILES
+#define TMPFS_HASH_MASK (TMPFS_HASH_SIZE - 1)
+#define TMPFS_SLOT_EMPTY (-1)
+#define TMPFS_SLOT_DELETED (-2)
+
+/* --- Local Types --- */
+
+// A file in the tmpfs, allocated from a slab cache when it is created. Its
+// data lives in frames from the frame allocator
+typedef struct tmpfs_file {
+  char file_name[FILE_NAME_SIZE];
+  uint32_t length_in_bytes;
+  uint32_t num_pages;
+  uint32_t open_count;  // open fds, the file can't be deleted while open
+  uint8_t* pages[TMPFS_MAX_FILE_PAGES];
+} tmpfs_file_t;
+
+/* --- Function Prototypes --- */
+
+void tmpfs_init();
+int32_t tmpfs_lookup(const uint8_t* fname);
+int32_t tmpfs_read_dentry(fs_t* fs, const uint8_t* fname,
+                          dir_entry_t* dentry);
+int32_t tmpfs_create(fs_t* fs, const uint8_t* fname);
+int32_t tmpfs_delete(fs_t* fs, const uint8_t* fname);
+int32_t tmpfs_truncate(fs_t* fs, uint32_t file_idx, uint32_t length);
+int32_t tmpfs_stat(fs_t* fs, uint32_t file_type, uint32_t file_idx,
+                   stat_t* stat);
+int32_t tmpfs_read_data(fs_t* fs, uint32_t file_idx, uint32_t offset,
+                        uint8_t* buf, uint32_t length);
+int32_t tmpfs_write_data(uint32_t file_idx, uint32_t offset,
+                         const uint8_t* buf, uint32_t length);
+int32_t get_num_tmpfs_pages();
+
+int32_t tmpfs_open(const uint8_t* filename);
+int32_t tmpfs_close(int32_t fd);
+void tmpfs_dup(uint32_t file_idx);
+int32_t tmpfs_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t tmpfs_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t tmpfs_seek(int32_t fd, int32_t offset, int32_t whence);
+int32_t tmpfs_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+int32_t tmpfs_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t tmpfs_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t tmpfs_dir_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t tmpfs_dir_seek(int32_t fd, int32_t offset, int32_t whence);
+int32_t tmpfs_getdents(int32_t fd, void* buf, int32_t nbytes);
+
+#endif
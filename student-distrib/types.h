@@ -22,6 +22,19 @@ typedef unsigned short uint16_t;
 typedef char int8_t;
 typedef unsigned char uint8_t;
 
+/* One buffer segment for readv and writev */
+typedef struct iovec {
+    void* base;
+    int32_t len;
+} iovec_t;
+
+/* Indirect block of a file that read_data used last, kept per open file */
+typedef struct ind_cache {
+    uint32_t gen;    /* generation of the image's tables, 0 if empty */
+    uint32_t first;  /* index in the file of the block table[0] maps */
+    uint32_t block;  /* data block holding the table */
+} ind_cache_t;
+
 #endif /* ASM */
 
 #endif /* _TYPES_H */
@@ -0,0 +1,271 @@
+#include "vfs.h"
+
+#include "tmpfs.h"
+#include "zcache.h"
+
+// Operations for each kind of file system
+vfs_ops_t image_ops = {read_dentry_by_name, file_create,   file_delete,
+                       file_truncate,       get_file_stat, read_data,
+                       dir_getdents};
+vfs_ops_t tmpfs_ops = {tmpfs_read_dentry, tmpfs_create, tmpfs_delete,
+                       tmpfs_truncate,    tmpfs_stat,   tmpfs_read_data,
+                       tmpfs_getdents};
+
+// Global Variables
+mount_t mounts[VFS_MAX_MOUNTS];
+// state of the image behind each mount, used when the mount has an image
+fs_t mount_images[VFS_MAX_MOUNTS];
+
+dcache_entry_t dcache[DCACHE_SIZE];
+dcache_stats_t dcache_stats;
+
+/* Name: vfs_init()
+ * Description: empties the mount table, the dentry cache and the cache of
+ *              decompressed blocks
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: every mount is removed
+ */
+void vfs_init() {
+  memset(mounts, 0, sizeof(mounts));
+  memset(dcache, 0, sizeof(dcache));
+  memset(&dcache_stats, 0, sizeof(dcache_stats));
+  zcache_init();
+}
+
+/* Name: vfs_mount()
+ * Description: adds a file system to the mount table
+ * Inputs: prefix: the mount point, paths starting with it are looked up in
+ *         the file system, "" for the root
+ *         fs: the image, NULL if the file system isn't an image
+ *         ops: the file system's operations
+ *         file_fot, dir_fot: fd operations for its files and its directory
+ * Outputs: none
+ * Return Value: index of the mount, -1 if the table is full or the mount
+ *               point is taken
+ * Side Effects: none
+ */
+int32_t vfs_mount(const int8_t* prefix, fs_t* fs, vfs_ops_t* ops,
+                  fot_t* file_fot, fot_t* dir_fot) {
+  uint32_t len = strlen(prefix);
+  int32_t i, mount = ERROR;
+  if (len >= VFS_PREFIX_SIZE) return ERROR;
+
+  for (i = VFS_MAX_MOUNTS - 1; i >= 0; i--) {
+    if (!mounts[i].in_use)
+      mount = i;
+    else if (mounts[i].prefix_len == len &&
+             !strncmp(mounts[i].prefix, prefix, len))
+      return ERROR;  // already mounted
+  }
+  if (mount == ERROR) return ERROR;
+
+  strcpy(mounts[mount].prefix, prefix);
+  mounts[mount].prefix_len = len;
+  mounts[mount].fs = fs;
+  mounts[mount].ops = ops;
+  mounts[mount].file_fot = file_fot;
+  mounts[mount].dir_fot = dir_fot;
+  mounts[mount].in_use = 1;
+  return mount;
+}
+
+/* Name: vfs_mount_image()
+ * Description: mounts a file system image that is already in memory, such
+ *              as a multiboot module
+ * Inputs: prefix: the mount point, addr: where the image starts
+ * Outputs: none
+ * Return Value: index of the mount, -1 on failure
+ * Side Effects: reads the image's boot block and builds its bitmaps
+ */
+int32_t vfs_mount_image(const int8_t* prefix, uint32_t addr) {
+  int32_t mount = vfs_mount(prefix, NULL, &image_ops, &file_fot, &dir_fot);
+  if (mount == ERROR) return ERROR;
+
+  mounts[mount].fs = &mount_images[mount];
+  file_system_init(mounts[mount].fs, addr);
+  return mount;
+}
+
+/* Name: vfs_mount_disk()
+ * Description: mounts the file system image on the disk, read only
+ * Inputs: prefix: the mount point
+ * Outputs: none
+ * Return Value: index of the mount, -1 on failure
+ * Side Effects: reads the image's boot block through the block cache and
+ *               builds its bitmaps
+ */
+int32_t vfs_mount_disk(const int8_t* prefix) {
+  int32_t mount = vfs_mount(prefix, NULL, &image_ops, &file_fot, &dir_fot);
+  if (mount == ERROR) return ERROR;
+
+  mounts[mount].fs = &mount_images[mount];
+  if (file_system_init_disk(mounts[mount].fs) == ERROR) {
+    mounts[mount].in_use = 0;
+    return ERROR;
+  }
+  return mount;
+}
+
+/* Name: vfs_get_mount()
+ * Description: gets a mount table entry
+ * Inputs: mount: index of the mount
+ * Outputs: none
+ * Return Value: pointer to the entry, NULL if nothing is mounted there
+ * Side Effects: none
+ */
+mount_t* vfs_get_mount(int32_t mount) {
+  if (mount < 0 || mount >= VFS_MAX_MOUNTS || !mounts[mount].in_use)
+    return NULL;
+  return &mounts[mount];
+}
+
+/* Name: vfs_resolve()
+ * Description: finds the mount a path is in, the mount with the longest
+ *              prefix of the path wins
+ * Inputs: path: the path to resolve, mount: set to the index of the mount
+ * Outputs: none
+ * Return Value: the rest of the path, the name inside the mount, NULL if no
+ *               mount matches
+ * Side Effects: none
+ */
+const uint8_t* vfs_resolve(const uint8_t* path, int32_t* mount) {
+  int32_t i, best = ERROR;
+  for (i = 0; i < VFS_MAX_MOUNTS; i++) {
+    if (!mounts[i].in_use) continue;
+    if (strncmp((int8_t*)path, mounts[i].prefix, mounts[i].prefix_len))
+      continue;
+    if (best == ERROR || mounts[i].prefix_len > mounts[best].prefix_len)
+      best = i;
+  }
+  if (best == ERROR) return NULL;
+
+  *mount = best;
+  return path + mounts[best].prefix_len;
+}
+
+/* Name: dcache_find()
+ * Description: finds the dentry cache slot for a name in a mount
+ * Inputs: mount: index of the mount, fname: the name inside the mount
+ * Outputs: none
+ * Return Value: pointer to the slot, it may hold another name
+ * Side Effects: none
+ */
+static dcache_entry_t* dcache_find(int32_t mount, const uint8_t* fname) {
+  return &dcache[(dentry_name_hash(fname) ^ mount) & DCACHE_MASK];
+}
+
+/* Name: dcache_match()
+ * Description: checks if a dentry cache slot holds a name in a mount
+ * Inputs: entry: the slot, mount: index of the mount, fname: the name
+ * Outputs: none
+ * Return Value: 1 if it does, 0 otherwise
+ * Side Effects: none
+ */
+static int32_t dcache_match(dcache_entry_t* entry, int32_t mount,
+                            const uint8_t* fname) {
+  return entry->valid && entry->mount == mount &&
+         !strncmp((int8_t*)fname, entry->dentry.file_name, FILE_NAME_SIZE);
+}
+
+/* Name: vfs_lookup()
+ * Description: finds a file by path, through the dentry cache and then the
+ *              lookup of the mount it is in
+ * Inputs: path: the path of the file, mount: set to the index of the mount,
+ *         dentry: where to copy the directory entry
+ * Outputs: none
+ * Return Value: 0 on success, -1 if the file doesn't exist
+ * Side Effects: caches the entry and updates the cache counters
+ */
+int32_t vfs_lookup(const uint8_t* path, int32_t* mount, dir_entry_t* dentry) {
+  const uint8_t* fname = vfs_resolve(path, mount);
+  if (fname == NULL || strlen((int8_t*)fname) > FILE_NAME_SIZE) return ERROR;
+  mount_t* m = &mounts[*mount];
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  dcache_entry_t* entry = dcache_find(*mount, fname);
+  if (dcache_match(entry, *mount, fname)) {
+    dcache_stats.hits++;
+    memcpy(dentry, &entry->dentry, DIR_ENTRY_SIZE_BYTES);
+    restore_flags(flags);
+    return 0;
+  }
+
+  dcache_stats.misses++;
+  if (m->ops->lookup(m->fs, fname, dentry) == ERROR) {
+    restore_flags(flags);
+    return ERROR;
+  }
+
+  // only names that exist are cached, so creating a file can't go stale
+  memcpy(&entry->dentry, dentry, DIR_ENTRY_SIZE_BYTES);
+  entry->mount = *mount;
+  entry->valid = 1;
+
+  restore_flags(flags);
+  return 0;
+}
+
+/* Name: vfs_create()
+ * Description: creates an empty file in the mount the path is in
+ * Inputs: path: the path of the new file
+ * Outputs: none
+ * Return Value: the new file's inode, -1 on failure
+ * Side Effects: none
+ */
+int32_t vfs_create(const uint8_t* path) {
+  int32_t mount;
+  const uint8_t* fname = vfs_resolve(path, &mount);
+  if (fname == NULL) return ERROR;
+  return mounts[mount].ops->create(mounts[mount].fs, fname);
+}
+
+/* Name: vfs_delete()
+ * Description: deletes a file from the mount the path is in
+ * Inputs: path: the path of the file
+ * Outputs: none
+ * Return Value: 0 on success, -1 on failure
+ * Side Effects: drops the file from the dentry cache
+ */
+int32_t vfs_delete(const uint8_t* path) {
+  int32_t mount;
+  const uint8_t* fname = vfs_resolve(path, &mount);
+  if (fname == NULL || strlen((int8_t*)fname) > FILE_NAME_SIZE) return ERROR;
+
+  uint32_t flags;
+  cli_and_save(flags);
+
+  int32_t ret = mounts[mount].ops->remove(mounts[mount].fs, fname);
+  if (ret != ERROR) {
+    dcache_entry_t* entry = dcache_find(mount, fname);
+    if (dcache_match(entry, mount, fname)) entry->valid = 0;
+  }
+
+  restore_flags(flags);
+  return ret;
+}
+
+/* Name: vfs_fd_fs()
+ * Description: gets the image an open fd of the current process is in
+ * Inputs: fd: the file descriptor
+ * Outputs: none
+ * Return Value: the image, NULL if the fd's file system isn't an image
+ * Side Effects: none
+ */
+fs_t* vfs_fd_fs(int32_t fd) {
+  return mounts[get_curr_pcb()->fdt[fd].flags.mount].fs;
+}
+
+/* Name: get_dcache_stats()
+ * Description: copies out the dentry cache counters
+ * Inputs: stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_dcache_stats(dcache_stats_t* stats) {
+  memcpy(stats, &dcache_stats, sizeof(dcache_stats_t));
+}
@@ -0,0 +1,91 @@
+#ifndef _VFS_H
+#define _VFS_H
+
+#include "file_system.h"
+#include "lib.h"
+#include "pcb.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+#define VFS_MAX_MOUNTS 8   // fits the mount field of an fdt entry
+#define VFS_PREFIX_SIZE 8  // longest mount point, including the null
+#define VFS_ROOT_PREFIX ""
+#define VFS_ROOT_MOUNT 0  // the first module is mounted first
+#define VFS_MODULE_PREFIX "mod"  // module i > 0 is mounted at "mod<i>/"
+#define VFS_DISK_PREFIX "disk/"   // image on the primary IDE disk
+// Mounts kept free for "tmp/" and "disk/", modules get the rest
+#define VFS_RESERVED_MOUNTS 2
+#define VFS_MAX_MODULES (VFS_MAX_MOUNTS - VFS_RESERVED_MOUNTS)
+
+// Dentry cache shared by every mount, direct mapped by name hash
+#define DCACHE_SIZE 128
+#define DCACHE_MASK (DCACHE_SIZE - 1)
+
+/* --- Local Types --- */
+
+typedef int32_t (*LookupFn)(fs_t* fs, const uint8_t* fname,
+                            dir_entry_t* dentry);
+typedef int32_t (*CreateFn)(fs_t* fs, const uint8_t* fname);
+typedef int32_t (*DeleteFn)(fs_t* fs, const uint8_t* fname);
+typedef int32_t (*TruncateFn)(fs_t* fs, uint32_t inode, uint32_t length);
+typedef int32_t (*StatFn)(fs_t* fs, uint32_t file_type, uint32_t inode,
+                          stat_t* stat);
+typedef int32_t (*ReadDataFn)(fs_t* fs, uint32_t inode, uint32_t offset,
+                              uint8_t* buf, uint32_t length);
+typedef int32_t (*GetdentsFn)(int32_t fd, void* buf, int32_t nbytes);
+
+// Operations on a mounted file system that don't go through an fd
+typedef struct vfs_ops {
+  LookupFn lookup;
+  CreateFn create;
+  DeleteFn remove;
+  TruncateFn truncate;
+  StatFn stat;
+  ReadDataFn read_data;
+  GetdentsFn getdents;  // on an fd open on the mount's directory
+} vfs_ops_t;
+
+// Mount table entry, paths starting with prefix are looked up in fs
+typedef struct mount {
+  char prefix[VFS_PREFIX_SIZE];
+  uint32_t prefix_len;
+  uint8_t in_use;
+  fs_t* fs;         // NULL for file systems that aren't images
+  vfs_ops_t* ops;
+  fot_t* file_fot;  // fd operations for regular files
+  fot_t* dir_fot;   // NULL if the file system has no directory
+} mount_t;
+
+// A cached name lookup, valid until the file is deleted
+typedef struct dcache_entry {
+  uint8_t valid;
+  uint8_t mount;
+  dir_entry_t dentry;
+} dcache_entry_t;
+
+// Counters for vfs_lookup through the dentry cache
+typedef struct dcache_stats {
+  uint32_t hits;
+  uint32_t misses;
+} dcache_stats_t;
+
+/* --- Function Prototypes --- */
+
+void vfs_init();
+int32_t vfs_mount(const int8_t* prefix, fs_t* fs, vfs_ops_t* ops,
+                  fot_t* file_fot, fot_t* dir_fot);
+int32_t vfs_mount_image(const int8_t* prefix, uint32_t addr);
+int32_t vfs_mount_disk(const int8_t* prefix);
+mount_t* vfs_get_mount(int32_t mount);
+const uint8_t* vfs_resolve(const uint8_t* path, int32_t* mount);
+int32_t vfs_lookup(const uint8_t* path, int32_t* mount, dir_entry_t* dentry);
+int32_t vfs_create(const uint8_t* path);
+int32_t vfs_delete(const uint8_t* path);
+fs_t* vfs_fd_fs(int32_t fd);
+void get_dcache_stats(dcache_stats_t* stats);
+
+extern vfs_ops_t image_ops;
+extern vfs_ops_t tmpfs_ops;
+
+#endif
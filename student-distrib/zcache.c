@@ -0,0 +1,219 @@
+#include "zcache.h"
+
+// Global Variables
+static uint8_t zcache_data[ZCACHE_SIZE][ZCACHE_BLOCK_SIZE];
+static zcache_entry_t zcache[ZCACHE_SIZE];
+static int16_t zcache_hash[ZCACHE_HASH_SIZE];  // first entry of each bucket
+static int16_t lru_head, lru_tail;
+static zcache_stats_t zcache_stats;
+
+/* Name: lru_remove()
+ * Description: takes an entry off the LRU list
+ * Inputs: i: index of the entry
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void lru_remove(int32_t i) {
+  if (zcache[i].prev != ZCACHE_NONE)
+    zcache[zcache[i].prev].next = zcache[i].next;
+  else
+    lru_head = zcache[i].next;
+
+  if (zcache[i].next != ZCACHE_NONE)
+    zcache[zcache[i].next].prev = zcache[i].prev;
+  else
+    lru_tail = zcache[i].prev;
+
+  zcache[i].prev = zcache[i].next = ZCACHE_NONE;
+}
+
+/* Name: lru_push_head()
+ * Description: puts an entry at the most recently used end of the LRU list
+ * Inputs: i: index of the entry, it must not be on the list
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void lru_push_head(int32_t i) {
+  zcache[i].prev = ZCACHE_NONE;
+  zcache[i].next = lru_head;
+  if (lru_head != ZCACHE_NONE)
+    zcache[lru_head].prev = i;
+  else
+    lru_tail = i;
+  lru_head = i;
+}
+
+/* Name: lru_push_tail()
+ * Description: puts an entry at the end of the LRU list, so it is reused
+ *              first
+ * Inputs: i: index of the entry, it must not be on the list
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void lru_push_tail(int32_t i) {
+  zcache[i].next = ZCACHE_NONE;
+  zcache[i].prev = lru_tail;
+  if (lru_tail != ZCACHE_NONE)
+    zcache[lru_tail].next = i;
+  else
+    lru_head = i;
+  lru_tail = i;
+}
+
+/* Name: zcache_bucket()
+ * Description: finds the hash bucket of a block
+ * Inputs: fs: the image, inode: the file's inode, block: index in the file
+ * Outputs: none
+ * Return Value: pointer to the first entry of the bucket
+ * Side Effects: none
+ */
+static int16_t* zcache_bucket(fs_t* fs, uint32_t inode, uint32_t block) {
+  uint32_t hash = (uint32_t)fs ^ (inode * FNV_PRIME) ^ block;
+  return &zcache_hash[(hash ^ (hash >> 7)) & ZCACHE_HASH_MASK];
+}
+
+/* Name: hash_find()
+ * Description: finds the entry holding a block
+ * Inputs: fs: the image, inode: the file's inode, block: index in the file
+ * Outputs: none
+ * Return Value: index of the entry, -1 if the block isn't cached
+ * Side Effects: none
+ */
+static int32_t hash_find(fs_t* fs, uint32_t inode, uint32_t block) {
+  int32_t i = *zcache_bucket(fs, inode, block);
+  while (i != ZCACHE_NONE && (zcache[i].fs != fs || zcache[i].inode != inode ||
+                              zcache[i].block != block))
+    i = zcache[i].hash_next;
+  return i;
+}
+
+/* Name: hash_remove()
+ * Description: removes a valid entry from its bucket and invalidates it
+ * Inputs: i: index of the entry
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+static void hash_remove(int32_t i) {
+  int16_t* link = zcache_bucket(zcache[i].fs, zcache[i].inode, zcache[i].block);
+  while (*link != i) link = &zcache[*link].hash_next;
+  *link = zcache[i].hash_next;
+  zcache[i].hash_next = ZCACHE_NONE;
+  zcache[i].valid = 0;
+}
+
+/* Name: zcache_init()
+ * Description: empties the cache
+ * Inputs: none
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: every entry is invalidated and the counters are reset
+ */
+void zcache_init() {
+  int32_t i;
+  memset(zcache_hash, ZCACHE_NONE, sizeof(zcache_hash));
+  lru_head = lru_tail = ZCACHE_NONE;
+
+  for (i = 0; i < ZCACHE_SIZE; i++) {
+    memset(&zcache[i], 0, sizeof(zcache_entry_t));
+    zcache[i].hash_next = ZCACHE_NONE;
+    lru_push_tail(i);
+  }
+  memset(&zcache_stats, 0, sizeof(zcache_stats));
+}
+
+/* Name: zcache_find()
+ * Description: looks up a decompressed block of a file
+ * Inputs: fs: the image, inode: the file's inode, block: index in the file
+ * Outputs: none
+ * Return Value: pointer to the data, NULL if the block isn't cached. It
+ *               stays valid until the next zcache_alloc
+ * Side Effects: a hit makes the block the most recently used
+ */
+uint8_t* zcache_find(fs_t* fs, uint32_t inode, uint32_t block) {
+  uint32_t flags;
+  cli_and_save(flags);
+
+  int32_t i = hash_find(fs, inode, block);
+  if (i != ZCACHE_NONE) {
+    zcache_stats.hits++;
+    lru_remove(i);
+    lru_push_head(i);
+  } else {
+    zcache_stats.misses++;
+  }
+
+  restore_flags(flags);
+  return (i == ZCACHE_NONE) ? NULL : zcache_data[i];
+}
+
+/* Name: zcache_alloc()
+ * Description: gives the least recently used entry to a block that missed,
+ *              the caller decompresses the block into it
+ * Inputs: fs: the image, inode: the file's inode, block: index in the file,
+ *         it must not be cached
+ * Outputs: none
+ * Return Value: pointer to ZCACHE_BLOCK_SIZE bytes for the data
+ * Side Effects: evicts the least recently used block
+ */
+uint8_t* zcache_alloc(fs_t* fs, uint32_t inode, uint32_t block) {
+  uint32_t flags;
+  cli_and_save(flags);
+
+  int32_t i = lru_tail;
+  lru_remove(i);
+  if (zcache[i].valid) {
+    hash_remove(i);
+    zcache_stats.evictions++;
+  }
+
+  zcache[i].fs = fs;
+  zcache[i].inode = inode;
+  zcache[i].block = block;
+  zcache[i].valid = 1;
+  int16_t* bucket = zcache_bucket(fs, inode, block);
+  zcache[i].hash_next = *bucket;
+  *bucket = i;
+  lru_push_head(i);
+
+  restore_flags(flags);
+  return zcache_data[i];
+}
+
+/* Name: zcache_invalidate()
+ * Description: drops every cached block of a file, or of a whole image, when
+ *              the file is deleted or the image is mounted again
+ * Inputs: fs: the image, inode: the file's inode or ZCACHE_ALL_INODES
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: the entries are moved to the end of the LRU list
+ */
+void zcache_invalidate(fs_t* fs, uint32_t inode) {
+  uint32_t flags;
+  int32_t i;
+  cli_and_save(flags);
+
+  for (i = 0; i < ZCACHE_SIZE; i++) {
+    if (!zcache[i].valid || zcache[i].fs != fs) continue;
+    if (inode != ZCACHE_ALL_INODES && zcache[i].inode != inode) continue;
+    hash_remove(i);
+    lru_remove(i);
+    lru_push_tail(i);
+  }
+
+  restore_flags(flags);
+}
+
+/* Name: get_zcache_stats()
+ * Description: copies out the decompressed block cache counters
+ * Inputs: stats: where to copy the counters
+ * Outputs: none
+ * Return Value: none
+ * Side Effects: none
+ */
+void get_zcache_stats(zcache_stats_t* stats) {
+  memcpy(stats, &zcache_stats, sizeof(zcache_stats_t));
+}
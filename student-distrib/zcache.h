@@ -0,0 +1,47 @@
+#ifndef _ZCACHE_H
+#define _ZCACHE_H
+
+#include "file_system.h"
+#include "lib.h"
+#include "types.h"
+
+/* --- Literal Definitions --- */
+
+// Blocks of compressed files are decompressed into this cache on the first
+// read and served from it afterwards. 64 blocks (256 kB) hold the programs
+// and files that are used over and over, like the shell and fish's frames
+#define ZCACHE_BLOCK_SIZE BLOCK_SIZE_BYTES
+#define ZCACHE_SIZE 64
+#define ZCACHE_HASH_SIZE 128
+#define ZCACHE_HASH_MASK (ZCACHE_HASH_SIZE - 1)
+#define ZCACHE_NONE (-1)           // end of the LRU list or a hash chain
+#define ZCACHE_ALL_INODES 0xFFFFFFFF  // zcache_invalidate drops a whole image
+
+/* --- Local Types --- */
+
+typedef struct zcache_entry {
+  fs_t* fs;  // a block is named by its image, inode and index in the file
+  uint32_t inode;
+  uint32_t block;
+  int16_t prev;  // LRU list, the head is the most recently used
+  int16_t next;
+  int16_t hash_next;  // next entry in the same hash bucket
+  uint8_t valid;
+} zcache_entry_t;
+
+// Counters for zcache_find and zcache_alloc
+typedef struct zcache_stats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;  // valid blocks dropped to make room
+} zcache_stats_t;
+
+/* --- Function Prototypes --- */
+
+void zcache_init();
+uint8_t* zcache_find(fs_t* fs, uint32_t inode, uint32_t block);
+uint8_t* zcache_alloc(fs_t* fs, uint32_t inode, uint32_t block);
+void zcache_invalidate(fs_t* fs, uint32_t inode);
+void get_zcache_stats(zcache_stats_t* stats);
+
+#endif